@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "js.h"
+#include "js_history.h"
+#include "js_record.h"
+#include "js_gesture.h"
+#include "js_features.h"
+#include "js_q15.h"
+
+/****************************************************************************************************
+ *
+ * Benchmark Harness
+ *
+ ***************************************************************************************************/
+
+/*
+ * Measures the per-event cost of the hot paths of the library on a recorded session (if a recording
+ * is given) or on a synthetic stream imitating two sticks and occasional button presses. The same
+ * program serves as the training run of the PGO build (see the Makefile).
+ *
+ *     js_bench [recording] [repetitions]
+ */
+
+#define js_bench_synthetic_events 200000
+
+static double js_bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((double) t.tv_sec) + ((double) t.tv_nsec) * 1e-9;
+}
+
+/* deterministic stream: sticks moving on circles with noise, a button press every ~100 events */
+static void js_bench_synthesize(JsEvent * events, size_t number_of_events)
+{
+    uint32_t random = 12345;
+    uint32_t time = 0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        random = random * 1664525u + 1013904223u;
+        time += (random >> 28) < 4;
+        if ((random >> 24) % 100 == 0) {
+            events[i] = (JsEvent){.time = time, .value = (random >> 8) & 1, .type = JS_EVENT_BUTTON, .number = (random >> 9) % 8};
+        }
+        else {
+            const uint8_t axis = (random >> 16) % 4;
+            const int32_t phase = (int32_t) ((i / 64) % 256) - 128;
+            const int32_t value = (axis & 1 ? phase : 128 - (phase < 0 ? -phase : phase)) * 255 + (int32_t) ((random >> 4) % 512) - 256;
+            events[i] = (JsEvent){
+                .time = time,
+                .value = (int16_t) (value > 32767 ? 32767 : value < -32767 ? -32767 : value),
+                .type = JS_EVENT_AXIS,
+                .number = axis
+            };
+        }
+    }
+}
+
+static JsResult js_bench_load(const char * path, JsEvent ** events, size_t * number_of_events)
+{
+    JsRecording recording;
+    if (js_open_recording(&recording, path) != JsResult_success) {
+        return JsResult_failure;
+    }
+    *number_of_events = recording.number_of_events;
+    *events = (JsEvent*) malloc((*number_of_events ? *number_of_events : 1) * sizeof(JsEvent));
+    const JsResult r = *events ? js_decode_recording(&recording, *events, 1) : JsResult_failure;
+    js_close_recording(&recording);
+    return r;
+}
+
+static void js_bench_report(const char * name, double seconds, size_t number_of_events)
+{
+    printf("%-24s %8.2f ns/event\n", name, seconds * 1e9 / (double) number_of_events);
+}
+
+static JsResult js_bench_gesture_action(const JsGesture * gesture, void * arg)
+{
+    ++*((size_t*) arg);
+    return JsResult_success;
+}
+
+int main(int argc, char ** argv)
+{
+    const unsigned int repetitions = argc > 2 ? (unsigned int) atoi(argv[2]) : 5;
+
+    JsEvent * events;
+    size_t number_of_events;
+    if (argc > 1) {
+        if (js_bench_load(argv[1], &events, &number_of_events) != JsResult_success || number_of_events == 0) {
+            fprintf(stderr, "failed to load recording %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        number_of_events = js_bench_synthetic_events;
+        events = (JsEvent*) malloc(number_of_events * sizeof(JsEvent));
+        if (!events) {
+            return EXIT_FAILURE;
+        }
+        js_bench_synthesize(events, number_of_events);
+    }
+    printf("%zu events, best of %u runs\n", number_of_events, repetitions);
+
+    double best[7] = {1e9, 1e9, 1e9, 1e9, 1e9, 1e9, 1e9};
+    size_t checksum = 0;
+    size_t compressed_size = 0;
+    uint8_t * const compressed = (uint8_t*) malloc(2 * number_of_events * sizeof(JsEvent) + 64);
+    if (!compressed) {
+        return EXIT_FAILURE;
+    }
+
+    for (unsigned int r=0; r<repetitions; ++r) {
+        /* state updates */
+        JsState state = {};
+        double t = js_bench_now();
+        for (size_t i=0; i<number_of_events; ++i) {
+            js_update_state(&state, &events[i]);
+            checksum += state.buttons;
+        }
+        t = js_bench_now() - t;
+        best[0] = t < best[0] ? t : best[0];
+
+        /* state history */
+        JsHistory history;
+        if (js_create_history(&history, 1024, 4) != JsResult_success) {
+            return EXIT_FAILURE;
+        }
+        state = (JsState){};
+        t = js_bench_now();
+        for (size_t i=0; i<number_of_events; ++i) {
+            js_update_state(&state, &events[i]);
+            js_history_append(&history, &state);
+        }
+        t = js_bench_now() - t;
+        best[1] = t < best[1] ? t : best[1];
+        js_destroy_history(&history);
+
+        /* gesture recognition */
+        JsGestureRecognizer recognizer = {
+            .x_axis = 0, .y_axis = 1, .inner_radius = 0.2f, .outer_radius = 0.9f,
+            .templates = {
+                {.type = JsGestureType_swipe, .direction = js_gesture_any_direction, .max_duration = 150},
+                {.type = JsGestureType_flick, .direction = js_gesture_any_direction, .max_duration = 300},
+                {.type = JsGestureType_rotation, .direction = js_gesture_any_direction, .min_angle = 6.0f}
+            },
+            .number_of_templates = 3,
+            .gesture_action = js_bench_gesture_action,
+            .gesture_action_arg = &checksum
+        };
+        js_init_gesture_recognizer(&recognizer);
+        t = js_bench_now();
+        for (size_t i=0; i<number_of_events; ++i) {
+            js_gesture_update(&recognizer, &events[i]);
+        }
+        t = js_bench_now() - t;
+        best[2] = t < best[2] ? t : best[2];
+
+        /* feature extraction */
+        JsFeatureExtractor extractor = {};
+        if (js_create_feature_extractor(&extractor, 1000, 4096, 4, 8, 256) != JsResult_success) {
+            return EXIT_FAILURE;
+        }
+        t = js_bench_now();
+        for (size_t i=0; i<number_of_events; ++i) {
+            js_feature_extractor_update(&extractor, &events[i]);
+        }
+        t = js_bench_now() - t;
+        best[3] = t < best[3] ? t : best[3];
+        js_destroy_feature_extractor(&extractor);
+
+        /* compression of recording blocks */
+        t = js_bench_now();
+        compressed_size = js_compress(
+            (const uint8_t*) events, number_of_events * sizeof(JsEvent),
+            compressed, 2 * number_of_events * sizeof(JsEvent) + 64
+        );
+        t = js_bench_now() - t;
+        best[4] = t < best[4] ? t : best[4];
+
+        /* fixed-point conditioning (SIMD kernel and scalar reference) */
+        JsQ15Conditioner conditioner = {};
+        js_init_q15_conditioner(&conditioner);
+        for (uint8_t a=0; a<js_max_number_of_axes; ++a) {
+            js_q15_set_deadzone(&conditioner, a, 1600);
+            js_q15_set_expo(&conditioner, a, 9830);
+            js_q15_set_filter(&conditioner, a, 16384);
+        }
+        for (unsigned int k=0; k<2; ++k) {
+            int16_t output[js_max_number_of_axes];
+            state = (JsState){};
+            t = js_bench_now();
+            for (size_t i=0; i<number_of_events; ++i) {
+                js_update_state(&state, &events[i]);
+                (k ? js_q15_condition_reference : js_q15_condition)(&conditioner, state.axes, output);
+                checksum += (uint16_t) output[0];
+            }
+            t = js_bench_now() - t;
+            best[5 + k] = t < best[5 + k] ? t : best[5 + k];
+        }
+    }
+
+    js_bench_report("js_update_state", best[0], number_of_events);
+    js_bench_report("js_history_append", best[1], number_of_events);
+    js_bench_report("js_gesture_update", best[2], number_of_events);
+    js_bench_report("js_feature_extractor", best[3], number_of_events);
+    js_bench_report("js_compress", best[4], number_of_events);
+    js_bench_report("js_q15_condition", best[5], number_of_events);
+    printf("total %38.2f ns/event\n", (best[0] + best[1] + best[2] + best[3] + best[4] + best[5]) * 1e9 / (double) number_of_events);
+    js_bench_report("(scalar q15 reference)", best[6], number_of_events);
+    printf("(checksum %zu, compressed to %zu bytes)\n", checksum, compressed_size);
+
+    free(compressed);
+    free(events);
+    return EXIT_SUCCESS;
+}
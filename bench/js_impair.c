@@ -0,0 +1,376 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "js.h"
+#include "js_record.h"
+#include "js_impair.h"
+
+/****************************************************************************************************
+ *
+ * Impairment Benchmark
+ *
+ ***************************************************************************************************/
+
+/*
+ * Plays a recorded session (if a recording is given) or a synthetic stream imitating a 250 Hz device
+ * through a fake device (see js_impair.h) with each impairment mode in turn, handles the events with
+ * an event handler monitoring its queue and reports how latency and correctness degrade:
+ *
+ *     js_impair [recording] [seconds per mode]
+ *
+ * The slow handler modes take handling_time per event, so the queue of the fake device overflows
+ * unless the event handler sheds events according to budget_policy once it detects a backlog.
+ *
+ * + delivered/lost: events handled, events dropped or lost while disconnected, events discarded by
+ *   overflows of the queue of the fake device, events shed by the event handler, synthetic events
+ *   sent after reconnects and overflows and events swapped with events of other channels,
+ * + latency: time from the occurrence of an event at the source to its handling (handled events are
+ *   matched to the impaired events of their channel, skipping those that were discarded or shed),
+ * + depth/backlogs: maximum queue depth of the event handler and reads at which it was >= 8,
+ * + order: events handled before an earlier event of the same channel (must be 0),
+ * + error: deviation of the handled state from the state of the source (largest axis deviation in
+ *   percent of the full range plus 100 per wrong button) at each event and after the last event.
+ */
+
+#define js_impair_backlog_threshold 8
+
+typedef struct JsImpairMode {
+    const char * name;
+    JsImpairment impairment;
+    /* time the event action takes in us */
+    uint32_t handling_time;
+    /* JsBudgetPolicy flags of the event handler */
+    uint32_t budget_policy;
+} JsImpairMode;
+
+static const JsImpairMode js_impair_modes[] = {
+    {.name = "ideal"},
+    {.name = "delay 8 ms", .impairment = {.delay = 8000}},
+    {.name = "jitter 0-4 ms", .impairment = {.jitter = 4000}},
+    {.name = "drops 5%", .impairment = {.drop_probability = 0.05f}},
+    {.name = "bursts 2% x 16 ms", .impairment = {.stall_probability = 0.02f, .stall_duration = 16000}},
+    {.name = "reorder 10%", .impairment = {.reorder_probability = 0.1f}},
+    {.name = "disconnects 100 ms/s", .impairment = {.disconnect_interval = 900'000, .disconnect_duration = 100'000}},
+    {.name = "wireless (all)", .impairment = {
+        .delay = 2000, .jitter = 3000, .drop_probability = 0.02f,
+        .stall_probability = 0.01f, .stall_duration = 12000, .reorder_probability = 0.02f,
+        .disconnect_interval = 700'000, .disconnect_duration = 50'000
+    }},
+    {.name = "slow handler 4 ms", .handling_time = 4000},
+    {.name = "slow handler, coalesce", .handling_time = 4000, .budget_policy = JsBudgetPolicy_coalesce}
+};
+
+typedef struct JsImpairBench {
+    const JsImpairedEvent * events;
+    size_t number_of_events;
+    /* next impaired event of the same channel (SIZE_MAX if none) and next impaired event to match
+     * per channel */
+    size_t * next;
+    size_t cursors[2][256];
+    uint32_t handling_time;
+    /* source (ground truth) */
+    const JsEvent * source;
+    size_t number_of_source_events;
+    size_t source_index;
+    JsState source_state;
+    uint64_t start;
+
+    /* measurements (updated by the event handler thread) */
+    atomic_size_t number_of_handled_events;
+    JsState state;
+    /* latencies in us (of the events that are not synthetic) */
+    uint32_t * latencies;
+    size_t number_of_latencies;
+    size_t number_of_order_violations;
+    size_t number_of_mismatches;
+    uint64_t last_source_times[2][256];
+    double error_sum;
+} JsImpairBench;
+
+static uint64_t js_impair_bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+}
+
+/* sticks moving on circles with noise, two axis events per report, a button event every ~50 reports */
+static JsEvent * js_impair_synthesize(double seconds, size_t * number_of_events)
+{
+    const size_t number_of_reports = (size_t) (seconds * 250.0);
+    JsEvent * const events = (JsEvent*) malloc((3 * number_of_reports + 1) * sizeof(JsEvent));
+    if (!events) {
+        return nullptr;
+    }
+
+    uint32_t random = 12345;
+    uint32_t time = 0;
+    size_t n = 0;
+    for (size_t i=0; i<number_of_reports; ++i) {
+        random = random * 1664525u + 1013904223u;
+        time += 3 + ((random >> 28) < 12);
+        const int32_t phase = (int32_t) ((i / 4) % 256) - 128;
+        const uint8_t stick = (uint8_t) (2 * ((random >> 20) & 1));
+        for (uint8_t a=0; a<2; ++a) {
+            const int32_t value = (a ? phase : 128 - (phase < 0 ? -phase : phase)) * 255 + (int32_t) ((random >> 4) % 512) - 256;
+            events[n++] = (JsEvent){
+                .time = time,
+                .value = (int16_t) (value > 32767 ? 32767 : value < -32767 ? -32767 : value),
+                .type = JS_EVENT_AXIS,
+                .number = stick + a
+            };
+        }
+        if ((random >> 24) % 50 == 0) {
+            events[n++] = (JsEvent){.time = time, .value = (random >> 8) & 1, .type = JS_EVENT_BUTTON, .number = (random >> 9) % 8};
+        }
+    }
+    *number_of_events = n;
+    return events;
+}
+
+/* first seconds of a recording */
+static JsEvent * js_impair_load(const char * path, double seconds, size_t * number_of_events)
+{
+    JsRecording recording;
+    if (js_open_recording(&recording, path) != JsResult_success) {
+        return nullptr;
+    }
+    JsEvent * events = (JsEvent*) malloc((recording.number_of_events ? recording.number_of_events : 1) * sizeof(JsEvent));
+    if (events && js_decode_recording(&recording, events, 1) != JsResult_success) {
+        free(events);
+        events = nullptr;
+    }
+    size_t n = 0;
+    while (events && n < recording.number_of_events && (double) (uint32_t) (events[n].time - events[0].time) < seconds * 1000.0) {
+        ++n;
+    }
+    js_close_recording(&recording);
+    *number_of_events = n;
+    return events;
+}
+
+static int js_impair_compare(const void * a, const void * b)
+{
+    const uint32_t x = *((const uint32_t*) a);
+    const uint32_t y = *((const uint32_t*) b);
+    return (x > y) - (x < y);
+}
+
+/* deviation of the handled state from the source state */
+static double js_impair_error(const JsState * state, const JsState * source_state)
+{
+    int32_t deviation = 0;
+    for (unsigned int a=0; a<js_max_number_of_axes; ++a) {
+        const int32_t d = abs((int32_t) state->axes[a] - (int32_t) source_state->axes[a]);
+        deviation = d > deviation ? d : deviation;
+    }
+    return (double) deviation * (100.0 / 65535.0) + 100.0 * (double) __builtin_popcount(state->buttons ^ source_state->buttons);
+}
+
+static JsResult js_impair_bench_action(const JsEvent * event, void * arg)
+{
+    JsImpairBench * const bench = (JsImpairBench*) arg;
+    const uint64_t now = js_get_event_stamp().time;
+
+    if (bench->handling_time) {
+        thrd_sleep(&(struct timespec){.tv_nsec = (long) bench->handling_time * 1000}, nullptr);
+    }
+
+    /* the events of a channel are handled in order, but overflows and shedding leave gaps */
+    const JsImpairedEvent * impaired = nullptr;
+    if (!(event->type & JS_EVENT_INIT)) {
+        size_t * const cursor = &bench->cursors[(event->type & JS_EVENT_AXIS) != 0][event->number];
+        size_t j = *cursor;
+        while (j != SIZE_MAX && memcmp(event, &bench->events[j].event, sizeof(JsEvent)) != 0) {
+            j = bench->next[j];
+        }
+        if (j == SIZE_MAX) {
+            ++bench->number_of_mismatches;
+        }
+        else {
+            impaired = &bench->events[j];
+            *cursor = bench->next[j];
+        }
+    }
+
+    if (impaired) {
+        const uint64_t latency = (now - bench->start - impaired->source_time) / 1000;
+        bench->latencies[bench->number_of_latencies++] = latency > UINT32_MAX ? UINT32_MAX : (uint32_t) latency;
+
+        uint64_t * const last_source_time = &bench->last_source_times[(event->type & JS_EVENT_AXIS) != 0][event->number];
+        if (impaired->source_time < *last_source_time) {
+            ++bench->number_of_order_violations;
+        }
+        *last_source_time = impaired->source_time;
+    }
+
+    /* compare with the state of the source at the time the event is handled */
+    js_update_state(&bench->state, event);
+    while (bench->source_index < bench->number_of_source_events
+        && bench->start + (uint64_t) (uint32_t) (bench->source[bench->source_index].time - bench->source[0].time) * 1'000'000 <= now) {
+        js_update_state(&bench->source_state, &bench->source[bench->source_index++]);
+    }
+    bench->error_sum += js_impair_error(&bench->state, &bench->source_state);
+
+    atomic_fetch_add_explicit(&bench->number_of_handled_events, 1, memory_order_release);
+    return JsResult_success;
+}
+
+static JsResult js_impair_run(const JsImpairMode * mode, const JsEvent * source, size_t number_of_source_events)
+{
+    JsImpairment impairment = mode->impairment;
+    impairment.seed = 12345;
+    JsImpairedEvent * events;
+    size_t number_of_events;
+    if (js_impair_events(&impairment, source, number_of_source_events, &events, &number_of_events) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    JsImpairBench bench = {
+        .events = events,
+        .number_of_events = number_of_events,
+        .next = (size_t*) malloc((number_of_events ? number_of_events : 1) * sizeof(size_t)),
+        .handling_time = mode->handling_time,
+        .source = source,
+        .number_of_source_events = number_of_source_events,
+        .latencies = (uint32_t*) malloc((number_of_events ? number_of_events : 1) * sizeof(uint32_t))
+    };
+    atomic_init(&bench.number_of_handled_events, 0);
+    if (!bench.next || !bench.latencies) {
+        goto allocate_latencies_error;
+    }
+    /* link the events of each channel (scanning backwards) */
+    for (size_t c=0; c<2; ++c) {
+        for (size_t k=0; k<256; ++k) {
+            bench.cursors[c][k] = SIZE_MAX;
+        }
+    }
+    for (size_t i=number_of_events; i-- > 0;) {
+        const JsEvent * const event = &events[i].event;
+        size_t * const cursor = &bench.cursors[(event->type & JS_EVENT_AXIS) != 0][event->number];
+        bench.next[i] = *cursor;
+        *cursor = i;
+    }
+
+    JsFakeDevice device;
+    if (js_create_fake_device(&device, events, number_of_events) != JsResult_success) {
+        goto create_fake_device_error;
+    }
+    bench.start = device.start;
+
+    JsEventHandler event_handler = {
+        .js = device.js,
+        .event_action = js_impair_bench_action,
+        .event_action_arg = &bench,
+        .budget_policy = mode->budget_policy,
+        .backlog_threshold = js_impair_backlog_threshold
+    };
+    if (js_create_event_handler(&event_handler) != JsResult_success) {
+        goto create_event_handler_error;
+    }
+
+    /* wait until all events read have been handled (or for at most 1 s after the last delivery) */
+    const uint64_t deadline = device.start + (number_of_events ? events[number_of_events - 1].delivery_time : 0) + 1'000'000'000;
+    size_t number_of_read_events = number_of_events;
+    while (js_event_handler_is_running(&event_handler) && js_impair_bench_now() < deadline) {
+        if (js_fake_device_is_done(&device)) {
+            number_of_read_events = number_of_events + atomic_load(&device.number_of_synthetic_events)
+                - atomic_load(&device.number_of_discarded_events);
+            if (atomic_load_explicit(&bench.number_of_handled_events, memory_order_acquire)
+                + atomic_load(&event_handler.number_of_shed_events) >= number_of_read_events) {
+                break;
+            }
+        }
+        thrd_sleep(&(struct timespec){.tv_nsec = 10'000'000}, nullptr);
+    }
+    js_destroy_event_handler(&event_handler);
+    js_destroy_fake_device(&device);
+
+    /* the source state after the last event */
+    while (bench.source_index < number_of_source_events) {
+        js_update_state(&bench.source_state, &source[bench.source_index++]);
+    }
+
+    const size_t number_of_handled_events = atomic_load(&bench.number_of_handled_events);
+    const size_t n = bench.number_of_latencies;
+    qsort(bench.latencies, n, sizeof(uint32_t), js_impair_compare);
+    const size_t number_of_shed_events = (size_t) atomic_load(&event_handler.number_of_shed_events);
+    printf("%-22s %7zu %6zu %6zu %6zu %6zu %6zu %7.2f %7.2f %7.2f %6u %8u %6zu %7.2f %7.2f\n",
+        mode->name,
+        number_of_handled_events,
+        impairment.number_of_dropped_events + impairment.number_of_lost_events,
+        atomic_load(&device.number_of_discarded_events),
+        number_of_shed_events,
+        impairment.number_of_synthetic_events + atomic_load(&device.number_of_synthetic_events),
+        impairment.number_of_reordered_events,
+        n ? (double) bench.latencies[n / 2] * 1e-3 : 0.0,
+        n ? (double) bench.latencies[n * 99 / 100] * 1e-3 : 0.0,
+        n ? (double) bench.latencies[n - 1] * 1e-3 : 0.0,
+        (unsigned int) atomic_load(&event_handler.max_queue_depth),
+        (unsigned int) atomic_load(&event_handler.number_of_backlogs),
+        bench.number_of_order_violations,
+        number_of_handled_events ? bench.error_sum / (double) number_of_handled_events : 0.0,
+        js_impair_error(&bench.state, &bench.source_state)
+    );
+    if (number_of_handled_events + number_of_shed_events < number_of_read_events || bench.number_of_mismatches) {
+        fprintf(stderr, "%s: %zu of %zu events handled, %zu mismatches\n",
+            mode->name, number_of_handled_events + number_of_shed_events, number_of_read_events, bench.number_of_mismatches);
+    }
+
+    free(bench.latencies);
+    free(bench.next);
+    free(events);
+    return JsResult_success;
+
+    create_event_handler_error:
+    {
+        js_destroy_fake_device(&device);
+    }
+    create_fake_device_error:
+    allocate_latencies_error:
+    {
+        free(bench.latencies);
+        free(bench.next);
+        free(events);
+    }
+    return JsResult_failure;
+}
+
+int main(int argc, char ** argv)
+{
+    const double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+
+    JsEvent * source;
+    size_t number_of_source_events;
+    if (argc > 1 && argv[1][0]) {
+        source = js_impair_load(argv[1], seconds, &number_of_source_events);
+        if (!source || number_of_source_events == 0) {
+            fprintf(stderr, "failed to load recording %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        source = js_impair_synthesize(seconds, &number_of_source_events);
+        if (!source) {
+            return EXIT_FAILURE;
+        }
+    }
+    printf("%zu events per mode\n", number_of_source_events);
+    printf("%-22s %7s %6s %6s %6s %6s %6s %7s %7s %7s %6s %8s %6s %7s %7s\n",
+        "", "handled", "lost", "ovfl", "shed", "synth", "reord", "p50 ms", "p99 ms", "max ms", "depth", "backlogs", "order", "error", "final"
+    );
+
+    for (size_t m=0; m<sizeof(js_impair_modes) / sizeof(js_impair_modes[0]); ++m) {
+        if (js_impair_run(&js_impair_modes[m], source, number_of_source_events) != JsResult_success) {
+            fprintf(stderr, "failed to run mode %s\n", js_impair_modes[m].name);
+            free(source);
+            return EXIT_FAILURE;
+        }
+    }
+
+    free(source);
+    return EXIT_SUCCESS;
+}
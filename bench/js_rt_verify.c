@@ -0,0 +1,546 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include <dlfcn.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "js.h"
+#include "js_rt.h"
+#include "js_gesture.h"
+#include "js_history.h"
+#include "js_features.h"
+#include "js_config.h"
+#include "js_shm.h"
+#include "js_hid.h"
+#include "js_q15.h"
+#include "js_scope.h"
+
+/****************************************************************************************************
+ *
+ * Verification of the Real-Time Profile
+ *
+ ***************************************************************************************************/
+
+/*
+ * Stress run of the input path of the RT profile (see js_rt.h): a writer thread feeds events into a
+ * pipe standing in for the device (and every 16th event a report of a gamepad into a second pipe
+ * standing in for its hidraw node), the event handler thread runs the RT-safe callbacks (state
+ * history, Q15 conditioner, scope ring, shared memory event ring, hidraw backend, gesture recognizer,
+ * JsLiveConfig, JsRtState, JsRtQueue) and an RT thread consumes state and events (including those
+ * of the shared memory event ring). Meanwhile, the main thread keeps publishing new configurations
+ * to the JsLiveConfig.
+ *
+ * The program interposes allocation, locking, condition waits, stdio and file synchronization. While
+ * armed (after startup), every such call made by the event handler thread or the RT thread is
+ * counted as a violation, and the program fails if there were any.
+ *
+ *     js_rt_verify [--include-non-rt]
+ *
+ * --include-non-rt adds a JsFeatureExtractor (which locks a mutex) to the input path in order to
+ * demonstrate that violations are detected.
+ */
+
+#define js_rt_verify_number_of_events 200000
+
+/* Logitech F310/F710 in DirectInput mode (8-byte reports without report id, see test/js_hid_test.c) */
+static const uint8_t js_rt_verify_descriptor[] = {
+    0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0xA1, 0x02, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x35, 0x00, 0x46,
+    0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x81, 0x02,
+    0x25, 0x07, 0x46, 0x3B, 0x01, 0x75, 0x04, 0x95, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65,
+    0x00, 0x25, 0x01, 0x45, 0x01, 0x75, 0x01, 0x95, 0x0C, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0C, 0x81,
+    0x02, 0x06, 0x00, 0xFF, 0x75, 0x01, 0x95, 0x10, 0x25, 0x01, 0x45, 0x01, 0x09, 0x01, 0x81, 0x02,
+    0xC0, 0xA1, 0x02, 0x26, 0xFF, 0x00, 0x46, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x07, 0x09, 0x02, 0x91,
+    0x02, 0xC0, 0xC0
+};
+
+typedef enum {
+    JsRtCall_malloc,
+    JsRtCall_calloc,
+    JsRtCall_realloc,
+    JsRtCall_free,
+    JsRtCall_aligned_alloc,
+    JsRtCall_posix_memalign,
+    JsRtCall_mtx_lock,
+    JsRtCall_mtx_timedlock,
+    JsRtCall_cnd_wait,
+    JsRtCall_cnd_timedwait,
+    JsRtCall_pthread_mutex_lock,
+    JsRtCall_pthread_cond_wait,
+    JsRtCall_pthread_cond_timedwait,
+    JsRtCall_stdio,
+    JsRtCall_fsync,
+    JsRtCall_poll,
+    JsRtCall_number_of_calls
+} JsRtCall;
+
+static const char * const js_rt_call_names[JsRtCall_number_of_calls] = {
+    "malloc", "calloc", "realloc", "free", "aligned_alloc", "posix_memalign",
+    "mtx_lock", "mtx_timedlock", "cnd_wait", "cnd_timedwait",
+    "pthread_mutex_lock", "pthread_cond_wait", "pthread_cond_timedwait",
+    "stdio", "fsync/fdatasync", "poll"
+};
+
+static atomic_bool js_rt_armed;
+static thread_local bool js_rt_is_hot_thread;
+static atomic_uint_fast64_t js_rt_violations[JsRtCall_number_of_calls];
+
+static void js_rt_check(JsRtCall call)
+{
+    if (js_rt_is_hot_thread && atomic_load_explicit(&js_rt_armed, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&js_rt_violations[call], 1, memory_order_relaxed);
+    }
+}
+
+/****************************************************************************************************
+ * Interposed Functions
+ ***************************************************************************************************/
+
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t n, size_t size);
+extern void * __libc_realloc(void * p, size_t size);
+extern void * __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void * p);
+
+void * malloc(size_t size)
+{
+    js_rt_check(JsRtCall_malloc);
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t n, size_t size)
+{
+    js_rt_check(JsRtCall_calloc);
+    return __libc_calloc(n, size);
+}
+
+void * realloc(void * p, size_t size)
+{
+    js_rt_check(JsRtCall_realloc);
+    return __libc_realloc(p, size);
+}
+
+void free(void * p)
+{
+    js_rt_check(JsRtCall_free);
+    __libc_free(p);
+}
+
+void * aligned_alloc(size_t alignment, size_t size)
+{
+    js_rt_check(JsRtCall_aligned_alloc);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** p, size_t alignment, size_t size)
+{
+    js_rt_check(JsRtCall_posix_memalign);
+    *p = __libc_memalign(alignment, size);
+    return *p ? 0 : ENOMEM;
+}
+
+/* resolved during startup (before arming) */
+static int (*js_rt_real_mtx_lock)(mtx_t * m);
+static int (*js_rt_real_mtx_timedlock)(mtx_t * restrict m, const struct timespec * restrict t);
+static int (*js_rt_real_cnd_wait)(cnd_t * c, mtx_t * m);
+static int (*js_rt_real_cnd_timedwait)(cnd_t * restrict c, mtx_t * restrict m, const struct timespec * restrict t);
+static int (*js_rt_real_pthread_mutex_lock)(pthread_mutex_t * m);
+static int (*js_rt_real_pthread_cond_wait)(pthread_cond_t * restrict c, pthread_mutex_t * restrict m);
+static int (*js_rt_real_pthread_cond_timedwait)(pthread_cond_t * restrict c, pthread_mutex_t * restrict m,
+    const struct timespec * restrict t);
+static int (*js_rt_real_vfprintf)(FILE * restrict f, const char * restrict format, va_list args);
+static int (*js_rt_real_fputs)(const char * restrict s, FILE * restrict f);
+static int (*js_rt_real_puts)(const char * s);
+static size_t (*js_rt_real_fwrite)(const void * restrict p, size_t size, size_t n, FILE * restrict f);
+static int (*js_rt_real_fsync)(int fd);
+static int (*js_rt_real_fdatasync)(int fd);
+static int (*js_rt_real_poll)(struct pollfd * fds, nfds_t n, int timeout);
+
+/* (assignment through void** as recommended by POSIX for dlsym) */
+#define js_rt_resolve_function(name) (*(void**) &js_rt_real_##name = dlsym(RTLD_NEXT, #name))
+
+static void js_rt_resolve(void)
+{
+    js_rt_resolve_function(mtx_lock);
+    js_rt_resolve_function(mtx_timedlock);
+    js_rt_resolve_function(cnd_wait);
+    js_rt_resolve_function(cnd_timedwait);
+    js_rt_resolve_function(pthread_mutex_lock);
+    js_rt_resolve_function(pthread_cond_wait);
+    js_rt_resolve_function(pthread_cond_timedwait);
+    js_rt_resolve_function(vfprintf);
+    js_rt_resolve_function(fputs);
+    js_rt_resolve_function(puts);
+    js_rt_resolve_function(fwrite);
+    js_rt_resolve_function(fsync);
+    js_rt_resolve_function(fdatasync);
+    js_rt_resolve_function(poll);
+}
+
+int mtx_lock(mtx_t * m)
+{
+    js_rt_check(JsRtCall_mtx_lock);
+    return js_rt_real_mtx_lock(m);
+}
+
+int mtx_timedlock(mtx_t * restrict m, const struct timespec * restrict t)
+{
+    js_rt_check(JsRtCall_mtx_timedlock);
+    return js_rt_real_mtx_timedlock(m, t);
+}
+
+int cnd_wait(cnd_t * c, mtx_t * m)
+{
+    js_rt_check(JsRtCall_cnd_wait);
+    return js_rt_real_cnd_wait(c, m);
+}
+
+int cnd_timedwait(cnd_t * restrict c, mtx_t * restrict m, const struct timespec * restrict t)
+{
+    js_rt_check(JsRtCall_cnd_timedwait);
+    return js_rt_real_cnd_timedwait(c, m, t);
+}
+
+int pthread_mutex_lock(pthread_mutex_t * m)
+{
+    js_rt_check(JsRtCall_pthread_mutex_lock);
+    return js_rt_real_pthread_mutex_lock(m);
+}
+
+int pthread_cond_wait(pthread_cond_t * restrict c, pthread_mutex_t * restrict m)
+{
+    js_rt_check(JsRtCall_pthread_cond_wait);
+    return js_rt_real_pthread_cond_wait(c, m);
+}
+
+int pthread_cond_timedwait(pthread_cond_t * restrict c, pthread_mutex_t * restrict m, const struct timespec * restrict t)
+{
+    js_rt_check(JsRtCall_pthread_cond_timedwait);
+    return js_rt_real_pthread_cond_timedwait(c, m, t);
+}
+
+int printf(const char * restrict format, ...)
+{
+    js_rt_check(JsRtCall_stdio);
+    va_list args;
+    va_start(args, format);
+    const int r = js_rt_real_vfprintf(stdout, format, args);
+    va_end(args);
+    return r;
+}
+
+int fprintf(FILE * restrict f, const char * restrict format, ...)
+{
+    js_rt_check(JsRtCall_stdio);
+    va_list args;
+    va_start(args, format);
+    const int r = js_rt_real_vfprintf(f, format, args);
+    va_end(args);
+    return r;
+}
+
+int puts(const char * s)
+{
+    js_rt_check(JsRtCall_stdio);
+    return js_rt_real_puts(s);
+}
+
+int fputs(const char * restrict s, FILE * restrict f)
+{
+    js_rt_check(JsRtCall_stdio);
+    return js_rt_real_fputs(s, f);
+}
+
+size_t fwrite(const void * restrict p, size_t size, size_t n, FILE * restrict f)
+{
+    js_rt_check(JsRtCall_stdio);
+    return js_rt_real_fwrite(p, size, n, f);
+}
+
+int fsync(int fd)
+{
+    js_rt_check(JsRtCall_fsync);
+    return js_rt_real_fsync(fd);
+}
+
+int fdatasync(int fd)
+{
+    js_rt_check(JsRtCall_fsync);
+    return js_rt_real_fdatasync(fd);
+}
+
+int poll(struct pollfd * fds, nfds_t n, int timeout)
+{
+    js_rt_check(JsRtCall_poll);
+    return js_rt_real_poll(fds, n, timeout);
+}
+
+/****************************************************************************************************
+ * Stress Run
+ ***************************************************************************************************/
+
+typedef struct JsRtVerify {
+    int device[2];
+    JsEventHandler event_handler;
+    JsRtState rt_state;
+    JsRtQueue rt_queue;
+    JsEvent queue_events[4096];
+    JsGestureRecognizer recognizer;
+    JsHistory history;
+    JsState history_state;
+    JsFeatureExtractor extractor;
+    JsLiveConfig live_config;
+    JsQ15Conditioner conditioner;
+    JsScopeRing scope_ring;
+    JsEventRing event_ring;
+    JsEventSubscriber subscriber;
+    int hid_device[2];
+    JsHidDevice hid;
+    bool include_non_rt;
+    atomic_bool is_done;
+    atomic_uint_fast64_t number_of_received_events;
+    uint64_t number_of_gestures;
+    uint64_t number_of_hid_events;
+    uint64_t number_of_ring_events;
+} JsRtVerify;
+
+/* first callback of the input path (marks the event handler thread) */
+static JsResult js_rt_verify_event_action(const JsEvent * event, void * arg)
+{
+    JsRtVerify * const v = (JsRtVerify*) arg;
+    js_rt_is_hot_thread = true;
+
+    if (js_update_state(&v->history_state, event) != JsResult_success
+        || js_history_append(&v->history, &v->history_state) != JsResult_success) {
+        return JsResult_failure;
+    }
+    if (js_q15_event_action(event, &v->conditioner) != JsResult_success
+        || js_scope_ring_push(&v->scope_ring, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+    js_publish_event(&v->event_ring, event);
+    if (js_hid_process_ready(&v->hid) == JsResult_failure) {
+        return JsResult_failure;
+    }
+    if (v->include_non_rt && js_feature_extractor_update(&v->extractor, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+    return js_gesture_event_action(event, &v->recognizer);
+}
+
+static JsResult js_rt_verify_hid_action(const JsEvent * event, void * arg)
+{
+    ++((JsRtVerify*) arg)->number_of_hid_events;
+    return JsResult_success;
+}
+
+static JsResult js_rt_verify_gesture_action(const JsGesture * gesture, void * arg)
+{
+    ++((JsRtVerify*) arg)->number_of_gestures;
+    return JsResult_success;
+}
+
+static int js_rt_verify_rt_thread(void * arg)
+{
+    JsRtVerify * const v = (JsRtVerify*) arg;
+    js_rt_is_hot_thread = true;
+
+    while (!atomic_load(&v->is_done)) {
+        JsState state;
+        js_rt_query_state(&v->rt_state, &state);
+        JsEvent event;
+        while (js_rt_queue_pop(&v->rt_queue, &event) == JsResult_success) {
+            atomic_fetch_add_explicit(&v->number_of_received_events, 1, memory_order_relaxed);
+        }
+        while (js_receive_event(&v->subscriber, &event) == JsResult_success) {
+            ++v->number_of_ring_events;
+        }
+        thrd_yield();
+    }
+    return EXIT_SUCCESS;
+}
+
+static int js_rt_verify_writer_thread(void * arg)
+{
+    JsRtVerify * const v = (JsRtVerify*) arg;
+
+    uint32_t random = 1;
+    for (uint32_t i=0; i<js_rt_verify_number_of_events; ++i) {
+        random = random * 1664525u + 1013904223u;
+        const bool is_button = (random >> 24) % 50 == 0;
+        const JsEvent event = {
+            .time = i / 4,
+            .value = is_button ? (int16_t) ((random >> 8) & 1) : (int16_t) (random >> 16),
+            .type = is_button ? JS_EVENT_BUTTON : JS_EVENT_AXIS,
+            .number = (uint8_t) ((random >> 4) % 4)
+        };
+        /* the pipe is non-blocking, so a failed event handler does not block the writer */
+        while (write(v->device[1], &event, sizeof(event)) != sizeof(event)) {
+            if (errno != EAGAIN || !js_event_handler_is_running(&v->event_handler)) {
+                return EXIT_FAILURE;
+            }
+            thrd_yield();
+        }
+        /* gamepad report (dropped if the pipe is full) */
+        if (i % 16 == 0) {
+            const uint8_t report[8] = {
+                (uint8_t) random, (uint8_t) (random >> 8), (uint8_t) (random >> 16), (uint8_t) (random >> 24),
+                (uint8_t) (((random >> 4) % 9) | ((random & 0x0F) << 4)), (uint8_t) (random >> 12), 0, 0
+            };
+            if (write(v->hid_device[1], report, sizeof(report)) != sizeof(report) && errno != EAGAIN) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char ** argv)
+{
+    static JsRtVerify v;
+    v.include_non_rt = argc > 1 && strcmp(argv[1], "--include-non-rt") == 0;
+    js_rt_resolve();
+
+    /* startup (allocations and locks are allowed) */
+    v.hid = (JsHidDevice){.event_action = js_rt_verify_hid_action, .event_action_arg = &v};
+    if (pipe2(v.device, O_NONBLOCK) != 0
+        || pipe2(v.hid_device, O_NONBLOCK) != 0
+        || js_init_rt_queue(&v.rt_queue, v.queue_events, 4096) != JsResult_success
+        || js_create_history(&v.history, 64, 4) != JsResult_success
+        || js_create_feature_extractor(&v.extractor, 1000, 4096, 4, 8, 256) != JsResult_success
+        || js_create_live_config(&v.live_config, nullptr) != JsResult_success
+        || js_create_scope_ring(&v.scope_ring, 4096) != JsResult_success
+        || js_create_event_ring(&v.event_ring, "/js_rt_verify", 4096) != JsResult_success
+        || js_subscribe_event_ring(&v.subscriber, "/js_rt_verify") != JsResult_success
+        || js_open_hid_device(&v.hid, v.hid_device[0], js_rt_verify_descriptor, sizeof(js_rt_verify_descriptor)) != JsResult_success) {
+        fprintf(stderr, "setup failed\n");
+        return EXIT_FAILURE;
+    }
+    js_init_q15_conditioner(&v.conditioner);
+    for (uint8_t i=0; i<4; ++i) {
+        js_q15_set_deadzone(&v.conditioner, i, 2000);
+        js_q15_set_expo(&v.conditioner, i, 16384);
+        js_q15_set_filter(&v.conditioner, i, 8192);
+    }
+    js_init_rt_state(&v.rt_state);
+    v.rt_state.event_action = js_rt_queue_event_action;
+    v.rt_state.event_action_arg = &v.rt_queue;
+    v.live_config.event_action = js_rt_state_event_action;
+    v.live_config.event_action_arg = &v.rt_state;
+    v.recognizer = (JsGestureRecognizer){
+        .x_axis = 0, .y_axis = 1, .inner_radius = 0.2f, .outer_radius = 0.9f,
+        .templates = {
+            {.type = JsGestureType_swipe, .direction = js_gesture_any_direction},
+            {.type = JsGestureType_rotation, .direction = js_gesture_any_direction, .min_angle = 6.0f}
+        },
+        .number_of_templates = 2,
+        .gesture_action = js_rt_verify_gesture_action,
+        .gesture_action_arg = &v,
+        .event_action = js_live_config_event_action,
+        .event_action_arg = &v.live_config
+    };
+    js_init_gesture_recognizer(&v.recognizer);
+    if (js_rt_lock_memory(64 * 1024) != JsResult_success) {
+        printf("note: memory could not be locked (insufficient privileges)\n");
+    }
+
+    /* (no button priority, since the state history requires events in chronological order) */
+    JsEventHandler * const event_handler = &v.event_handler;
+    *event_handler = (JsEventHandler){
+        .js = v.device[0],
+        .event_action = js_rt_verify_event_action,
+        .event_action_arg = &v,
+        .budget = 1000,
+        .budget_policy = JsBudgetPolicy_coalesce
+    };
+    thrd_t rt_thread;
+    thrd_t writer_thread;
+    if (thrd_create(&rt_thread, js_rt_verify_rt_thread, &v) != thrd_success
+        || js_create_event_handler(event_handler) != JsResult_success) {
+        fprintf(stderr, "failed to start threads\n");
+        return EXIT_FAILURE;
+    }
+
+    /* stress run */
+    atomic_store(&js_rt_armed, true);
+    if (thrd_create(&writer_thread, js_rt_verify_writer_thread, &v) != thrd_success) {
+        return EXIT_FAILURE;
+    }
+    int writer_result;
+    thrd_join(writer_thread, &writer_result);
+    /* wait until every event has been received, dropped or shed while retuning the configuration
+     * (which never drops events, so that all of them reach the RT thread) */
+    JsConfig config;
+    js_init_config(&config);
+    uint64_t number_of_configs = 0;
+    while (atomic_load(&v.number_of_received_events) + atomic_load(&v.rt_queue.number_of_dropped_events)
+        + atomic_load(&event_handler->number_of_shed_events) < js_rt_verify_number_of_events
+        && js_event_handler_is_running(event_handler)) {
+        config.invert[0] = !config.invert[0];
+        config.deadzone[1] = (int16_t) ((number_of_configs * 97) % 4096);
+        if (js_publish_config(&v.live_config, &config) == JsResult_success) {
+            ++number_of_configs;
+        }
+        thrd_sleep(&(struct timespec){.tv_nsec = 1000000}, nullptr);
+    }
+    atomic_store(&js_rt_armed, false);
+
+    /* shutdown */
+    const JsResult handler_result = js_destroy_event_handler(event_handler);
+    atomic_store(&v.is_done, true);
+    thrd_join(rt_thread, nullptr);
+
+    printf("events: %lu received, %lu dropped by the RT queue (%lu button events), %lu shed, %lu gestures, %lu configurations\n",
+        (unsigned long) atomic_load(&v.number_of_received_events),
+        (unsigned long) atomic_load(&v.rt_queue.number_of_dropped_events),
+        (unsigned long) atomic_load(&v.rt_queue.number_of_dropped_button_events),
+        (unsigned long) atomic_load(&event_handler->number_of_shed_events),
+        (unsigned long) v.number_of_gestures,
+        (unsigned long) number_of_configs
+    );
+    printf("        %lu received through the event ring (%lu lost), %lu from %lu hidraw reports\n",
+        (unsigned long) v.number_of_ring_events,
+        (unsigned long) v.subscriber.lost,
+        (unsigned long) v.number_of_hid_events,
+        (unsigned long) v.hid.number_of_reports
+    );
+    uint64_t number_of_violations = 0;
+    for (int i=0; i<JsRtCall_number_of_calls; ++i) {
+        const uint64_t n = atomic_load(&js_rt_violations[i]);
+        if (n) {
+            printf("violation: %s called %lu times on the input path\n", js_rt_call_names[i], (unsigned long) n);
+        }
+        number_of_violations += n;
+    }
+
+    js_unsubscribe_event_ring(&v.subscriber);
+    js_destroy_event_ring(&v.event_ring);
+    js_destroy_scope_ring(&v.scope_ring);
+    close(v.hid_device[0]);
+    close(v.hid_device[1]);
+    js_destroy_live_config(&v.live_config);
+    js_destroy_feature_extractor(&v.extractor);
+    js_destroy_history(&v.history);
+    close(v.device[0]);
+    close(v.device[1]);
+
+    if (handler_result != JsResult_success || writer_result != EXIT_SUCCESS) {
+        printf("FAILED: stress run did not complete\n");
+        return EXIT_FAILURE;
+    }
+    if (number_of_violations) {
+        printf("FAILED: %lu violations of the RT profile\n", (unsigned long) number_of_violations);
+        return EXIT_FAILURE;
+    }
+    printf("PASSED: no allocation, locking, waiting or stdio on the input path\n");
+    return EXIT_SUCCESS;
+}
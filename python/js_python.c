@@ -0,0 +1,584 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "js.h"
+
+/****************************************************************************************************
+ *
+ * Python Bindings
+ *
+ ***************************************************************************************************/
+
+/*
+ * Native extension module "js" exposing an asynchronously updated state with a state history and an
+ * event queue. The event handler thread of the library never touches Python objects (it only updates
+ * plain C memory under a mutex), and waiting for changes releases the GIL.
+ *
+ * Arrays are returned as js.View objects implementing the buffer protocol (PEP 3118) with structured
+ * formats, so numpy.asarray(view) yields a structured array (fields time, buttons, axes or time,
+ * value, type, number) without copying and without a build dependency on NumPy. History views point
+ * directly into the state ring of the library (see AsyncState.history), snapshots and drained event
+ * batches are copied once into memory owned by the view.
+ */
+
+/* buffer formats of JsState and JsEvent (native byte order and alignment) */
+static char js_state_format[64];
+static const char js_event_format[] = "T{I:time:h:value:B:type:B:number:}";
+
+/****************************************************************************************************
+ * View
+ ***************************************************************************************************/
+
+typedef struct {
+    PyObject_HEAD
+    /* object owning the memory (or nullptr if the data is stored in the view itself) */
+    PyObject * owner;
+    void * data;
+    Py_ssize_t number_of_items;
+    Py_ssize_t item_size;
+    const char * format;
+    /* storage of owned data (if any) */
+    _Alignas(8) unsigned char storage[];
+} JsView;
+
+static PyTypeObject JsViewType;
+
+static JsView * js_new_view(PyObject * owner, void * data, Py_ssize_t number_of_items, Py_ssize_t item_size,
+    const char * format)
+{
+    const Py_ssize_t size = owner ? 0 : number_of_items * item_size;
+    JsView * const view = PyObject_NewVar(JsView, &JsViewType, size);
+    if (!view) {
+        return nullptr;
+    }
+    Py_XINCREF(owner);
+    view->owner = owner;
+    view->data = owner ? data : view->storage;
+    view->number_of_items = number_of_items;
+    view->item_size = item_size;
+    view->format = format;
+    if (!owner && data && size) {
+        memcpy(view->storage, data, size);
+    }
+    return view;
+}
+
+static void js_view_dealloc(JsView * view)
+{
+    Py_XDECREF(view->owner);
+    Py_TYPE(view)->tp_free((PyObject*) view);
+}
+
+static int js_view_getbuffer(JsView * view, Py_buffer * buffer, int flags)
+{
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "js.View is read-only");
+        buffer->obj = nullptr;
+        return -1;
+    }
+    buffer->buf = view->data;
+    buffer->obj = Py_NewRef(view);
+    buffer->len = view->number_of_items * view->item_size;
+    buffer->itemsize = view->item_size;
+    buffer->readonly = 1;
+    buffer->ndim = 1;
+    buffer->format = (flags & PyBUF_FORMAT) ? (char*) view->format : nullptr;
+    buffer->shape = (flags & PyBUF_ND) ? &view->number_of_items : nullptr;
+    buffer->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &view->item_size : nullptr;
+    buffer->suboffsets = nullptr;
+    buffer->internal = nullptr;
+    return 0;
+}
+
+static Py_ssize_t js_view_length(JsView * view)
+{
+    return view->number_of_items;
+}
+
+static PyBufferProcs js_view_buffer_procs = {
+    .bf_getbuffer = (getbufferproc) js_view_getbuffer
+};
+
+static PySequenceMethods js_view_sequence_methods = {
+    .sq_length = (lenfunc) js_view_length
+};
+
+static PyTypeObject JsViewType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name = "js.View",
+    .tp_doc = "read-only array of states or events (use numpy.asarray or memoryview to access it)",
+    .tp_basicsize = sizeof(JsView),
+    .tp_itemsize = 1,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor) js_view_dealloc,
+    .tp_as_buffer = &js_view_buffer_procs,
+    .tp_as_sequence = &js_view_sequence_methods
+};
+
+/****************************************************************************************************
+ * AsyncState
+ ***************************************************************************************************/
+
+/*
+ * The state history is a ring in which each state is written twice (at i and i + ring capacity), so
+ * the most recent n states are always contiguous and can be exported without copying. The ring holds
+ * twice the number of states that can be exported (history), so the event handler only writes to
+ * the slots of an exported window after at least history further events (the oldest entries first).
+ */
+
+typedef struct {
+    PyObject_HEAD
+    bool is_open;
+    mtx_t lock;
+    cnd_t changed;
+    JsEventHandler event_handler;
+    JsState state;
+    /* stamp of the most recent event */
+    JsEventStamp stamp;
+    /* incremented on each event */
+    uint64_t version;
+    /* version observed by the last call to wait or snapshot */
+    uint64_t seen_version;
+    /* mirrored state ring (of ring_capacity = 2 * history_capacity states, of which the most recent
+     * history_count <= history_capacity can be exported) */
+    JsState * history;
+    size_t history_capacity;
+    size_t ring_capacity;
+    size_t history_position;
+    size_t history_count;
+    /* event queue (the oldest events are dropped if it is full) */
+    JsEvent * queue;
+    size_t queue_capacity;
+    size_t queue_first;
+    size_t queue_count;
+    uint64_t number_of_dropped_events;
+} JsAsyncStateObject;
+
+/* executed by the event handler thread (without holding the GIL) */
+static JsResult js_python_event_action(const JsEvent * event, void * arg)
+{
+    JsAsyncStateObject * const self = (JsAsyncStateObject*) arg;
+
+    if (mtx_lock(&self->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    if (js_update_state(&self->state, event) == JsResult_success) {
+        self->history[self->history_position] = self->state;
+        self->history[self->history_position + self->ring_capacity] = self->state;
+        self->history_position = (self->history_position + 1) % self->ring_capacity;
+        if (self->history_count < self->history_capacity) {
+            ++self->history_count;
+        }
+    }
+
+    if (self->queue_count == self->queue_capacity) {
+        self->queue_first = (self->queue_first + 1) % self->queue_capacity;
+        --self->queue_count;
+        ++self->number_of_dropped_events;
+    }
+    self->queue[(self->queue_first + self->queue_count) % self->queue_capacity] = *event;
+    ++self->queue_count;
+
+    self->stamp = js_get_event_stamp();
+    ++self->version;
+    cnd_broadcast(&self->changed);
+
+    return mtx_unlock(&self->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+static int js_async_state_init(JsAsyncStateObject * self, PyObject * args, PyObject * kwargs)
+{
+    static char * keywords[] = {"js", "history", "queue", nullptr};
+    int js;
+    Py_ssize_t history_capacity = 1024;
+    Py_ssize_t queue_capacity = 4096;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "i|nn", keywords, &js, &history_capacity, &queue_capacity)) {
+        return -1;
+    }
+    if (self->history) {
+        PyErr_SetString(PyExc_RuntimeError, "AsyncState is already initialized");
+        return -1;
+    }
+    if (history_capacity <= 0 || queue_capacity <= 0 || (size_t) history_capacity > SIZE_MAX / (4 * sizeof(JsState))) {
+        PyErr_SetString(PyExc_ValueError, "capacities must be positive");
+        return -1;
+    }
+
+    self->state = (JsState){};
+    self->stamp = (JsEventStamp){};
+    self->version = 0;
+    self->seen_version = 0;
+    self->history_capacity = history_capacity;
+    self->ring_capacity = 2 * self->history_capacity;
+    self->history_position = 0;
+    self->history_count = 0;
+    self->queue_capacity = queue_capacity;
+    self->queue_first = 0;
+    self->queue_count = 0;
+    self->number_of_dropped_events = 0;
+
+    self->history = (JsState*) calloc(2 * self->ring_capacity, sizeof(JsState));
+    self->queue = (JsEvent*) calloc(self->queue_capacity, sizeof(JsEvent));
+    if (!self->history || !self->queue) {
+        PyErr_NoMemory();
+        goto cleanup_memory;
+    }
+    if (mtx_init(&self->lock, mtx_plain) != thrd_success) {
+        PyErr_SetString(PyExc_OSError, "failed to create mutex");
+        goto cleanup_memory;
+    }
+    if (cnd_init(&self->changed) != thrd_success) {
+        PyErr_SetString(PyExc_OSError, "failed to create condition variable");
+        goto cleanup_lock;
+    }
+
+    self->event_handler = (JsEventHandler){
+        .js = js,
+        .event_action = js_python_event_action,
+        .event_action_arg = self
+    };
+    if (js_create_event_handler(&self->event_handler) != JsResult_success) {
+        PyErr_SetString(PyExc_OSError, "failed to create event handler");
+        goto cleanup_condition;
+    }
+
+    self->is_open = true;
+    return 0;
+
+cleanup_condition:
+    cnd_destroy(&self->changed);
+cleanup_lock:
+    mtx_destroy(&self->lock);
+cleanup_memory:
+    free(self->history);
+    free(self->queue);
+    self->history = nullptr;
+    self->queue = nullptr;
+    return -1;
+}
+
+/* stops the event handler (the memory is kept until the object and all views are gone) */
+static JsResult js_async_state_stop(JsAsyncStateObject * self)
+{
+    if (!self->is_open) {
+        return JsResult_success;
+    }
+    self->is_open = false;
+
+    JsResult r;
+    Py_BEGIN_ALLOW_THREADS
+    r = js_destroy_event_handler(&self->event_handler);
+    Py_END_ALLOW_THREADS
+    return r;
+}
+
+static void js_async_state_dealloc(JsAsyncStateObject * self)
+{
+    const bool is_initialized = self->history != nullptr;
+    js_async_state_stop(self);
+    if (is_initialized) {
+        cnd_destroy(&self->changed);
+        mtx_destroy(&self->lock);
+        free(self->history);
+        free(self->queue);
+    }
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static bool js_async_state_check(JsAsyncStateObject * self)
+{
+    if (!self->history) {
+        PyErr_SetString(PyExc_RuntimeError, "AsyncState is not initialized");
+        return false;
+    }
+    return true;
+}
+
+static PyObject * js_async_state_close(JsAsyncStateObject * self, PyObject * Py_UNUSED(args))
+{
+    if (js_async_state_stop(self) != JsResult_success) {
+        PyErr_SetString(PyExc_OSError, "event handler terminated with an error");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * js_async_state_snapshot(JsAsyncStateObject * self, PyObject * Py_UNUSED(args))
+{
+    if (!js_async_state_check(self)) {
+        return nullptr;
+    }
+
+    JsState state;
+    mtx_lock(&self->lock);
+    state = self->state;
+    self->seen_version = self->version;
+    mtx_unlock(&self->lock);
+
+    return (PyObject*) js_new_view(nullptr, &state, 1, sizeof(JsState), js_state_format);
+}
+
+static PyObject * js_async_state_history(JsAsyncStateObject * self, PyObject * args)
+{
+    Py_ssize_t n = -1;
+    if (!PyArg_ParseTuple(args, "|n", &n) || !js_async_state_check(self)) {
+        return nullptr;
+    }
+
+    mtx_lock(&self->lock);
+    if (n < 0 || (size_t) n > self->history_count) {
+        n = self->history_count;
+    }
+    JsState * const data = &self->history[self->history_position + self->ring_capacity - n];
+    mtx_unlock(&self->lock);
+
+    return (PyObject*) js_new_view((PyObject*) self, data, n, sizeof(JsState), js_state_format);
+}
+
+static PyObject * js_async_state_events(JsAsyncStateObject * self, PyObject * Py_UNUSED(args))
+{
+    if (!js_async_state_check(self)) {
+        return nullptr;
+    }
+
+    mtx_lock(&self->lock);
+    const size_t n = self->queue_count;
+    JsView * const events = js_new_view(nullptr, nullptr, n, sizeof(JsEvent), js_event_format);
+    if (events) {
+        /* copy the (possibly wrapped) queue and empty it */
+        const size_t tail = self->queue_capacity - self->queue_first;
+        const size_t first = tail < n ? tail : n;
+        memcpy(events->storage, &self->queue[self->queue_first], first * sizeof(JsEvent));
+        memcpy(events->storage + first * sizeof(JsEvent), self->queue, (n - first) * sizeof(JsEvent));
+        self->queue_first = (self->queue_first + n) % self->queue_capacity;
+        self->queue_count = 0;
+    }
+    mtx_unlock(&self->lock);
+
+    return (PyObject*) events;
+}
+
+static void js_timespec_add(struct timespec * t, double seconds)
+{
+    const time_t s = (time_t) seconds;
+    t->tv_sec += s;
+    t->tv_nsec += (long) ((seconds - (double) s) * 1e9);
+    if (t->tv_nsec >= 1000000000) {
+        t->tv_sec += 1;
+        t->tv_nsec -= 1000000000;
+    }
+}
+
+static bool js_timespec_less(const struct timespec * a, const struct timespec * b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static PyObject * js_async_state_wait(JsAsyncStateObject * self, PyObject * args)
+{
+    PyObject * timeout_object = Py_None;
+    if (!PyArg_ParseTuple(args, "|O", &timeout_object) || !js_async_state_check(self)) {
+        return nullptr;
+    }
+    double timeout = -1.0;
+    if (timeout_object != Py_None) {
+        timeout = PyFloat_AsDouble(timeout_object);
+        if (timeout == -1.0 && PyErr_Occurred()) {
+            return nullptr;
+        }
+    }
+
+    struct timespec deadline;
+    timespec_get(&deadline, TIME_UTC);
+    if (timeout > 0.0) {
+        js_timespec_add(&deadline, timeout);
+    }
+
+    bool changed;
+    Py_BEGIN_ALLOW_THREADS
+    mtx_lock(&self->lock);
+    while (self->version == self->seen_version && timeout != 0.0
+        && js_event_handler_is_running(&self->event_handler)) {
+        /* wake up periodically to notice a stopped event handler */
+        struct timespec t;
+        timespec_get(&t, TIME_UTC);
+        js_timespec_add(&t, 0.1);
+        const bool is_last = timeout > 0.0 && js_timespec_less(&deadline, &t);
+        if (cnd_timedwait(&self->changed, &self->lock, is_last ? &deadline : &t) == thrd_timedout && is_last) {
+            break;
+        }
+    }
+    changed = self->version != self->seen_version;
+    self->seen_version = self->version;
+    mtx_unlock(&self->lock);
+    Py_END_ALLOW_THREADS
+
+    return PyBool_FromLong(changed);
+}
+
+static PyObject * js_async_state_enter(JsAsyncStateObject * self, PyObject * Py_UNUSED(args))
+{
+    return Py_NewRef(self);
+}
+
+static PyObject * js_async_state_exit(JsAsyncStateObject * self, PyObject * Py_UNUSED(args))
+{
+    return js_async_state_close(self, nullptr);
+}
+
+static PyObject * js_async_state_get_dropped(JsAsyncStateObject * self, void * Py_UNUSED(closure))
+{
+    if (!js_async_state_check(self)) {
+        return nullptr;
+    }
+    mtx_lock(&self->lock);
+    const uint64_t n = self->number_of_dropped_events;
+    mtx_unlock(&self->lock);
+    return PyLong_FromUnsignedLongLong(n);
+}
+
+static PyObject * js_async_state_get_stamp(JsAsyncStateObject * self, void * Py_UNUSED(closure))
+{
+    if (!js_async_state_check(self)) {
+        return nullptr;
+    }
+    mtx_lock(&self->lock);
+    const JsEventStamp stamp = self->stamp;
+    mtx_unlock(&self->lock);
+    return Py_BuildValue("(KK)", (unsigned long long) stamp.sequence, (unsigned long long) stamp.time);
+}
+
+static PyObject * js_async_state_get_running(JsAsyncStateObject * self, void * Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->is_open && js_event_handler_is_running(&self->event_handler));
+}
+
+static PyMethodDef js_async_state_methods[] = {
+    {"close", (PyCFunction) js_async_state_close, METH_NOARGS,
+        "stop the event handler (views stay valid)"},
+    {"snapshot", (PyCFunction) js_async_state_snapshot, METH_NOARGS,
+        "copy of the current state (View of 1 state)"},
+    {"history", (PyCFunction) js_async_state_history, METH_VARARGS,
+        "history([n]): View of the n (default: all, at most history) most recent states, pointing into "
+        "the state ring (entries stay unchanged for at least history further events, then the oldest "
+        "are overwritten first; copy the array if it must persist longer)"},
+    {"events", (PyCFunction) js_async_state_events, METH_NOARGS,
+        "remove and return all queued events (View of events)"},
+    {"wait", (PyCFunction) js_async_state_wait, METH_VARARGS,
+        "wait([timeout]): wait (without holding the GIL) until an event arrived since the last call to "
+        "wait or snapshot, returns False on timeout"},
+    {"__enter__", (PyCFunction) js_async_state_enter, METH_NOARGS, nullptr},
+    {"__exit__", (PyCFunction) js_async_state_exit, METH_VARARGS, nullptr},
+    {nullptr}
+};
+
+static PyGetSetDef js_async_state_getset[] = {
+    {"dropped", (getter) js_async_state_get_dropped, nullptr, "number of events dropped from the full queue", nullptr},
+    {"stamp", (getter) js_async_state_get_stamp, nullptr,
+        "(sequence, time) of the most recent event: global sequence number across all devices and "
+        "CLOCK_MONOTONIC read time in ns", nullptr},
+    {"running", (getter) js_async_state_get_running, nullptr, "state of the event handler", nullptr},
+    {nullptr}
+};
+
+static PyTypeObject JsAsyncStateType = {
+    PyVarObject_HEAD_INIT(nullptr, 0)
+    .tp_name = "js.AsyncState",
+    .tp_doc = "AsyncState(js, history=1024, queue=4096): asynchronously updated state of a joystick",
+    .tp_basicsize = sizeof(JsAsyncStateObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) js_async_state_init,
+    .tp_dealloc = (destructor) js_async_state_dealloc,
+    .tp_methods = js_async_state_methods,
+    .tp_getset = js_async_state_getset
+};
+
+/****************************************************************************************************
+ * Module
+ ***************************************************************************************************/
+
+static PyObject * js_python_connect(PyObject * module, PyObject * args)
+{
+    const char * path;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return nullptr;
+    }
+    const int js = js_connect(path);
+    if (js < 0) {
+        return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    }
+    return PyLong_FromLong(js);
+}
+
+static PyObject * js_python_disconnect(PyObject * module, PyObject * args)
+{
+    int js;
+    if (!PyArg_ParseTuple(args, "i", &js)) {
+        return nullptr;
+    }
+    js_disconnect(js);
+    Py_RETURN_NONE;
+}
+
+static PyObject * js_python_get_properties(PyObject * module, PyObject * args)
+{
+    int js;
+    if (!PyArg_ParseTuple(args, "i", &js)) {
+        return nullptr;
+    }
+    JsProperties properties;
+    if (js_get_properties(js, &properties) != JsResult_success) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    return Py_BuildValue(
+        "{s:i,s:s,s:i,s:i}",
+        "driver_version", properties.driver_version,
+        "name", properties.name,
+        "number_of_buttons", (int) properties.number_of_buttons,
+        "number_of_axes", (int) properties.number_of_axes
+    );
+}
+
+static PyMethodDef js_python_methods[] = {
+    {"connect", js_python_connect, METH_VARARGS, "connect(path): open a joystick device (returns a file descriptor)"},
+    {"disconnect", js_python_disconnect, METH_VARARGS, "disconnect(js): close a joystick device"},
+    {"get_properties", js_python_get_properties, METH_VARARGS, "get_properties(js): properties of a joystick as a dict"},
+    {nullptr}
+};
+
+static struct PyModuleDef js_python_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "js",
+    .m_doc = "bindings for the js joystick library",
+    .m_size = -1,
+    .m_methods = js_python_methods
+};
+
+PyMODINIT_FUNC PyInit_js(void)
+{
+    snprintf(js_state_format, sizeof(js_state_format), "T{I:time:I:buttons:(%d)h:axes:}", js_max_number_of_axes);
+
+    if (PyType_Ready(&JsViewType) < 0 || PyType_Ready(&JsAsyncStateType) < 0) {
+        return nullptr;
+    }
+
+    PyObject * const module = PyModule_Create(&js_python_module);
+    if (!module) {
+        return nullptr;
+    }
+    if (PyModule_AddObjectRef(module, "View", (PyObject*) &JsViewType) < 0
+        || PyModule_AddObjectRef(module, "AsyncState", (PyObject*) &JsAsyncStateType) < 0
+        || PyModule_AddIntConstant(module, "max_number_of_axes", js_max_number_of_axes) < 0
+        || PyModule_AddIntConstant(module, "max_number_of_buttons", js_max_number_of_buttons) < 0) {
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <threads.h>
 #include <inttypes.h>
 #include <errno.h>
@@ -50,6 +51,32 @@ JsResult js_get_event(int js, JsEvent * event)
     return JsResult_failure;
 }
 
+JsResult js_get_events(int js, JsEvent * events, size_t max_number_of_events, size_t * number_of_events)
+{
+    const ssize_t s = read(js, events, max_number_of_events * sizeof(*events));
+
+    /* valid events (the kernel only returns whole events) */
+    if (s > 0 && s % sizeof(*events) == 0) {
+        *number_of_events = s / sizeof(*events);
+        return JsResult_success;
+    }
+
+    *number_of_events = 0;
+
+    /* not enough bytes (this should never happen) */
+    if (s > 0) {
+        return JsResult_failure;
+    }
+
+    /* no event */
+    if (s == 0 || (s == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+        return JsResult_nothing;
+    }
+
+    /* unknow error */
+    return JsResult_failure;
+}
+
 void js_display_event(const JsEvent * event)
 {
     printf(event->type & JS_EVENT_BUTTON ? "button" : "axis  ");
@@ -93,37 +120,196 @@ void js_display_properties(const JsProperties * properties)
 
 static const struct timespec js_timeout = {.tv_nsec = 100000};
 
+/* last sequence number assigned to an event (shared by all event handlers) */
+static atomic_uint_fast64_t js_sequence;
+
+/* stamp of the event currently being handled by the calling thread */
+static thread_local JsEventStamp js_event_stamp;
+
+static uint64_t js_monotonic_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+}
+
+/* remove events according to the budget policy (returns the remaining number of events) */
+static size_t js_shed_events(JsEventHandler * event_handler, JsEvent * events, size_t number_of_events)
+{
+    const uint32_t policy = event_handler->budget_policy;
+
+    /* mark superseded axis events (scanning backwards, one bit per axis number) */
+    uint64_t seen[4] = {};
+    size_t n = number_of_events;
+    for (size_t i=number_of_events; i-- > 0;) {
+        const JsEvent * const event = &events[i];
+        if (!(event->type & JS_EVENT_AXIS) || (event->type & JS_EVENT_INIT)) {
+            continue;
+        }
+        const uint64_t bit = ((uint64_t) 1) << (event->number & 63);
+        if ((policy & JsBudgetPolicy_drop_axes) || (seen[event->number >> 6] & bit)) {
+            events[i].type = 0;
+            --n;
+        }
+        seen[event->number >> 6] |= bit;
+    }
+
+    /* compact remaining events (preserving their order) */
+    size_t j = 0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        if (events[i].type) {
+            events[j++] = events[i];
+        }
+    }
+
+    event_handler->number_of_shed_events += number_of_events - n;
+    return n;
+}
+
+/* move button events ahead of axis events (preserving the order within both groups) */
+static void js_prioritize_buttons(JsEvent * events, size_t number_of_events)
+{
+    JsEvent axes[js_event_handler_batch_size];
+    size_t number_of_buttons = 0;
+    size_t number_of_axes = 0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        if (events[i].type & JS_EVENT_BUTTON) {
+            events[number_of_buttons++] = events[i];
+        }
+        else {
+            axes[number_of_axes++] = events[i];
+        }
+    }
+    memcpy(&events[number_of_buttons], axes, number_of_axes * sizeof(*axes));
+}
+
+/* execute the callback (measuring its execution time if there is a budget) */
+static JsResult js_event_handler_dispatch(JsEventHandler * event_handler, const JsEvent * event, bool * is_overloaded)
+{
+    if (!event_handler->budget) {
+        return event_handler->event_action(event, event_handler->event_action_arg);
+    }
+
+    const uint64_t start = js_monotonic_ns();
+    const JsResult r = event_handler->event_action(event, event_handler->event_action_arg);
+    const uint64_t elapsed = (js_monotonic_ns() - start) / 1000;
+
+    if (elapsed > event_handler->budget) {
+        ++event_handler->number_of_budget_violations;
+        if (event_handler->budget_policy & (JsBudgetPolicy_coalesce | JsBudgetPolicy_drop_axes)) {
+            *is_overloaded = true;
+        }
+        if ((event_handler->budget_policy & JsBudgetPolicy_report) && event_handler->budget_violation_action) {
+            event_handler->budget_violation_action(
+                elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t) elapsed, event_handler->event_action_arg
+            );
+        }
+    }
+    return r;
+}
+
+/* sample the queue depth after reading number_of_events events (and switch to draining in batches
+ * once it reaches the backlog threshold) */
+static void js_monitor_queue(JsEventHandler * event_handler, size_t number_of_events)
+{
+    /* without FIONREAD, events are read in batches, and a batch covers the whole queue of joydev
+     * (which holds as many events as a batch), so the number of events read is the depth */
+    size_t depth = number_of_events;
+    int pending_bytes;
+    if (event_handler->has_pending_bytes && ioctl(event_handler->js, FIONREAD, &pending_bytes) == 0) {
+        depth += (size_t) pending_bytes / sizeof(JsEvent);
+    }
+
+    const uint_fast32_t d = depth > UINT32_MAX ? UINT32_MAX : (uint_fast32_t) depth;
+    atomic_store_explicit(&event_handler->queue_depth, d, memory_order_relaxed);
+    if (d > atomic_load_explicit(&event_handler->max_queue_depth, memory_order_relaxed)) {
+        atomic_store_explicit(&event_handler->max_queue_depth, d, memory_order_relaxed);
+    }
+    if (d >= event_handler->backlog_threshold) {
+        atomic_fetch_add_explicit(&event_handler->number_of_backlogs, 1, memory_order_relaxed);
+        event_handler->is_overloaded = true;
+    }
+}
+
+JsResult js_process_ready(JsEventHandler * event_handler)
+{
+    /* obtain next event (or all pending events in external event loops, if overloaded, prioritizing
+     * buttons or monitoring the queue of a device that does not report its pending bytes) */
+    JsEvent events[js_event_handler_batch_size];
+    size_t number_of_events;
+    const size_t max_number_of_events = (
+        event_handler->reads_batches || event_handler->is_overloaded || event_handler->prioritize_buttons
+        || (event_handler->backlog_threshold && !event_handler->has_pending_bytes)
+        ? js_event_handler_batch_size
+        : 1
+    );
+    switch (js_get_events(event_handler->js, events, max_number_of_events, &number_of_events)) {
+        /* event(s) successfully read */
+        case JsResult_success:
+            break;
+        /* no event (all pending events have been read) */
+        case JsResult_nothing:
+            event_handler->is_overloaded = false;
+            return JsResult_nothing;
+        /* error */
+        default:
+            return JsResult_failure;
+    }
+
+    /* stamp the batch (a single atomic increment reserves consecutive sequence numbers for all
+     * events read, shed events leave gaps) */
+    js_event_stamp = (JsEventStamp){
+        .sequence = atomic_fetch_add_explicit(&js_sequence, number_of_events, memory_order_relaxed),
+        .time = js_monotonic_ns()
+    };
+
+    for (size_t i=0; i<number_of_events; ++i) {
+        if (events[i].type & JS_EVENT_INIT) {
+            atomic_fetch_add_explicit(&event_handler->number_of_synthetic_events, 1, memory_order_relaxed);
+        }
+    }
+    if (event_handler->backlog_threshold) {
+        js_monitor_queue(event_handler, number_of_events);
+    }
+
+    if (event_handler->is_overloaded
+        && (event_handler->budget_policy & (JsBudgetPolicy_coalesce | JsBudgetPolicy_drop_axes))) {
+        number_of_events = js_shed_events(event_handler, events, number_of_events);
+    }
+    if (event_handler->prioritize_buttons) {
+        js_prioritize_buttons(events, number_of_events);
+    }
+
+    /* handle events */
+    for (size_t i=0; i<number_of_events; ++i) {
+        ++js_event_stamp.sequence;
+        const JsResult r = js_event_handler_dispatch(event_handler, &events[i], &event_handler->is_overloaded);
+        if (r == JsResult_stop || r == JsResult_failure) {
+            return r;
+        }
+    }
+    return JsResult_success;
+}
+
 static int js_event_handler_main(void * arg)
 {
     JsEventHandler * const event_handler = (JsEventHandler*) arg;
 
     while (event_handler->is_running) {
-        /* obtain next event */
-        JsEvent event;
-        switch (js_get_event(event_handler->js, &event)) {
-            /* event successfully read */
+        switch (js_process_ready(event_handler)) {
+            /* event(s) handled */
             case JsResult_success:
                 break;
             /* no event -> continue with loop */
             case JsResult_nothing:
                 thrd_sleep(&js_timeout, nullptr);
-                continue;
-            /* error */
-            default:
-                goto exit_failure;
-        }
-
-        /* handle event */
-        switch (event_handler->event_action(&event, event_handler->event_action_arg)) {
+                break;
             /* stop */
             case JsResult_stop:
                 goto exit_success;
             /* error */
-            case JsResult_failure:
-                goto exit_failure;
-            /* continue */
             default:
-                break;
+                goto exit_failure;
         }
     }
 
@@ -135,9 +321,30 @@ static int js_event_handler_main(void * arg)
     return EXIT_FAILURE;
 }
 
-JsResult js_create_event_handler(JsEventHandler * event_handler)
+void js_init_event_handler(JsEventHandler * event_handler)
 {
     atomic_init(&event_handler->is_running, true);
+    atomic_init(&event_handler->number_of_budget_violations, 0);
+    atomic_init(&event_handler->number_of_shed_events, 0);
+    atomic_init(&event_handler->queue_depth, 0);
+    atomic_init(&event_handler->max_queue_depth, 0);
+    atomic_init(&event_handler->number_of_backlogs, 0);
+    atomic_init(&event_handler->number_of_synthetic_events, 0);
+    event_handler->is_overloaded = false;
+    /* external event loops are woken up per readiness, so each call drains as much as possible */
+    event_handler->reads_batches = true;
+
+    /* joydev does not support FIONREAD (pipes and sockets used for replaying events do) */
+    int pending_bytes;
+    event_handler->has_pending_bytes = ioctl(event_handler->js, FIONREAD, &pending_bytes) == 0;
+}
+
+JsResult js_create_event_handler(JsEventHandler * event_handler)
+{
+    js_init_event_handler(event_handler);
+    /* the thread reads single events while it keeps up, so that a budget violation already affects
+     * the handling of the next event */
+    event_handler->reads_batches = false;
 
     /* create event handling thread */
     return (
@@ -167,6 +374,11 @@ bool js_event_handler_is_running(const JsEventHandler * event_handler)
     return event_handler->is_running;
 }
 
+JsEventStamp js_get_event_stamp(void)
+{
+    return js_event_stamp;
+}
+
 /****************************************************************************************************
  *
  * Joystick State
@@ -215,6 +427,7 @@ static JsResult js_async_state_event_action(const JsEvent * event, void * arg)
         return JsResult_failure;
     }
     const JsResult r = js_update_state(&async_state->state, event);
+    async_state->stamp = js_event_stamp;
     if (mtx_unlock(&async_state->lock) != thrd_success) {
         return JsResult_failure;
     }
@@ -224,6 +437,7 @@ static JsResult js_async_state_event_action(const JsEvent * event, void * arg)
 JsResult js_create_async_state(int js, JsAsyncState * async_state)
 {
     async_state->state = (JsState){};
+    async_state->stamp = (JsEventStamp){};
 
     /* handle initial synthetic events */
     JsEvent event;
@@ -282,3 +496,16 @@ JsResult js_query_async_state(JsAsyncState * async_state, JsState * state)
     }
     return JsResult_success;
 }
+
+JsResult js_query_stamped_async_state(JsAsyncState * async_state, JsState * state, JsEventStamp * stamp)
+{
+    if (mtx_lock(&async_state->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+    *state = async_state->state;
+    *stamp = async_state->stamp;
+    if (mtx_unlock(&async_state->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+    return JsResult_success;
+}
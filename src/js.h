@@ -1,6 +1,7 @@
 #ifndef JS_H
 #define JS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <threads.h>
@@ -8,6 +9,9 @@
 
 #include <linux/joystick.h>
 
+/* everything declared here is part of the interface of the shared library */
+#pragma GCC visibility push(default)
+
 typedef enum {
     JsResult_success,
     JsResult_nothing,
@@ -27,6 +31,8 @@ int js_connect(const char * path);
 void js_disconnect(int js);
 
 JsResult js_get_event(int js, JsEvent * event);
+/* read up to max_number_of_events events with a single system call */
+JsResult js_get_events(int js, JsEvent * events, size_t max_number_of_events, size_t * number_of_events);
 void js_display_event(const JsEvent * event);
 
 /****************************************************************************************************
@@ -51,19 +57,93 @@ void js_display_properties(const JsProperties * properties);
  *
  ***************************************************************************************************/
 
+/* maximum number of events read at once (while overloaded or prioritizing buttons, and always by
+ * js_process_ready in external event loops) */
+#define js_event_handler_batch_size 64
+
+typedef enum {
+    /* execute budget_violation_action on each violation */
+    JsBudgetPolicy_report    = (1 << 0),
+    /* deliver only the most recent event per axis of all pending events until the queue is drained */
+    JsBudgetPolicy_coalesce  = (1 << 1),
+    /* drop all pending axis events (but keep buttons) until the queue is drained */
+    JsBudgetPolicy_drop_axes = (1 << 2)
+} JsBudgetPolicy;
+
 typedef struct JsEventHandler {
     int js;
     void * event_action_arg;
     JsResult (*event_action)(const JsEvent * event, void * arg);
 
+    /* read all pending events at once and deliver button events ahead of axis events */
+    bool prioritize_buttons;
+
+    /* optional time budget per callback in us (0 disables budget enforcement) */
+    uint32_t budget;
+    /* responses to budget violations (JsBudgetPolicy flags) */
+    uint32_t budget_policy;
+    /* optional callback executed on budget violations (with the elapsed time in us) */
+    void (*budget_violation_action)(uint32_t elapsed, void * arg);
+
+    /* optional queue depth (in events) at which the event handler drains the queue in batches and
+     * sheds events according to budget_policy (0 disables queue monitoring) */
+    uint32_t backlog_threshold;
+
     thrd_t thread_id;
     atomic_bool is_running;
+    /* set after a budget violation or backlog until all pending events have been read */
+    bool is_overloaded;
+    /* the device reports the number of pending bytes (FIONREAD) */
+    bool has_pending_bytes;
+    /* read up to js_event_handler_batch_size events at once (set by js_init_event_handler, cleared
+     * for the thread of js_create_event_handler) */
+    bool reads_batches;
+    /* statistics */
+    atomic_uint_fast64_t number_of_budget_violations;
+    atomic_uint_fast64_t number_of_shed_events;
+    /* queue monitoring: depth (number of pending events at the most recent read) and its maximum,
+     * number of reads at which the depth reached backlog_threshold and number of synthetic events
+     * (which the kernel sends after startup and when its queue has overflowed) */
+    atomic_uint_fast32_t queue_depth;
+    atomic_uint_fast32_t max_queue_depth;
+    atomic_uint_fast64_t number_of_backlogs;
+    atomic_uint_fast64_t number_of_synthetic_events;
 } JsEventHandler;
 
 JsResult js_create_event_handler(JsEventHandler * event_handler);
 JsResult js_destroy_event_handler(JsEventHandler * event_handler);
 bool js_event_handler_is_running(const JsEventHandler * event_handler);
 
+/*
+ * Integration with external event loops (epoll, libuv, asio, glib, ...): instead of creating a
+ * thread, initialize the event handler with js_init_event_handler, wait for the device (js) to become
+ * readable (POLLIN) in the loop and call js_process_ready, which reads up to
+ * js_event_handler_batch_size pending events at once without blocking and executes the callbacks
+ * inline. It returns JsResult_nothing once all pending events have been read (JsResult_stop and
+ * JsResult_failure are passed on from the callback or indicate an error). See js_uv.h and
+ * js_asio.hpp for adapters.
+ */
+void js_init_event_handler(JsEventHandler * event_handler);
+JsResult js_process_ready(JsEventHandler * event_handler);
+
+/*
+ * Every event read by an event handler is stamped with a sequence number that is global to the
+ * process (increasing in the order in which the event handlers read their events, across all devices)
+ * and the CLOCK_MONOTONIC time at which it was read. This allows ordering events of different
+ * devices, whose kernel times are per-device 32-bit ms values. Events read at once receive
+ * consecutive numbers in the order of delivery (events shed under overload leave gaps). The stamp of
+ * the event currently being handled can be obtained in callbacks with js_get_event_stamp (it is
+ * kept per thread, so it also works with js_process_ready in external event loops).
+ */
+typedef struct JsEventStamp {
+    /* global sequence number (0 if no event has been handled by the calling thread) */
+    uint64_t sequence;
+    /* CLOCK_MONOTONIC time in ns at which the event was read */
+    uint64_t time;
+} JsEventStamp;
+
+JsEventStamp js_get_event_stamp(void);
+
 /****************************************************************************************************
  *
  * Joystick State
@@ -100,10 +180,16 @@ typedef struct JsAsyncState {
     JsEventHandler event_handler;
     /* actual state */
     JsState state;
+    /* stamp of the most recent update */
+    JsEventStamp stamp;
 } JsAsyncState;
 
 JsResult js_create_async_state(int js, JsAsyncState * async_state);
 JsResult js_destroy_async_state(JsAsyncState * async_state);
 JsResult js_query_async_state(JsAsyncState * async_state, JsState * state);
+/* query the state together with the stamp of the event that last updated it */
+JsResult js_query_stamped_async_state(JsAsyncState * async_state, JsState * state, JsEventStamp * stamp);
+
+#pragma GCC visibility pop
 
 #endif
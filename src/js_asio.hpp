@@ -0,0 +1,103 @@
+#ifndef JS_ASIO_HPP
+#define JS_ASIO_HPP
+
+/*
+ * Asio adapter (C++23, header only)
+ *
+ * Handles the events of a JsEventHandler on an asio executor (without any additional thread):
+ *
+ *     JsEventHandler event_handler = {.js = js, .event_action = ..., .event_action_arg = ...};
+ *     js::AsioEventHandler handler(io_context.get_executor(), event_handler);
+ *     handler.start([](JsResult result) {...});
+ *     io_context.run();
+ *
+ * Whenever the device becomes readable, up to max_batches batches are processed before waiting
+ * again (so a flood of events cannot starve other handlers). If a callback returns JsResult_stop or
+ * an error occurs, waiting stops and the completion handler passed to start is executed with the
+ * result. Boost.Asio is used unless JS_STANDALONE_ASIO is defined. The file descriptor remains owned
+ * by the caller (it is released, not closed, on destruction).
+ */
+
+#include <functional>
+#include <utility>
+
+#ifdef JS_STANDALONE_ASIO
+#include <asio.hpp>
+#else
+#include <boost/asio.hpp>
+#endif
+
+/* js.h uses C11 atomics, which are available to C++ through <stdatomic.h> since C++23 */
+#include <stdatomic.h>
+
+extern "C" {
+#include "js.h"
+}
+
+namespace js {
+
+#ifdef JS_STANDALONE_ASIO
+namespace asio = ::asio;
+#else
+namespace asio = ::boost::asio;
+#endif
+
+class AsioEventHandler {
+public:
+    static constexpr unsigned int max_batches = 16;
+
+    AsioEventHandler(asio::any_io_executor executor, JsEventHandler & event_handler)
+        : event_handler_(event_handler), descriptor_(executor, event_handler.js) {}
+
+    AsioEventHandler(const AsioEventHandler &) = delete;
+    AsioEventHandler & operator=(const AsioEventHandler &) = delete;
+
+    ~AsioEventHandler()
+    {
+        stop();
+        descriptor_.release();
+    }
+
+    void start(std::function<void(JsResult)> stop_action = {})
+    {
+        stop_action_ = std::move(stop_action);
+        js_init_event_handler(&event_handler_);
+        wait();
+    }
+
+    void stop()
+    {
+        event_handler_.is_running = false;
+        descriptor_.cancel();
+    }
+
+private:
+    void wait()
+    {
+        descriptor_.async_wait(asio::posix::stream_descriptor::wait_read, [this](const auto & error) {
+            if (error == asio::error::operation_aborted || !event_handler_.is_running) {
+                return;
+            }
+            JsResult r = error ? JsResult_failure : JsResult_success;
+            for (unsigned int i=0; r == JsResult_success && i<max_batches; ++i) {
+                r = js_process_ready(&event_handler_);
+            }
+            if (r == JsResult_stop || r == JsResult_failure) {
+                event_handler_.is_running = false;
+                if (stop_action_) {
+                    stop_action_(r);
+                }
+                return;
+            }
+            wait();
+        });
+    }
+
+    JsEventHandler & event_handler_;
+    asio::posix::stream_descriptor descriptor_;
+    std::function<void(JsResult)> stop_action_;
+};
+
+} /* namespace js */
+
+#endif
@@ -0,0 +1,448 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <sys/inotify.h>
+
+#include "js_config.h"
+#include "js_deadzone.h"
+
+/****************************************************************************************************
+ *
+ * Input Conditioning Configuration
+ *
+ ***************************************************************************************************/
+
+#define js_config_max_line_length 256
+
+void js_init_config(JsConfig * config)
+{
+    for (size_t i=0; i<256; ++i) {
+        config->button_map[i] = (uint8_t) i;
+        config->axis_map[i] = (uint8_t) i;
+        config->invert[i] = false;
+        config->deadzone[i] = 0;
+        config->rescale[i] = true;
+        config->jitter[i] = 0;
+    }
+}
+
+/* parses a number in [min, max] or (if all is true) * for [0, 255] */
+static JsResult js_parse_range(const char * token, bool all, long min, long max, long * first, long * last)
+{
+    if (!token) {
+        return JsResult_failure;
+    }
+    if (all && strcmp(token, "*") == 0) {
+        *first = 0;
+        *last = 255;
+        return JsResult_success;
+    }
+
+    char * end;
+    errno = 0;
+    const long value = strtol(token, &end, 10);
+    if (errno != 0 || end == token || *end != '\0' || value < min || value > max) {
+        return JsResult_failure;
+    }
+    *first = *last = value;
+    return JsResult_success;
+}
+
+JsResult js_parse_config_line(JsConfig * config, const char * line)
+{
+    char buffer[js_config_max_line_length];
+    if (strlen(line) >= sizeof(buffer)) {
+        return JsResult_failure;
+    }
+    strcpy(buffer, line);
+    char * const comment = strchr(buffer, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+
+    static const char * const separators = " \t\r\n";
+    char * state;
+    const char * const keyword = strtok_r(buffer, separators, &state);
+    if (!keyword) {
+        return JsResult_success;
+    }
+
+    long first, last, value, unused;
+    const char * argument;
+
+    if (strcmp(keyword, "remap") == 0) {
+        const char * const kind = strtok_r(nullptr, separators, &state);
+        uint8_t * map;
+        if (kind && strcmp(kind, "button") == 0) {
+            map = config->button_map;
+        }
+        else if (kind && strcmp(kind, "axis") == 0) {
+            map = config->axis_map;
+        }
+        else {
+            return JsResult_failure;
+        }
+        if (js_parse_range(strtok_r(nullptr, separators, &state), true, 0, 255, &first, &last) != JsResult_success) {
+            return JsResult_failure;
+        }
+        argument = strtok_r(nullptr, separators, &state);
+        if (argument && strcmp(argument, "drop") == 0) {
+            value = js_config_drop;
+        }
+        /* js_config_drop is not a valid target number */
+        else if (js_parse_range(argument, false, 0, js_config_drop - 1, &value, &unused) != JsResult_success) {
+            return JsResult_failure;
+        }
+        for (long i=first; i<=last; ++i) {
+            map[i] = (uint8_t) value;
+        }
+    }
+    else if (strcmp(keyword, "invert") == 0) {
+        if (js_parse_range(strtok_r(nullptr, separators, &state), true, 0, 255, &first, &last) != JsResult_success) {
+            return JsResult_failure;
+        }
+        for (long i=first; i<=last; ++i) {
+            config->invert[i] = true;
+        }
+    }
+    else if (strcmp(keyword, "deadzone") == 0) {
+        if (js_parse_range(strtok_r(nullptr, separators, &state), true, 0, 255, &first, &last) != JsResult_success
+            || js_parse_range(strtok_r(nullptr, separators, &state), false, 0, js_max_deadzone, &value, &unused) != JsResult_success) {
+            return JsResult_failure;
+        }
+        argument = strtok_r(nullptr, separators, &state);
+        if (argument && strcmp(argument, "norescale") != 0) {
+            return JsResult_failure;
+        }
+        for (long i=first; i<=last; ++i) {
+            config->deadzone[i] = (int16_t) value;
+            config->rescale[i] = !argument;
+        }
+    }
+    else if (strcmp(keyword, "jitter") == 0) {
+        if (js_parse_range(strtok_r(nullptr, separators, &state), true, 0, 255, &first, &last) != JsResult_success
+            || js_parse_range(strtok_r(nullptr, separators, &state), false, 0, 32767, &value, &unused) != JsResult_success) {
+            return JsResult_failure;
+        }
+        for (long i=first; i<=last; ++i) {
+            config->jitter[i] = (int16_t) value;
+        }
+    }
+    else {
+        return JsResult_failure;
+    }
+
+    /* trailing garbage */
+    return strtok_r(nullptr, separators, &state) ? JsResult_failure : JsResult_success;
+}
+
+JsResult js_load_config(JsConfig * config, const char * path, size_t * error_line)
+{
+    size_t line_number = 0;
+
+    FILE * const file = fopen(path, "re");
+    if (!file) {
+        goto load_error;
+    }
+
+    js_init_config(config);
+
+    char line[js_config_max_line_length];
+    while (fgets(line, sizeof(line), file)) {
+        ++line_number;
+        /* lines that do not fit into the buffer are invalid */
+        const bool is_complete = strchr(line, '\n') || feof(file);
+        if (!is_complete || js_parse_config_line(config, line) != JsResult_success) {
+            goto load_error;
+        }
+    }
+    if (ferror(file)) {
+        line_number = 0;
+        goto load_error;
+    }
+
+    fclose(file);
+    return JsResult_success;
+
+    load_error:
+    if (file) {
+        fclose(file);
+    }
+    if (error_line) {
+        *error_line = line_number;
+    }
+    return JsResult_failure;
+}
+
+/* returns false if the event is dropped */
+static bool js_apply_config(const JsConfig * config, int16_t * axes, JsEvent * event)
+{
+    if (event->type & JS_EVENT_BUTTON) {
+        const uint8_t n = config->button_map[event->number];
+        event->number = n;
+        return n != js_config_drop;
+    }
+
+    const uint8_t n = config->axis_map[event->number];
+    if (n == js_config_drop) {
+        return false;
+    }
+    event->number = n;
+
+    int32_t v = event->value;
+    if (config->invert[n]) {
+        v = v == INT16_MIN ? INT16_MAX : -v;
+    }
+
+    v = js_apply_deadzone((int16_t) v, config->deadzone[n], config->rescale[n]);
+
+    const int32_t d = v - axes[n];
+    if (!(event->type & JS_EVENT_INIT) && v != 0 && v > -32767 && v < 32767 && (d < 0 ? -d : d) < config->jitter[n]) {
+        return false;
+    }
+
+    axes[n] = (int16_t) v;
+    event->value = (int16_t) v;
+    return true;
+}
+
+/****************************************************************************************************
+ *
+ * Live Reconfiguration
+ *
+ ***************************************************************************************************/
+
+/* every published configuration is allocated as a node (config being the first member) */
+struct JsConfigNode {
+    JsConfig config;
+    /* reader sequence observed when the configuration was retired */
+    uint_fast64_t sequence;
+    struct JsConfigNode * next;
+};
+
+JsResult js_create_live_config(JsLiveConfig * live_config, const JsConfig * config)
+{
+    struct JsConfigNode * const node = (struct JsConfigNode*) malloc(sizeof(struct JsConfigNode));
+    if (!node) {
+        return JsResult_failure;
+    }
+    if (config) {
+        node->config = *config;
+    }
+    else {
+        js_init_config(&node->config);
+    }
+
+    if (mtx_init(&live_config->lock, mtx_plain) != thrd_success) {
+        free(node);
+        return JsResult_failure;
+    }
+
+    atomic_init(&live_config->config, &node->config);
+    atomic_init(&live_config->reader_sequence, 0);
+    memset(live_config->axes, 0, sizeof(live_config->axes));
+    live_config->retired = nullptr;
+
+    return JsResult_success;
+}
+
+static void js_live_config_reclaim_locked(JsLiveConfig * live_config)
+{
+    const uint_fast64_t sequence = atomic_load(&live_config->reader_sequence);
+
+    struct JsConfigNode ** pnode = &live_config->retired;
+    while (*pnode) {
+        struct JsConfigNode * const node = *pnode;
+        /* the event path was not using a configuration when node was retired or has finished since */
+        if (!(node->sequence & 1) || node->sequence != sequence) {
+            *pnode = node->next;
+            free(node);
+        }
+        else {
+            pnode = &node->next;
+        }
+    }
+}
+
+void js_destroy_live_config(JsLiveConfig * live_config)
+{
+    free((struct JsConfigNode*) atomic_load(&live_config->config));
+    while (live_config->retired) {
+        struct JsConfigNode * const node = live_config->retired;
+        live_config->retired = node->next;
+        free(node);
+    }
+    mtx_destroy(&live_config->lock);
+}
+
+JsResult js_publish_config(JsLiveConfig * live_config, const JsConfig * config)
+{
+    struct JsConfigNode * const node = (struct JsConfigNode*) malloc(sizeof(struct JsConfigNode));
+    if (!node) {
+        return JsResult_failure;
+    }
+    node->config = *config;
+
+    if (mtx_lock(&live_config->lock) != thrd_success) {
+        free(node);
+        return JsResult_failure;
+    }
+
+    /* both sequentially consistent: either the event path has already entered (and the sequence is
+     * odd) or it will load the new configuration */
+    struct JsConfigNode * const previous = (struct JsConfigNode*) atomic_exchange(&live_config->config, &node->config);
+    previous->sequence = atomic_load(&live_config->reader_sequence);
+    previous->next = live_config->retired;
+    live_config->retired = previous;
+    js_live_config_reclaim_locked(live_config);
+
+    return mtx_unlock(&live_config->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+void js_live_config_reclaim(JsLiveConfig * live_config)
+{
+    if (mtx_lock(&live_config->lock) == thrd_success) {
+        js_live_config_reclaim_locked(live_config);
+        mtx_unlock(&live_config->lock);
+    }
+}
+
+JsResult js_live_config_event_action(const JsEvent * event, void * arg)
+{
+    JsLiveConfig * const live_config = (JsLiveConfig*) arg;
+
+    JsEvent e = *event;
+    const uint_fast64_t s = atomic_load_explicit(&live_config->reader_sequence, memory_order_relaxed);
+    atomic_store(&live_config->reader_sequence, s + 1);
+    const bool is_delivered = js_apply_config(atomic_load(&live_config->config), live_config->axes, &e);
+    atomic_store_explicit(&live_config->reader_sequence, s + 2, memory_order_release);
+
+    if (!is_delivered) {
+        return JsResult_success;
+    }
+    return live_config->event_action ? live_config->event_action(&e, live_config->event_action_arg) : JsResult_success;
+}
+
+/****************************************************************************************************
+ *
+ * Profile Hot Reload
+ *
+ ***************************************************************************************************/
+
+static JsResult js_config_watcher_reload(JsConfigWatcher * watcher)
+{
+    JsConfig config;
+    size_t error_line = 0;
+    JsResult r = js_load_config(&config, watcher->path, &error_line);
+    if (r == JsResult_success) {
+        r = js_publish_config(watcher->live_config, &config);
+    }
+    if (watcher->reload_action) {
+        watcher->reload_action(r, error_line, watcher->reload_action_arg);
+    }
+    return r;
+}
+
+static int js_config_watcher_main(void * arg)
+{
+    JsConfigWatcher * const watcher = (JsConfigWatcher*) arg;
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (watcher->is_running) {
+        struct pollfd p = {.fd = watcher->fd, .events = POLLIN};
+        const int ready = poll(&p, 1, js_config_watcher_period);
+        if (ready < 0 && errno != EINTR) {
+            goto exit_failure;
+        }
+
+        bool is_modified = false;
+        ssize_t n;
+        while ((n = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t i=0; i<n; ) {
+                const struct inotify_event * const event = (const struct inotify_event*) &buffer[i];
+                if (event->len && strcmp(event->name, watcher->name) == 0) {
+                    is_modified = true;
+                }
+                i += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            goto exit_failure;
+        }
+
+        /* invalid profiles are reported and ignored */
+        if (is_modified) {
+            js_config_watcher_reload(watcher);
+        }
+        js_live_config_reclaim(watcher->live_config);
+    }
+
+    return EXIT_SUCCESS;
+
+    exit_failure:
+    watcher->is_running = false;
+    return EXIT_FAILURE;
+}
+
+JsResult js_create_config_watcher(JsConfigWatcher * watcher, JsLiveConfig * live_config, const char * path)
+{
+    watcher->live_config = live_config;
+    watcher->path = strdup(path);
+    if (!watcher->path) {
+        return JsResult_failure;
+    }
+
+    /* watch the directory, since editors usually replace the file */
+    char * const slash = strrchr(watcher->path, '/');
+    watcher->name = slash ? slash + 1 : watcher->path;
+    char * const directory = slash ? strndup(watcher->path, slash == watcher->path ? 1 : (size_t) (slash - watcher->path)) : strdup(".");
+    if (!directory) {
+        goto directory_error;
+    }
+
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+        goto init_error;
+    }
+    if (inotify_add_watch(watcher->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0
+        || js_config_watcher_reload(watcher) != JsResult_success) {
+        goto watch_error;
+    }
+
+    atomic_init(&watcher->is_running, true);
+    if (thrd_create(&watcher->thread_id, js_config_watcher_main, (void*) watcher) != thrd_success) {
+        goto watch_error;
+    }
+
+    free(directory);
+    return JsResult_success;
+
+    watch_error:
+    close(watcher->fd);
+    init_error:
+    free(directory);
+    directory_error:
+    free(watcher->path);
+    return JsResult_failure;
+}
+
+JsResult js_destroy_config_watcher(JsConfigWatcher * watcher)
+{
+    watcher->is_running = false;
+
+    int return_val;
+    const int join_result = thrd_join(watcher->thread_id, &return_val);
+
+    close(watcher->fd);
+    free(watcher->path);
+
+    return (
+        join_result == thrd_success && return_val == EXIT_SUCCESS
+        ? JsResult_success
+        : JsResult_failure
+    );
+}
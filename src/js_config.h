@@ -0,0 +1,138 @@
+#ifndef JS_CONFIG_H
+#define JS_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Input Conditioning Configuration
+ *
+ ***************************************************************************************************/
+
+/* mapping a number to js_config_drop drops its events */
+#define js_config_drop 0xFF
+
+/*
+ * Each event is processed in the following order: the button/axis number is remapped, then (for
+ * axis events, using the new number) the value is inverted, the deadzone is applied (values within
+ * the radius become 0 and the remaining range is optionally rescaled to the full range) and the
+ * jitter filter drops events that change the value by less than the threshold (0, the extreme
+ * values and synthetic events always pass).
+ */
+typedef struct JsConfig {
+    uint8_t button_map[256];
+    uint8_t axis_map[256];
+    bool invert[256];
+    int16_t deadzone[256];
+    bool rescale[256];
+    int16_t jitter[256];
+} JsConfig;
+
+/* identity mapping, no conditioning */
+void js_init_config(JsConfig * config);
+
+/*
+ * Profile files consist of lines of the form (axis/button being a number or * for all of them,
+ * # starting a comment):
+ *
+ *     remap button <button> <button|drop>
+ *     remap axis <axis> <axis|drop>
+ *     invert <axis>
+ *     deadzone <axis> <radius> [norescale]
+ *     jitter <axis> <threshold>
+ *
+ * Settings not mentioned keep the defaults of js_init_config. On failure, error_line (if not null)
+ * is set to the number of the first invalid line (0 if the file could not be read).
+ */
+JsResult js_parse_config_line(JsConfig * config, const char * line);
+JsResult js_load_config(JsConfig * config, const char * path, size_t * error_line);
+
+/****************************************************************************************************
+ *
+ * Live Reconfiguration
+ *
+ ***************************************************************************************************/
+
+/*
+ * A JsLiveConfig applies a JsConfig to the events of an event handler and allows replacing the
+ * configuration at any time from any thread without pausing the event handler. The event path is
+ * lock-free: it marks itself as active (reader sequence), loads the current configuration pointer
+ * and applies it. Publishing copies the configuration, swaps the pointer and retires the previous
+ * copy, which is freed once the event path is known to have stopped using it (deferred
+ * reclamation, checked on each publish, by js_live_config_reclaim and on destruction).
+ *
+ * Each JsLiveConfig must be used by a single event handler.
+ */
+
+typedef struct JsLiveConfig {
+    /* optional callback executed for each (conditioned) event that has not been dropped */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    _Atomic(const JsConfig *) config;
+    /* odd while the event path uses a configuration */
+    atomic_uint_fast64_t reader_sequence;
+    /* last delivered value of each axis (jitter filter, only accessed by the event path) */
+    int16_t axes[256];
+    /* configurations waiting to be freed (protected by lock) */
+    struct JsConfigNode * retired;
+    mtx_t lock;
+} JsLiveConfig;
+
+/* the initial configuration is copied (null for the defaults of js_init_config) */
+JsResult js_create_live_config(JsLiveConfig * live_config, const JsConfig * config);
+/* must not be called while the event handler is still using the JsLiveConfig */
+void js_destroy_live_config(JsLiveConfig * live_config);
+/* replace the configuration (copied, takes effect with the next event) */
+JsResult js_publish_config(JsLiveConfig * live_config, const JsConfig * config);
+/* free retired configurations that are no longer in use */
+void js_live_config_reclaim(JsLiveConfig * live_config);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsLiveConfig) */
+JsResult js_live_config_event_action(const JsEvent * event, void * arg);
+
+/****************************************************************************************************
+ *
+ * Profile Hot Reload
+ *
+ ***************************************************************************************************/
+
+/* interval (in ms) at which the watcher checks for termination and reclaims configurations */
+#define js_config_watcher_period 100
+
+/*
+ * A JsConfigWatcher loads a profile file into a JsLiveConfig and reloads it (in a secondary thread
+ * using inotify) whenever the file is written or replaced (e.g. by an editor renaming a temporary
+ * file). Invalid profiles are reported and ignored, so the previous configuration stays in effect.
+ */
+typedef struct JsConfigWatcher {
+    /* optional callback executed after each reload (error_line as for js_load_config) */
+    void (*reload_action)(JsResult result, size_t error_line, void * arg);
+    void * reload_action_arg;
+
+    /* internal state (must not be modified) */
+    JsLiveConfig * live_config;
+    char * path;
+    /* file name within the watched directory */
+    const char * name;
+    int fd;
+    thrd_t thread_id;
+    atomic_bool is_running;
+} JsConfigWatcher;
+
+/* loads the profile (failing if it is invalid) and starts watching it; reload_action (if any) has to
+ * be set before */
+JsResult js_create_config_watcher(JsConfigWatcher * watcher, JsLiveConfig * live_config, const char * path);
+JsResult js_destroy_config_watcher(JsConfigWatcher * watcher);
+
+#pragma GCC visibility pop
+
+#endif
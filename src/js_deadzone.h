@@ -0,0 +1,37 @@
+#ifndef JS_DEADZONE_H
+#define JS_DEADZONE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************************************
+ *
+ * Deadzone
+ *
+ ***************************************************************************************************/
+
+/*
+ * Shared by the C++ pipeline (js_pipeline.hpp) and live reconfiguration (js_config.h), and therefore
+ * independent of js.h: values whose magnitude is at most radius become 0, the remaining range is
+ * optionally rescaled to the full range. The magnitude is limited to 32767 (so -32768 is treated like
+ * -32767) and a radius above js_max_deadzone removes the whole range, so the result always fits into
+ * an int16_t and the rescaling never divides by zero.
+ */
+
+#define js_max_deadzone 32766
+
+static inline int16_t js_apply_deadzone(int16_t value, int32_t radius, bool rescale)
+{
+    const int32_t v = value;
+    const int32_t a = v < 0 ? (v == INT16_MIN ? INT16_MAX : -v) : v;
+    if (a <= radius) {
+        return 0;
+    }
+    if (!rescale || radius <= 0) {
+        return value;
+    }
+    const int32_t scaled = (a - radius) * INT16_MAX / (INT16_MAX - radius);
+    return (int16_t) (v < 0 ? -scaled : scaled);
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "js_features.h"
+
+/****************************************************************************************************
+ *
+ * Sliding-Window Feature Extraction
+ *
+ ***************************************************************************************************/
+
+JsResult js_create_feature_extractor(JsFeatureExtractor * extractor, uint32_t window, size_t capacity,
+    uint8_t number_of_axes, uint8_t number_of_buttons, int16_t reversal_threshold)
+{
+    if (window == 0 || capacity == 0
+        || number_of_axes > js_max_number_of_axes || number_of_buttons > js_max_number_of_buttons) {
+        return JsResult_failure;
+    }
+
+    extractor->window = window;
+    extractor->number_of_axes = number_of_axes;
+    extractor->number_of_buttons = number_of_buttons;
+    extractor->reversal_threshold = reversal_threshold;
+    extractor->capacity = capacity;
+    extractor->first = 0;
+    extractor->number_of_samples = 0;
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        extractor->axes[i] = (JsAxisFeatures){};
+    }
+    for (size_t i=0; i<js_max_number_of_buttons; ++i) {
+        extractor->number_of_presses[i] = 0;
+    }
+
+    extractor->samples = (JsFeatureSample*) malloc(capacity * sizeof(JsFeatureSample));
+    if (!extractor->samples) {
+        return JsResult_failure;
+    }
+    if (mtx_init(&extractor->lock, mtx_plain) != thrd_success) {
+        free(extractor->samples);
+        return JsResult_failure;
+    }
+
+    return JsResult_success;
+}
+
+void js_destroy_feature_extractor(JsFeatureExtractor * extractor)
+{
+    mtx_destroy(&extractor->lock);
+    free(extractor->samples);
+}
+
+/* remove the oldest sample from the running sums */
+static void js_feature_extractor_pop(JsFeatureExtractor * extractor)
+{
+    const JsFeatureSample * const sample = &extractor->samples[extractor->first];
+
+    if (sample->type & JS_EVENT_AXIS) {
+        JsAxisFeatures * const axis = &extractor->axes[sample->number];
+        --axis->number_of_samples;
+        axis->sum -= sample->value;
+        axis->sum_of_squares -= ((int64_t) sample->value) * sample->value;
+        axis->sum_of_squared_velocities -= sample->squared_velocity;
+        axis->number_of_reversals -= sample->is_reversal;
+        if (axis->number_of_samples == 0) {
+            /* avoid accumulating rounding errors */
+            axis->sum_of_squared_velocities = 0.0;
+        }
+    }
+    else {
+        --extractor->number_of_presses[sample->number];
+    }
+
+    extractor->first = (extractor->first + 1) % extractor->capacity;
+    --extractor->number_of_samples;
+}
+
+static void js_feature_extractor_push(JsFeatureExtractor * extractor, const JsEvent * event)
+{
+    JsFeatureSample sample = {
+        .time = event->time,
+        .value = event->value,
+        .type = event->type,
+        .number = event->number
+    };
+
+    if (event->type & JS_EVENT_AXIS) {
+        JsAxisFeatures * const axis = &extractor->axes[event->number];
+        if (axis->has_value) {
+            const int32_t delta = ((int32_t) event->value) - axis->value;
+            const uint32_t dt = event->time - axis->time;
+            const float velocity = ((float) delta) / 32767.0f * 1000.0f / (dt ? dt : 1);
+            sample.squared_velocity = velocity * velocity;
+
+            /* hysteresis: the direction changes once the value has retreated from the extremum
+             * reached in the current direction by more than the threshold (in one or many steps) */
+            const int32_t offset = ((int32_t) event->value) - axis->extremum;
+            if (axis->direction == 0) {
+                /* first motion (no reversal) */
+                if (offset > extractor->reversal_threshold || offset < -extractor->reversal_threshold) {
+                    axis->direction = offset > 0 ? 1 : -1;
+                    axis->extremum = event->value;
+                }
+            }
+            else if (offset * axis->direction > 0) {
+                axis->extremum = event->value;
+            }
+            else if (-offset * axis->direction > extractor->reversal_threshold) {
+                sample.is_reversal = true;
+                axis->direction = -axis->direction;
+                axis->extremum = event->value;
+            }
+        }
+        else {
+            axis->extremum = event->value;
+        }
+        axis->value = event->value;
+        axis->time = event->time;
+        axis->has_value = true;
+
+        ++axis->number_of_samples;
+        axis->sum += sample.value;
+        axis->sum_of_squares += ((int64_t) sample.value) * sample.value;
+        axis->sum_of_squared_velocities += sample.squared_velocity;
+        axis->number_of_reversals += sample.is_reversal;
+    }
+    else {
+        ++extractor->number_of_presses[event->number];
+    }
+
+    if (extractor->number_of_samples == extractor->capacity) {
+        js_feature_extractor_pop(extractor);
+    }
+    extractor->samples[(extractor->first + extractor->number_of_samples) % extractor->capacity] = sample;
+    ++extractor->number_of_samples;
+}
+
+JsResult js_feature_extractor_update(JsFeatureExtractor * extractor, const JsEvent * event)
+{
+    const bool is_axis = event->type & JS_EVENT_AXIS;
+    if ((is_axis && event->number >= extractor->number_of_axes)
+        || (!is_axis && event->number >= extractor->number_of_buttons)) {
+        return JsResult_success;
+    }
+
+    if (mtx_lock(&extractor->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    if (event->type & JS_EVENT_INIT) {
+        if (is_axis) {
+            if (!extractor->axes[event->number].direction) {
+                extractor->axes[event->number].extremum = event->value;
+            }
+            extractor->axes[event->number].value = event->value;
+            extractor->axes[event->number].time = event->time;
+            extractor->axes[event->number].has_value = true;
+        }
+    }
+    /* only presses are counted for buttons */
+    else if (is_axis || event->value) {
+        js_feature_extractor_push(extractor, event);
+    }
+
+    /* slide the window (modulo 2^32 ms) */
+    while (extractor->number_of_samples
+        && event->time - extractor->samples[extractor->first].time >= extractor->window
+        && event->time - extractor->samples[extractor->first].time < (1u << 31)) {
+        js_feature_extractor_pop(extractor);
+    }
+
+    return mtx_unlock(&extractor->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+JsResult js_feature_extractor_event_action(const JsEvent * event, void * arg)
+{
+    JsFeatureExtractor * const extractor = (JsFeatureExtractor*) arg;
+
+    if (js_feature_extractor_update(extractor, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    return extractor->event_action ? extractor->event_action(event, extractor->event_action_arg) : JsResult_success;
+}
+
+size_t js_feature_vector_size(const JsFeatureExtractor * extractor)
+{
+    return (
+        js_features_per_axis * (size_t) extractor->number_of_axes
+        + js_features_per_button * (size_t) extractor->number_of_buttons
+    );
+}
+
+JsResult js_get_features(JsFeatureExtractor * extractor, float * features)
+{
+    if (mtx_lock(&extractor->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    for (uint8_t i=0; i<extractor->number_of_axes; ++i) {
+        const JsAxisFeatures * const axis = &extractor->axes[i];
+        float * const f = &features[js_features_per_axis * i];
+        if (axis->number_of_samples) {
+            const double n = (double) axis->number_of_samples;
+            const double mean = ((double) axis->sum) / n;
+            const double variance = ((double) axis->sum_of_squares) / n - mean * mean;
+            const double squared_velocity = axis->sum_of_squared_velocities / n;
+            f[0] = (float) (mean / 32767.0);
+            f[1] = variance > 0.0 ? (float) (variance / (32767.0 * 32767.0)) : 0.0f;
+            f[2] = squared_velocity > 0.0 ? (float) sqrt(squared_velocity) : 0.0f;
+        }
+        else {
+            f[0] = ((float) axis->value) / 32767.0f;
+            f[1] = 0.0f;
+            f[2] = 0.0f;
+        }
+        f[3] = (float) axis->number_of_reversals;
+    }
+
+    float * const b = &features[js_features_per_axis * extractor->number_of_axes];
+    for (uint8_t i=0; i<extractor->number_of_buttons; ++i) {
+        b[i] = ((float) extractor->number_of_presses[i]) * 1000.0f / extractor->window;
+    }
+
+    return mtx_unlock(&extractor->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
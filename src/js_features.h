@@ -0,0 +1,100 @@
+#ifndef JS_FEATURES_H
+#define JS_FEATURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Sliding-Window Feature Extraction
+ *
+ ***************************************************************************************************/
+
+/*
+ * A feature extractor maintains features over the events of the last window ms (relative to the
+ * most recent event) incrementally: each event is added to running sums and the events leaving the
+ * window are subtracted again, so an update costs O(1) (amortized) regardless of the window size.
+ * The feature vector consists of
+ *
+ *     for each axis:   mean, variance, rms velocity, number of reversals
+ *     for each button: presses per second
+ *
+ * where mean and variance are taken over the axis values of the events in the window (normalized
+ * to [-1, 1], an axis without events in the window contributes its current value and variance 0),
+ * the velocity of an event is the change of the normalized value per second since the previous
+ * event of the axis, and a reversal is a change of the direction of motion with hysteresis: it is
+ * counted once the value has retreated from the extremum reached in the current direction by more
+ * than reversal_threshold (in raw units), whether in a single event or in many small steps.
+ * Synthetic (JS_EVENT_INIT) events only set the current values.
+ */
+
+#define js_features_per_axis 4
+#define js_features_per_button 1
+
+typedef struct JsFeatureSample {
+    uint32_t time;
+    int16_t value;
+    uint8_t type;
+    uint8_t number;
+    bool is_reversal;
+    float squared_velocity;
+} JsFeatureSample;
+
+typedef struct JsAxisFeatures {
+    uint32_t number_of_samples;
+    int64_t sum;
+    int64_t sum_of_squares;
+    double sum_of_squared_velocities;
+    uint32_t number_of_reversals;
+    int16_t value;
+    uint32_t time;
+    /* direction of motion (0 until the axis first moved by more than the threshold) and the extremum
+     * reached in it (the starting value while there is no direction) */
+    int direction;
+    int16_t extremum;
+    bool has_value;
+} JsAxisFeatures;
+
+typedef struct JsFeatureExtractor {
+    /* optional callback executed for each event (after the features have been updated) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    mtx_t lock;
+    uint32_t window;
+    uint8_t number_of_axes;
+    uint8_t number_of_buttons;
+    int16_t reversal_threshold;
+    JsFeatureSample * samples;
+    size_t capacity;
+    size_t first;
+    size_t number_of_samples;
+    JsAxisFeatures axes[js_max_number_of_axes];
+    uint32_t number_of_presses[js_max_number_of_buttons];
+} JsFeatureExtractor;
+
+/* window in ms, capacity: maximum number of events in the window (older events are dropped early) */
+JsResult js_create_feature_extractor(JsFeatureExtractor * extractor, uint32_t window, size_t capacity,
+    uint8_t number_of_axes, uint8_t number_of_buttons, int16_t reversal_threshold);
+void js_destroy_feature_extractor(JsFeatureExtractor * extractor);
+
+/* add an event to the window */
+JsResult js_feature_extractor_update(JsFeatureExtractor * extractor, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsFeatureExtractor) */
+JsResult js_feature_extractor_event_action(const JsEvent * event, void * arg);
+
+/* number of floats in the feature vector */
+size_t js_feature_vector_size(const JsFeatureExtractor * extractor);
+/* write the current feature vector (js_feature_vector_size floats) */
+JsResult js_get_features(JsFeatureExtractor * extractor, float * features);
+
+#pragma GCC visibility pop
+
+#endif
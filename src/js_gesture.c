@@ -0,0 +1,206 @@
+#include <math.h>
+
+#include "js_gesture.h"
+
+/****************************************************************************************************
+ *
+ * Stick Gesture Recognition
+ *
+ ***************************************************************************************************/
+
+static const float js_pi = 3.14159265358979f;
+
+void js_init_gesture_recognizer(JsGestureRecognizer * recognizer)
+{
+    recognizer->x = 0.0f;
+    recognizer->y = 0.0f;
+    recognizer->last_angle = 0.0f;
+    recognizer->is_outside_center = false;
+    recognizer->has_reached_edge = false;
+    recognizer->rotation = 0.0f;
+    recognizer->rotation_direction = 0;
+    if (recognizer->number_of_directions == 0) {
+        recognizer->number_of_directions = 4;
+    }
+    for (size_t i=0; i<js_max_number_of_gesture_templates; ++i) {
+        recognizer->rotations[i] = 0;
+    }
+}
+
+static int js_gesture_sector(const JsGestureRecognizer * recognizer, float angle)
+{
+    const int n = (int) recognizer->number_of_directions;
+    const int sector = (int) floorf(angle * n / (2.0f * js_pi) + 0.5f);
+    return (sector % n + n) % n;
+}
+
+static JsResult js_gesture_report(JsGestureRecognizer * recognizer, JsGesture * gesture)
+{
+    for (size_t i=0; i<recognizer->number_of_templates; ++i) {
+        const JsGestureTemplate * const t = &recognizer->templates[i];
+        if (t->type != gesture->type
+            || (t->direction != js_gesture_any_direction && t->direction != gesture->direction)
+            || (gesture->type != JsGestureType_rotation && t->max_duration && gesture->duration > t->max_duration)) {
+            continue;
+        }
+        gesture->template_index = i;
+        const JsResult r = recognizer->gesture_action(gesture, recognizer->gesture_action_arg);
+        if (r != JsResult_success) {
+            return r == JsResult_stop ? JsResult_stop : JsResult_failure;
+        }
+    }
+    return JsResult_success;
+}
+
+/* report rotation templates for which another multiple of their angle has been covered */
+static JsResult js_gesture_report_rotations(JsGestureRecognizer * recognizer, uint32_t time)
+{
+    const float rotation = fabsf(recognizer->rotation);
+    const uint32_t duration = time - recognizer->start_time;
+    JsGesture gesture = {
+        .type = JsGestureType_rotation,
+        .direction = recognizer->rotation > 0.0f ? js_gesture_counterclockwise : js_gesture_clockwise,
+        .angle = recognizer->rotation,
+        .velocity = rotation * 1000.0f / (duration ? duration : 1),
+        .duration = duration,
+        .time = time
+    };
+
+    /* the multiples are counted anew whenever the sense of rotation changes (i.e. the rotated angle
+     * passes through 0), so a reversal is reported after the full angle in the new sense */
+    if (gesture.direction != recognizer->rotation_direction) {
+        recognizer->rotation_direction = gesture.direction;
+        for (size_t i=0; i<recognizer->number_of_templates; ++i) {
+            recognizer->rotations[i] = 0;
+        }
+    }
+
+    for (size_t i=0; i<recognizer->number_of_templates; ++i) {
+        const JsGestureTemplate * const t = &recognizer->templates[i];
+        if (t->type != JsGestureType_rotation || t->min_angle <= 0.0f
+            || (t->direction != js_gesture_any_direction && t->direction != gesture.direction)) {
+            continue;
+        }
+        const uint32_t n = (uint32_t) (rotation / t->min_angle);
+        if (n <= recognizer->rotations[i]) {
+            continue;
+        }
+        recognizer->rotations[i] = n;
+        gesture.template_index = i;
+        const JsResult r = recognizer->gesture_action(&gesture, recognizer->gesture_action_arg);
+        if (r != JsResult_success) {
+            return r == JsResult_stop ? JsResult_stop : JsResult_failure;
+        }
+    }
+    return JsResult_success;
+}
+
+JsResult js_gesture_update(JsGestureRecognizer * recognizer, const JsEvent * event)
+{
+    if (!(event->type & JS_EVENT_AXIS) || (event->number != recognizer->x_axis && event->number != recognizer->y_axis)) {
+        return JsResult_success;
+    }
+
+    /* the y axis points down */
+    const float value = ((float) event->value) / 32767.0f;
+    if (event->number == recognizer->x_axis) {
+        recognizer->x = value;
+    }
+    else {
+        recognizer->y = -value;
+    }
+    if (event->type & JS_EVENT_INIT) {
+        return JsResult_success;
+    }
+
+    const float radius = sqrtf(recognizer->x * recognizer->x + recognizer->y * recognizer->y);
+
+    /* back in the center -> flick? */
+    if (radius < recognizer->inner_radius) {
+        JsResult r = JsResult_success;
+        if (recognizer->is_outside_center && recognizer->has_reached_edge && fabsf(recognizer->rotation) < 0.5f * js_pi) {
+            JsGesture gesture = {
+                .type = JsGestureType_flick,
+                .direction = js_gesture_sector(recognizer, recognizer->peak_angle),
+                .angle = recognizer->peak_angle,
+                .velocity = (
+                    (recognizer->outer_radius - recognizer->inner_radius) * 1000.0f
+                    / (recognizer->edge_time != recognizer->start_time ? recognizer->edge_time - recognizer->start_time : 1)
+                ),
+                .duration = event->time - recognizer->start_time,
+                .time = event->time
+            };
+            r = js_gesture_report(recognizer, &gesture);
+        }
+        recognizer->is_outside_center = false;
+        return r;
+    }
+
+    const float angle = atan2f(recognizer->y, recognizer->x);
+
+    /* leaving the center */
+    if (!recognizer->is_outside_center) {
+        recognizer->is_outside_center = true;
+        recognizer->has_reached_edge = false;
+        recognizer->start_time = event->time;
+        recognizer->last_angle = angle;
+        recognizer->peak_radius = radius;
+        recognizer->peak_angle = angle;
+        recognizer->rotation = 0.0f;
+        recognizer->rotation_direction = 0;
+        for (size_t i=0; i<recognizer->number_of_templates; ++i) {
+            recognizer->rotations[i] = 0;
+        }
+    }
+    else if (radius > recognizer->peak_radius) {
+        recognizer->peak_radius = radius;
+        recognizer->peak_angle = angle;
+    }
+
+    /* reaching the edge -> swipe? */
+    if (!recognizer->has_reached_edge && radius >= recognizer->outer_radius) {
+        recognizer->has_reached_edge = true;
+        recognizer->edge_time = event->time;
+        const uint32_t duration = event->time - recognizer->start_time;
+        JsGesture gesture = {
+            .type = JsGestureType_swipe,
+            .direction = js_gesture_sector(recognizer, angle),
+            .angle = angle,
+            .velocity = (recognizer->outer_radius - recognizer->inner_radius) * 1000.0f / (duration ? duration : 1),
+            .duration = duration,
+            .time = event->time
+        };
+        const JsResult r = js_gesture_report(recognizer, &gesture);
+        if (r != JsResult_success) {
+            return r;
+        }
+    }
+
+    /* accumulate the (unwrapped) rotation */
+    float delta = angle - recognizer->last_angle;
+    if (delta > js_pi) {
+        delta -= 2.0f * js_pi;
+    }
+    else if (delta < -js_pi) {
+        delta += 2.0f * js_pi;
+    }
+    recognizer->last_angle = angle;
+    if (delta != 0.0f) {
+        recognizer->rotation += delta;
+        return js_gesture_report_rotations(recognizer, event->time);
+    }
+
+    return JsResult_success;
+}
+
+JsResult js_gesture_event_action(const JsEvent * event, void * arg)
+{
+    JsGestureRecognizer * const recognizer = (JsGestureRecognizer*) arg;
+
+    const JsResult r = js_gesture_update(recognizer, event);
+    if (r != JsResult_success) {
+        return r;
+    }
+
+    return recognizer->event_action ? recognizer->event_action(event, recognizer->event_action_arg) : JsResult_success;
+}
@@ -0,0 +1,122 @@
+#ifndef JS_GESTURE_H
+#define JS_GESTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Stick Gesture Recognition
+ *
+ ***************************************************************************************************/
+
+/*
+ * A gesture recognizer tracks one stick (a pair of axes) at event rate. Each axis event updates the
+ * position in polar coordinates (radius in [0, 1], angle in radians with 0 pointing right and
+ * increasing counterclockwise, i.e. towards "up"), from which the following gestures are detected:
+ *
+ * + swipe: the stick is pushed from the center (radius < inner_radius) to the edge (radius >=
+ *   outer_radius) within the maximum duration of the template (reported as soon as the edge is
+ *   reached, the direction is the angle at the edge),
+ * + flick: the stick is pushed to the edge and released back into the center within the maximum
+ *   duration of the template without rotating (reported on release, the direction is the angle
+ *   at the largest radius),
+ * + rotation: the stick is rotated outside the center by at least the minimum angle of the
+ *   template (reported each time another multiple of the angle has been covered, the direction
+ *   is the sense of rotation).
+ *
+ * Directions of flicks and swipes are quantized to number_of_directions sectors (sector 0 is
+ * centered on "right", the following sectors proceed counterclockwise, e.g. 0 = right, 1 = up,
+ * 2 = left, 3 = down for 4 sectors). Every event is processed in constant time (one square root
+ * and one arctangent plus a pass over the templates when a gesture completes).
+ */
+
+#define js_max_number_of_gesture_templates 16
+
+/* matches every direction (templates) */
+#define js_gesture_any_direction -1
+/* senses of rotation */
+#define js_gesture_counterclockwise 1
+#define js_gesture_clockwise 2
+
+typedef enum {
+    JsGestureType_swipe,
+    JsGestureType_flick,
+    JsGestureType_rotation
+} JsGestureType;
+
+typedef struct JsGestureTemplate {
+    JsGestureType type;
+    /* sector (flicks/swipes), sense of rotation (rotations) or js_gesture_any_direction */
+    int direction;
+    /* maximum duration in ms from leaving the center (flicks/swipes) */
+    uint32_t max_duration;
+    /* minimum angle in radians (rotations) */
+    float min_angle;
+} JsGestureTemplate;
+
+typedef struct JsGesture {
+    JsGestureType type;
+    /* index of the matching template */
+    size_t template_index;
+    /* sector or sense of rotation */
+    int direction;
+    /* angle in radians (flicks/swipes) or rotated angle (rotations, negative if clockwise) */
+    float angle;
+    /* mean radial speed (flicks/swipes) or mean angular speed (rotations) per second */
+    float velocity;
+    /* time since leaving the center in ms */
+    uint32_t duration;
+    /* kernel time of the event completing the gesture */
+    uint32_t time;
+} JsGesture;
+
+typedef struct JsGestureRecognizer {
+    /* axes forming the stick */
+    uint8_t x_axis;
+    uint8_t y_axis;
+    /* radii (in [0, 1]) delimiting the center and the edge */
+    float inner_radius;
+    float outer_radius;
+    unsigned int number_of_directions;
+    JsGestureTemplate templates[js_max_number_of_gesture_templates];
+    size_t number_of_templates;
+    /* callback executed for each gesture matching a template (once per matching template) */
+    JsResult (*gesture_action)(const JsGesture * gesture, void * arg);
+    void * gesture_action_arg;
+    /* optional callback executed for each event (after the recognizer has been updated) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    float x;
+    float y;
+    float last_angle;
+    bool is_outside_center;
+    bool has_reached_edge;
+    uint32_t start_time;
+    uint32_t edge_time;
+    float peak_radius;
+    float peak_angle;
+    float rotation;
+    /* sense of the rotation counted by rotations (0 if none) */
+    int rotation_direction;
+    uint32_t rotations[js_max_number_of_gesture_templates];
+} JsGestureRecognizer;
+
+/* to be called after filling in the configuration fields and before the first event */
+void js_init_gesture_recognizer(JsGestureRecognizer * recognizer);
+/* update the recognizer with an event (events of other axes and buttons are ignored; returns
+ * JsResult_stop if gesture_action did) */
+JsResult js_gesture_update(JsGestureRecognizer * recognizer, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsGestureRecognizer) */
+JsResult js_gesture_event_action(const JsEvent * event, void * arg);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,580 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "js_hid.h"
+
+/****************************************************************************************************
+ *
+ * HID Report Descriptor Parsing
+ *
+ ***************************************************************************************************/
+
+/* item tags (including type) */
+#define js_hid_item_input 0x80
+#define js_hid_item_collection 0xA0
+#define js_hid_item_end_collection 0xC0
+#define js_hid_item_usage_page 0x04
+#define js_hid_item_logical_minimum 0x14
+#define js_hid_item_logical_maximum 0x24
+#define js_hid_item_report_size 0x74
+#define js_hid_item_report_id 0x84
+#define js_hid_item_report_count 0x94
+#define js_hid_item_push 0xA4
+#define js_hid_item_pop 0xB4
+#define js_hid_item_usage 0x08
+#define js_hid_item_usage_minimum 0x18
+#define js_hid_item_usage_maximum 0x28
+#define js_hid_long_item 0xFE
+
+#define js_hid_page_generic_desktop 0x01
+#define js_hid_page_simulation 0x02
+#define js_hid_page_button 0x09
+
+#define js_hid_max_usages 64
+#define js_hid_stack_depth 4
+
+/* kernel axis codes (ABS_*), which determine the order of the axes */
+#define js_hid_code_hat 16
+
+typedef struct JsHidGlobals {
+    uint32_t usage_page;
+    int32_t logical_minimum;
+    int32_t logical_maximum;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+} JsHidGlobals;
+
+typedef struct JsHidLocals {
+    uint32_t usages[js_hid_max_usages];
+    size_t number_of_usages;
+    uint32_t usage_minimum;
+    uint32_t usage_maximum;
+    bool has_usage_range;
+} JsHidLocals;
+
+/* returns the kernel axis code of an axis/hat usage or -1 */
+static int js_hid_axis_code(uint32_t usage)
+{
+    const uint32_t page = usage >> 16;
+    const uint32_t id = usage & 0xFFFF;
+
+    if (page == js_hid_page_generic_desktop) {
+        /* X, Y, Z, Rx, Ry, Rz, slider (throttle), dial (rudder), wheel */
+        if (id >= 0x30 && id <= 0x38) {
+            return (int) (id - 0x30);
+        }
+        if (id == 0x39) {
+            return js_hid_code_hat;
+        }
+    }
+    else if (page == js_hid_page_simulation) {
+        switch (id) {
+            case 0xBA: return 7;  /* rudder */
+            case 0xBB: return 6;  /* throttle */
+            case 0xC4: return 9;  /* accelerator (gas) */
+            case 0xC5: return 10; /* brake */
+            case 0xC8: return 8;  /* steering (wheel) */
+            default: break;
+        }
+    }
+    return -1;
+}
+
+static bool js_hid_is_joystick_application(uint32_t usage)
+{
+    /* joystick, gamepad, multi-axis controller */
+    return usage == 0x00010004 || usage == 0x00010005 || usage == 0x00010008;
+}
+
+static JsResult js_hid_add_field(JsHidPlan * plan, const JsHidGlobals * globals, uint32_t usage, uint32_t bit_offset, uint8_t * codes)
+{
+    const bool is_button = (usage >> 16) == js_hid_page_button;
+    const int code = js_hid_axis_code(usage);
+    const uint32_t button = (usage & 0xFFFF) - 1;
+    if ((is_button && (button >= js_max_number_of_buttons || (usage & 0xFFFF) == 0)) || (!is_button && code < 0)) {
+        return JsResult_nothing;
+    }
+    if (plan->number_of_fields == js_hid_max_fields || globals->report_size > 32) {
+        return JsResult_nothing;
+    }
+
+    JsHidField * const field = &plan->fields[plan->number_of_fields];
+    *field = (JsHidField){
+        .report_id = globals->report_id,
+        .type = is_button ? JsHidFieldType_button : code == js_hid_code_hat ? JsHidFieldType_hat : JsHidFieldType_axis,
+        .number = is_button ? (uint8_t) button : 0,
+        .bit_size = (uint8_t) globals->report_size,
+        .bit_offset = bit_offset,
+        .logical_minimum = globals->logical_minimum,
+        .logical_maximum = globals->logical_maximum,
+        .is_signed = globals->logical_minimum < 0
+    };
+    if (field->type == JsHidFieldType_axis && field->logical_maximum > field->logical_minimum) {
+        field->scale = (((int64_t) 65534) << 16) / ((int64_t) field->logical_maximum - field->logical_minimum);
+    }
+    codes[plan->number_of_fields] = is_button ? 0 : (uint8_t) code;
+    ++plan->number_of_fields;
+    return JsResult_success;
+}
+
+/* number the axes in the order of their codes (stable) and drop the axes that do not fit */
+static void js_hid_number_axes(JsHidPlan * plan, const uint8_t * codes)
+{
+    uint8_t number = 0;
+    for (unsigned int code=0; code<=js_hid_code_hat; ++code) {
+        for (size_t i=0; i<plan->number_of_fields; ++i) {
+            JsHidField * const field = &plan->fields[i];
+            if (field->type != JsHidFieldType_button && codes[i] == code) {
+                const uint8_t width = field->type == JsHidFieldType_hat ? 2 : 1;
+                /* marks fields without axis number for removal */
+                field->number = number + width <= js_max_number_of_axes ? number : UINT8_MAX;
+                number += field->number != UINT8_MAX ? width : 0;
+            }
+        }
+    }
+    plan->number_of_axes = number;
+
+    size_t j = 0;
+    for (size_t i=0; i<plan->number_of_fields; ++i) {
+        const JsHidField * const field = &plan->fields[i];
+        if (field->type == JsHidFieldType_button) {
+            if (field->number + 1 > plan->number_of_buttons) {
+                plan->number_of_buttons = field->number + 1;
+            }
+        }
+        else if (field->number == UINT8_MAX) {
+            continue;
+        }
+        plan->fields[j++] = *field;
+    }
+    plan->number_of_fields = j;
+}
+
+JsResult js_parse_hid_descriptor(JsHidPlan * plan, const uint8_t * descriptor, size_t size)
+{
+    *plan = (JsHidPlan){};
+
+    JsHidGlobals globals = {};
+    JsHidGlobals stack[js_hid_stack_depth];
+    size_t stack_size = 0;
+    JsHidLocals locals = {};
+    /* size of each input report in bits so far */
+    uint32_t report_bits[256] = {};
+    uint8_t codes[js_hid_max_fields];
+    /* collection depth and depth of the current joystick application collection (0 if none) */
+    size_t depth = 0;
+    size_t application_depth = 0;
+
+    for (size_t i=0; i<size; ) {
+        const uint8_t prefix = descriptor[i++];
+        if (prefix == js_hid_long_item) {
+            if (i + 2 > size) {
+                return JsResult_failure;
+            }
+            i += 2 + descriptor[i];
+            continue;
+        }
+        const size_t data_size = (prefix & 3) == 3 ? 4 : (prefix & 3);
+        if (i + data_size > size) {
+            return JsResult_failure;
+        }
+        uint32_t data = 0;
+        for (size_t j=0; j<data_size; ++j) {
+            data |= ((uint32_t) descriptor[i + j]) << (8 * j);
+        }
+        /* sign extension (for logical extrema) */
+        const int32_t signed_data = (
+            data_size == 1 ? (int8_t) data : data_size == 2 ? (int16_t) data : (int32_t) data
+        );
+        i += data_size;
+
+        switch (prefix & 0xFC) {
+            /* main items */
+            case js_hid_item_input: {
+                /* (checked before adding, so the bit offsets of a report never wrap around) */
+                if (globals.report_size > 8 * js_hid_max_report_size || globals.report_count > 8 * js_hid_max_report_size
+                    || (uint64_t) report_bits[globals.report_id] + (uint64_t) globals.report_size * globals.report_count
+                        > 8 * js_hid_max_report_size) {
+                    return JsResult_failure;
+                }
+                const bool is_constant = data & 1;
+                const bool is_variable = data & 2;
+                for (uint32_t j=0; j<globals.report_count; ++j) {
+                    const uint32_t bit_offset = report_bits[globals.report_id];
+                    report_bits[globals.report_id] += globals.report_size;
+                    if (is_constant || !is_variable || !application_depth || globals.report_size == 0) {
+                        continue;
+                    }
+                    uint32_t usage;
+                    if (locals.has_usage_range) {
+                        usage = locals.usage_minimum + j;
+                        if (usage > locals.usage_maximum) {
+                            usage = locals.usage_maximum;
+                        }
+                    }
+                    else if (locals.number_of_usages) {
+                        usage = locals.usages[j < locals.number_of_usages ? j : locals.number_of_usages - 1];
+                    }
+                    else {
+                        continue;
+                    }
+                    js_hid_add_field(plan, &globals, usage, bit_offset, codes);
+                }
+                locals = (JsHidLocals){};
+                break;
+            }
+            case js_hid_item_collection:
+                ++depth;
+                /* application collection */
+                if (data == 1 && !application_depth && locals.number_of_usages
+                    && js_hid_is_joystick_application(locals.usages[0])) {
+                    application_depth = depth;
+                }
+                locals = (JsHidLocals){};
+                break;
+            case js_hid_item_end_collection:
+                if (depth == 0) {
+                    return JsResult_failure;
+                }
+                if (depth == application_depth) {
+                    application_depth = 0;
+                }
+                --depth;
+                locals = (JsHidLocals){};
+                break;
+            case 0x90: /* output */
+            case 0xB0: /* feature */
+                locals = (JsHidLocals){};
+                break;
+
+            /* global items */
+            case js_hid_item_usage_page:
+                globals.usage_page = data;
+                break;
+            case js_hid_item_logical_minimum:
+                globals.logical_minimum = signed_data;
+                break;
+            case js_hid_item_logical_maximum:
+                /* many descriptors encode unsigned maxima (e.g. 0xFF in a single byte) */
+                globals.logical_maximum = (
+                    signed_data < globals.logical_minimum ? (int32_t) data : signed_data
+                );
+                break;
+            case js_hid_item_report_size:
+                globals.report_size = data;
+                break;
+            case js_hid_item_report_id:
+                if (data == 0 || data > 255) {
+                    return JsResult_failure;
+                }
+                globals.report_id = (uint8_t) data;
+                plan->has_report_ids = true;
+                break;
+            case js_hid_item_report_count:
+                globals.report_count = data;
+                break;
+            case js_hid_item_push:
+                if (stack_size == js_hid_stack_depth) {
+                    return JsResult_failure;
+                }
+                stack[stack_size++] = globals;
+                break;
+            case js_hid_item_pop:
+                if (stack_size == 0) {
+                    return JsResult_failure;
+                }
+                globals = stack[--stack_size];
+                break;
+
+            /* local items (usages without page refer to the current usage page) */
+            case js_hid_item_usage:
+                if (locals.number_of_usages < js_hid_max_usages) {
+                    locals.usages[locals.number_of_usages++] = data_size == 4 ? data : (globals.usage_page << 16) | data;
+                }
+                break;
+            case js_hid_item_usage_minimum:
+                locals.usage_minimum = data_size == 4 ? data : (globals.usage_page << 16) | data;
+                locals.has_usage_range = true;
+                break;
+            case js_hid_item_usage_maximum:
+                locals.usage_maximum = data_size == 4 ? data : (globals.usage_page << 16) | data;
+                locals.has_usage_range = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    for (size_t id=0; id<256; ++id) {
+        if (report_bits[id]) {
+            const size_t bytes = (report_bits[id] + 7) / 8 + (plan->has_report_ids ? 1 : 0);
+            if (bytes > js_hid_max_report_size) {
+                return JsResult_failure;
+            }
+            plan->report_sizes[id] = (uint16_t) bytes;
+        }
+    }
+
+    js_hid_number_axes(plan, codes);
+    return plan->number_of_fields ? JsResult_success : JsResult_failure;
+}
+
+/****************************************************************************************************
+ *
+ * Report Decoding
+ *
+ ***************************************************************************************************/
+
+/* extract bit_size (<= 32) bits starting at bit_offset (little endian, like all HID data) */
+static uint32_t js_hid_extract(const uint8_t * data, uint32_t bit_offset, uint8_t bit_size)
+{
+    const uint8_t * const first = &data[bit_offset / 8];
+    const uint32_t shift = bit_offset % 8;
+    const size_t number_of_bytes = (shift + bit_size + 7) / 8;
+
+    uint64_t bits = 0;
+    for (size_t i=0; i<number_of_bytes; ++i) {
+        bits |= ((uint64_t) first[i]) << (8 * i);
+    }
+    return (uint32_t) ((bits >> shift) & ((((uint64_t) 1) << bit_size) - 1));
+}
+
+JsResult js_decode_hid_report(const JsHidPlan * plan, const uint8_t * report, size_t size, JsState * state)
+{
+    uint8_t report_id = 0;
+    if (plan->has_report_ids) {
+        if (size == 0) {
+            return JsResult_failure;
+        }
+        report_id = report[0];
+        ++report;
+        --size;
+    }
+
+    /* hat directions (clockwise, starting at north) */
+    static const int8_t hat_x[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    static const int8_t hat_y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+    JsResult r = JsResult_nothing;
+    for (size_t i=0; i<plan->number_of_fields; ++i) {
+        const JsHidField * const field = &plan->fields[i];
+        if (field->report_id != report_id || (uint64_t) field->bit_offset + field->bit_size > (uint64_t) size * 8) {
+            continue;
+        }
+        r = JsResult_success;
+
+        const uint32_t bits = js_hid_extract(report, field->bit_offset, field->bit_size);
+        int32_t value = (int32_t) bits;
+        if (field->is_signed && field->bit_size < 32 && (bits >> (field->bit_size - 1)) & 1) {
+            value = (int32_t) (bits | ~((((uint32_t) 1) << field->bit_size) - 1));
+        }
+
+        switch (field->type) {
+            case JsHidFieldType_button:
+                if (value) {
+                    state->buttons |= ((uint32_t) 1) << field->number;
+                }
+                else {
+                    state->buttons &= ~(((uint32_t) 1) << field->number);
+                }
+                break;
+            case JsHidFieldType_axis: {
+                const int32_t v = (
+                    value < field->logical_minimum ? field->logical_minimum
+                    : value > field->logical_maximum ? field->logical_maximum
+                    : value
+                );
+                state->axes[field->number] = (int16_t) ((((((int64_t) v) - field->logical_minimum) * field->scale + 0x8000) >> 16) - 32767);
+                break;
+            }
+            case JsHidFieldType_hat: {
+                /* values outside the logical range (null state) center the hat, 4-way hats have 4 values */
+                const int64_t range = ((int64_t) field->logical_maximum) - field->logical_minimum + 1;
+                const int64_t d = ((int64_t) value) - field->logical_minimum;
+                if (d < 0 || d >= range || (range != 8 && range != 4)) {
+                    state->axes[field->number] = 0;
+                    state->axes[field->number + 1] = 0;
+                }
+                else {
+                    const size_t direction = (size_t) (range == 4 ? 2 * d : d);
+                    state->axes[field->number] = (int16_t) (hat_x[direction] * 32767);
+                    state->axes[field->number + 1] = (int16_t) (hat_y[direction] * 32767);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return r;
+}
+
+/****************************************************************************************************
+ *
+ * hidraw Backend
+ *
+ ***************************************************************************************************/
+
+int js_hid_connect(const char * path)
+{
+    return open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+JsResult js_get_hid_descriptor(int fd, uint8_t * descriptor, size_t capacity, size_t * size)
+{
+    int descriptor_size;
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &descriptor_size) != 0
+        || descriptor_size < 0 || (size_t) descriptor_size > capacity || descriptor_size > HID_MAX_DESCRIPTOR_SIZE) {
+        return JsResult_failure;
+    }
+
+    struct hidraw_report_descriptor d = {.size = (uint32_t) descriptor_size};
+    if (ioctl(fd, HIDIOCGRDESC, &d) != 0) {
+        return JsResult_failure;
+    }
+    memcpy(descriptor, d.value, d.size);
+    *size = d.size;
+    return JsResult_success;
+}
+
+JsResult js_open_hid_device(JsHidDevice * device, int fd, const uint8_t * descriptor, size_t descriptor_size)
+{
+    device->fd = fd;
+    device->state = (JsState){};
+    device->buffer_size = 0;
+    device->number_of_reports = 0;
+    device->is_stream = descriptor != nullptr;
+
+    if (!descriptor) {
+        uint8_t d[js_hid_max_descriptor_size];
+        size_t size;
+        if (js_get_hid_descriptor(fd, d, sizeof(d), &size) != JsResult_success) {
+            return JsResult_failure;
+        }
+        return js_parse_hid_descriptor(&device->plan, d, size);
+    }
+    return js_parse_hid_descriptor(&device->plan, descriptor, descriptor_size);
+}
+
+static uint32_t js_hid_time_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t) (((uint64_t) t.tv_sec) * 1000 + t.tv_nsec / 1'000'000);
+}
+
+static JsResult js_hid_emit(JsHidDevice * device, uint8_t type, uint8_t number, int16_t value)
+{
+    const JsEvent event = {
+        .time = device->state.time,
+        .value = value,
+        .type = type | (device->number_of_reports == 1 ? JS_EVENT_INIT : 0),
+        .number = number
+    };
+    return device->event_action(&event, device->event_action_arg);
+}
+
+static JsResult js_hid_handle_report(JsHidDevice * device, const uint8_t * report, size_t size)
+{
+    JsState state = device->state;
+    const JsResult r = js_decode_hid_report(&device->plan, report, size, &state);
+    if (r != JsResult_success) {
+        /* reports without joystick fields are ignored */
+        return r == JsResult_nothing ? JsResult_success : r;
+    }
+    state.time = js_hid_time_ms();
+
+    const JsState previous = device->state;
+    device->state = state;
+    ++device->number_of_reports;
+
+    if (device->event_action) {
+        const bool is_first = device->number_of_reports == 1;
+        for (uint8_t i=0; i<device->plan.number_of_buttons; ++i) {
+            const uint32_t bit = ((uint32_t) 1) << i;
+            if (is_first || ((state.buttons ^ previous.buttons) & bit)) {
+                const JsResult e = js_hid_emit(device, JS_EVENT_BUTTON, i, (state.buttons & bit) ? 1 : 0);
+                if (e != JsResult_success) {
+                    return e;
+                }
+            }
+        }
+        for (uint8_t i=0; i<device->plan.number_of_axes; ++i) {
+            if (is_first || state.axes[i] != previous.axes[i]) {
+                const JsResult e = js_hid_emit(device, JS_EVENT_AXIS, i, state.axes[i]);
+                if (e != JsResult_success) {
+                    return e;
+                }
+            }
+        }
+    }
+    return device->state_action ? device->state_action(&device->state, device->state_action_arg) : JsResult_success;
+}
+
+JsResult js_hid_process_ready(JsHidDevice * device)
+{
+    const size_t capacity = device->is_stream ? sizeof(device->buffer) - device->buffer_size : js_hid_max_report_size;
+    const ssize_t n = read(device->fd, &device->buffer[device->is_stream ? device->buffer_size : 0], capacity);
+    if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? JsResult_nothing : JsResult_failure;
+    }
+    /* end of a stream or disconnected device */
+    if (n == 0) {
+        return device->is_stream ? JsResult_stop : JsResult_failure;
+    }
+
+    /* hidraw delivers exactly one report per read */
+    if (!device->is_stream) {
+        return js_hid_handle_report(device, device->buffer, (size_t) n);
+    }
+
+    device->buffer_size += (size_t) n;
+    size_t offset = 0;
+    for (;;) {
+        const size_t available = device->buffer_size - offset;
+        const size_t size = (
+            !device->plan.has_report_ids ? device->plan.report_sizes[0]
+            : available ? device->plan.report_sizes[device->buffer[offset]]
+            : 1
+        );
+        if (size == 0) {
+            /* unknown report id, the stream cannot be split */
+            return JsResult_failure;
+        }
+        if (available < size) {
+            break;
+        }
+        const JsResult r = js_hid_handle_report(device, &device->buffer[offset], size);
+        offset += size;
+        if (r != JsResult_success) {
+            memmove(device->buffer, &device->buffer[offset], device->buffer_size - offset);
+            device->buffer_size -= offset;
+            return r;
+        }
+    }
+    memmove(device->buffer, &device->buffer[offset], device->buffer_size - offset);
+    device->buffer_size -= offset;
+    return JsResult_success;
+}
+
+JsResult js_get_hid_properties(const JsHidDevice * device, JsProperties * properties)
+{
+    *properties = (JsProperties){
+        .number_of_buttons = (char) device->plan.number_of_buttons,
+        .number_of_axes = (char) device->plan.number_of_axes
+    };
+    if (!device->is_stream && ioctl(device->fd, HIDIOCGRAWNAME(sizeof(properties->name)), properties->name) < 0) {
+        return JsResult_failure;
+    }
+    properties->name[sizeof(properties->name) - 1] = '\0';
+    return JsResult_success;
+}
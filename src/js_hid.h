@@ -0,0 +1,126 @@
+#ifndef JS_HID_H
+#define JS_HID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * HID Report Descriptor Parsing
+ *
+ ***************************************************************************************************/
+
+/*
+ * The report descriptor of a device is parsed once into a plan, i.e. a list of the input fields
+ * belonging to joystick, gamepad or multi-axis controller application collections, each describing
+ * where the field is located in a report and how it is converted:
+ *
+ * + buttons (button usage page, variable fields): button n - 1 for usage n,
+ * + axes (X, Y, Z, Rx, Ry, Rz, slider, dial, wheel and the simulation controls throttle, rudder,
+ *   accelerator, brake and steering): scaled from the logical range to [-32767, 32767],
+ * + hat switches: two axes (x, y) with values -32767, 0 or 32767 (like joydev).
+ *
+ * Axes are numbered in the order used by the kernel (X, Y, Z, Rx, Ry, Rz, throttle, rudder, wheel,
+ * gas, brake, hats), so that the numbering matches joydev for common devices. Constant fields,
+ * arrays and fields beyond js_max_number_of_buttons/js_max_number_of_axes are skipped.
+ */
+
+#define js_hid_max_fields 64
+#define js_hid_max_descriptor_size 4096
+#define js_hid_max_report_size 1024
+
+typedef enum {
+    JsHidFieldType_button,
+    JsHidFieldType_axis,
+    JsHidFieldType_hat
+} JsHidFieldType;
+
+typedef struct JsHidField {
+    uint8_t report_id;
+    uint8_t type;
+    /* button or (first) axis number */
+    uint8_t number;
+    uint8_t bit_size;
+    /* offset within the report (excluding the report id) */
+    uint32_t bit_offset;
+    int32_t logical_minimum;
+    int32_t logical_maximum;
+    /* sign extend the extracted bits */
+    bool is_signed;
+    /* axes: 65534 / (logical_maximum - logical_minimum) in 16.16 fixed point */
+    int64_t scale;
+} JsHidField;
+
+typedef struct JsHidPlan {
+    JsHidField fields[js_hid_max_fields];
+    size_t number_of_fields;
+    /* reports start with a report id byte */
+    bool has_report_ids;
+    /* size of each input report in bytes (including the report id, 0 for unknown reports) */
+    uint16_t report_sizes[256];
+    uint8_t number_of_buttons;
+    uint8_t number_of_axes;
+} JsHidPlan;
+
+/* fails if the descriptor is malformed or does not contain any usable input field */
+JsResult js_parse_hid_descriptor(JsHidPlan * plan, const uint8_t * descriptor, size_t size);
+/* update the buttons and axes of state contained in the report (JsResult_nothing if the report
+ * contains no field of the plan), state->time is not modified */
+JsResult js_decode_hid_report(const JsHidPlan * plan, const uint8_t * report, size_t size, JsState * state);
+
+/****************************************************************************************************
+ *
+ * hidraw Backend
+ *
+ ***************************************************************************************************/
+
+/*
+ * Instead of joydev (which splits each report into one event per changed button/axis), a device
+ * can be read through its hidraw node (/dev/hidrawN): every report is decoded directly into the
+ * state, which is thus updated atomically for the whole report at the native report rate.
+ *
+ * The file descriptor may also be a pipe or socket delivering recorded reports back to back, in
+ * which case the descriptor has to be provided (e.g. a copy of
+ * /sys/class/hidraw/hidrawN/device/report_descriptor) and the reports are split by their sizes.
+ */
+typedef struct JsHidDevice {
+    int fd;
+    /* optional callback executed with the new state after each report */
+    JsResult (*state_action)(const JsState * state, void * arg);
+    void * state_action_arg;
+    /* optional callback executed for each button/axis changed by a report (the events of the first
+     * report are marked as synthetic, like the initial events of joydev) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    JsHidPlan plan;
+    JsState state;
+    /* reports are not delimited by reads (pipe/socket) */
+    bool is_stream;
+    uint8_t buffer[2 * js_hid_max_report_size];
+    size_t buffer_size;
+    uint64_t number_of_reports;
+} JsHidDevice;
+
+/* open /dev/hidrawN (read only, non-blocking) */
+int js_hid_connect(const char * path);
+/* read the report descriptor of a hidraw device (size is set to its size) */
+JsResult js_get_hid_descriptor(int fd, uint8_t * descriptor, size_t capacity, size_t * size);
+/* fd is a hidraw device (descriptor null: read from the device) or a stream of reports (descriptor
+ * required); callbacks (if any) have to be set before */
+JsResult js_open_hid_device(JsHidDevice * device, int fd, const uint8_t * descriptor, size_t descriptor_size);
+/* read and handle the pending reports (JsResult_nothing if there were none, JsResult_stop if a
+ * callback requested it); to be called whenever fd is readable */
+JsResult js_hid_process_ready(JsHidDevice * device);
+/* name (hidraw devices only) and number of buttons/axes */
+JsResult js_get_hid_properties(const JsHidDevice * device, JsProperties * properties);
+
+#pragma GCC visibility pop
+
+#endif
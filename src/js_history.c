@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "js_history.h"
+
+/****************************************************************************************************
+ *
+ * Compact State History
+ *
+ ***************************************************************************************************/
+
+/* worst case size of a single encoded state */
+#define js_history_max_record_size (6 + 5 + 1 + 3 * js_max_number_of_axes)
+
+static_assert(js_max_number_of_axes <= 8, "changed axes are encoded in a single byte");
+
+static uint32_t js_put_varint(uint8_t * data, uint64_t value)
+{
+    uint32_t n = 0;
+    while (value >= 0x80) {
+        data[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    data[n++] = (uint8_t) value;
+    return n;
+}
+
+static uint64_t js_get_varint(const uint8_t * data, uint32_t * position)
+{
+    uint64_t value = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+    do {
+        byte = data[(*position)++];
+        value |= ((uint64_t) (byte & 0x7F)) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+static uint32_t js_zigzag(int32_t value)
+{
+    return (((uint32_t) value) << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t js_unzigzag(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -((int32_t) (value & 1));
+}
+
+static JsHistoryBlock * js_history_block(const JsHistory * history, size_t index)
+{
+    return &history->blocks[(history->first + index) % history->capacity];
+}
+
+static JsHistoryBlock * js_history_new_block(JsHistory * history, const JsState * key)
+{
+    /* drop the oldest block if the ring is full */
+    if (history->count == history->capacity) {
+        history->first = (history->first + 1) % history->capacity;
+        --history->count;
+    }
+    JsHistoryBlock * const block = js_history_block(history, history->count++);
+
+    block->key = *key;
+    block->end_time = key->time;
+    block->number_of_states = 1;
+    block->size = 0;
+
+    history->last = *key;
+    history->has_run = false;
+    return block;
+}
+
+JsResult js_create_history(JsHistory * history, size_t number_of_blocks, unsigned int quantization)
+{
+    if (number_of_blocks == 0 || quantization > 15) {
+        return JsResult_failure;
+    }
+
+    *history = (JsHistory){
+        .blocks = malloc(number_of_blocks * sizeof(JsHistoryBlock)),
+        .capacity = number_of_blocks,
+        .quantization = quantization
+    };
+    return history->blocks ? JsResult_success : JsResult_failure;
+}
+
+void js_destroy_history(JsHistory * history)
+{
+    free(history->blocks);
+    history->blocks = nullptr;
+}
+
+JsResult js_history_append(JsHistory * history, const JsState * state)
+{
+    /* quantize */
+    JsState q = *state;
+    for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+        q.axes[i] = (int16_t) (state->axes[i] >> history->quantization);
+    }
+
+    if (history->count == 0) {
+        js_history_new_block(history, &q);
+        return JsResult_success;
+    }
+
+    JsHistoryBlock * block = js_history_block(history, history->count - 1);
+    const JsState * const last = &history->last;
+
+    /* states must be chronological (time differences are taken modulo 2^32) */
+    const uint32_t delta = q.time - last->time;
+    if (((int32_t) delta) < 0) {
+        return JsResult_failure;
+    }
+
+    const uint32_t buttons = q.buttons ^ last->buttons;
+    uint8_t axes = 0;
+    for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+        axes |= (q.axes[i] != last->axes[i]) << i;
+    }
+
+    /* extend the current run of unchanged states */
+    if (!buttons && !axes && history->has_run && delta == history->run_delta
+        && block->data[history->run_position] < UINT8_MAX) {
+        ++block->data[history->run_position];
+        goto append_success;
+    }
+
+    /* start a new block if the current one might overflow */
+    if (block->size + js_history_max_record_size > js_history_block_size) {
+        js_history_new_block(history, &q);
+        return JsResult_success;
+    }
+
+    uint8_t * const data = block->data;
+    block->size += js_put_varint(&data[block->size], (((uint64_t) delta) << 2) | ((buttons != 0) << 1) | (axes != 0));
+    if (!buttons && !axes) {
+        history->has_run = true;
+        history->run_delta = delta;
+        history->run_position = block->size;
+        data[block->size++] = 1;
+        goto append_success;
+    }
+    history->has_run = false;
+    if (buttons) {
+        block->size += js_put_varint(&data[block->size], buttons);
+    }
+    if (axes) {
+        data[block->size++] = axes;
+        for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+            if (axes & (1 << i)) {
+                block->size += js_put_varint(&data[block->size], js_zigzag(q.axes[i] - last->axes[i]));
+            }
+        }
+    }
+
+    append_success:
+    block->end_time = q.time;
+    ++block->number_of_states;
+    history->last = q;
+    return JsResult_success;
+}
+
+/* decode the states of a block in order, stopping after the last state at or before time */
+static size_t js_history_decode(const JsHistory * history, const JsHistoryBlock * block, uint32_t time,
+    JsState * states, size_t max_number_of_states, JsState * last)
+{
+    JsState s = block->key;
+    size_t n = 0;
+
+    #define js_history_emit() \
+        do { \
+            if (n < max_number_of_states) { \
+                states[n] = s; \
+                for (unsigned int i=0; i<js_max_number_of_axes; ++i) { \
+                    states[n].axes[i] = (int16_t) (s.axes[i] * (1 << history->quantization)); \
+                } \
+            } \
+            ++n; \
+        } while (0)
+
+    js_history_emit();
+    uint32_t position = 0;
+    while (position < block->size) {
+        const uint64_t v = js_get_varint(block->data, &position);
+        const uint32_t delta = (uint32_t) (v >> 2);
+
+        /* run of unchanged states */
+        if (!(v & 3)) {
+            const uint8_t count = block->data[position++];
+            for (unsigned int k=0; k<count; ++k) {
+                if ((int32_t) (s.time + delta - time) > 0) {
+                    goto decode_done;
+                }
+                s.time += delta;
+                js_history_emit();
+            }
+            continue;
+        }
+
+        if ((int32_t) (s.time + delta - time) > 0) {
+            break;
+        }
+        s.time += delta;
+        if (v & 2) {
+            s.buttons ^= (uint32_t) js_get_varint(block->data, &position);
+        }
+        if (v & 1) {
+            const uint8_t axes = block->data[position++];
+            for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+                if (axes & (1 << i)) {
+                    s.axes[i] = (int16_t) (s.axes[i] + js_unzigzag((uint32_t) js_get_varint(block->data, &position)));
+                }
+            }
+        }
+        js_history_emit();
+    }
+
+    #undef js_history_emit
+
+    decode_done:
+    if (last) {
+        *last = s;
+        for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+            last->axes[i] = (int16_t) (s.axes[i] * (1 << history->quantization));
+        }
+    }
+    return n;
+}
+
+JsResult js_history_query(const JsHistory * history, uint32_t time, JsState * state)
+{
+    if (history->count == 0) {
+        return JsResult_nothing;
+    }
+
+    /* times are compared relative to the oldest state (modulo 2^32) */
+    const uint32_t origin = js_history_block(history, 0)->key.time;
+    const uint32_t t = time - origin;
+    if (((int32_t) t) < 0) {
+        return JsResult_nothing;
+    }
+
+    /* find the last block starting at or before time */
+    size_t lower = 0;
+    size_t upper = history->count;
+    while (upper - lower > 1) {
+        const size_t middle = (lower + upper) / 2;
+        if (js_history_block(history, middle)->key.time - origin <= t) {
+            lower = middle;
+        }
+        else {
+            upper = middle;
+        }
+    }
+
+    js_history_decode(history, js_history_block(history, lower), time, nullptr, 0, state);
+    return JsResult_success;
+}
+
+size_t js_history_decode_block(const JsHistory * history, size_t index, JsState * states, size_t max_number_of_states)
+{
+    if (index >= history->count) {
+        return 0;
+    }
+    const JsHistoryBlock * const block = js_history_block(history, index);
+    const size_t n = js_history_decode(history, block, block->end_time, states, max_number_of_states, nullptr);
+    return n < max_number_of_states ? n : max_number_of_states;
+}
+
+size_t js_history_number_of_blocks(const JsHistory * history)
+{
+    return history->count;
+}
+
+size_t js_history_number_of_states(const JsHistory * history)
+{
+    size_t n = 0;
+    for (size_t i=0; i<history->count; ++i) {
+        n += js_history_block(history, i)->number_of_states;
+    }
+    return n;
+}
+
+size_t js_history_memory_usage(const JsHistory * history)
+{
+    size_t n = 0;
+    for (size_t i=0; i<history->count; ++i) {
+        n += offsetof(JsHistoryBlock, data) + js_history_block(history, i)->size;
+    }
+    return n;
+}
@@ -0,0 +1,80 @@
+#ifndef JS_HISTORY_H
+#define JS_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Compact State History
+ *
+ ***************************************************************************************************/
+
+/*
+ * States are stored in fixed-size blocks, each starting with a full (key) state followed by the
+ * encoded differences of all subsequent states:
+ *
+ * + a varint (time delta << 2 | buttons changed << 1 | axes changed),
+ * + if buttons changed: a varint of the changed button bits (XOR with the previous buttons),
+ * + if axes changed: a byte of changed axes followed by a zigzag varint delta for each of them,
+ * + if nothing changed: a single byte counting repetitions of the same time delta (run length).
+ *
+ * Axes are quantized by dropping the lowest `quantization` bits before encoding. Blocks are kept in
+ * a fixed ring (the oldest block is dropped when the history is full) and are ordered by time,
+ * allowing random access by a binary search over the blocks and decoding a single block.
+ */
+
+/* number of bytes of encoded data per block */
+#define js_history_block_size 1024
+
+typedef struct JsHistoryBlock {
+    /* key state (axes are quantized) */
+    JsState key;
+    /* time of the last state in the block */
+    uint32_t end_time;
+    /* number of states in the block (including the key state) */
+    uint32_t number_of_states;
+    /* number of bytes used */
+    uint32_t size;
+    uint8_t data[js_history_block_size];
+} JsHistoryBlock;
+
+typedef struct JsHistory {
+    /* ring of blocks */
+    JsHistoryBlock * blocks;
+    size_t capacity;
+    size_t first;
+    size_t count;
+    /* number of dropped low bits of the axes values */
+    unsigned int quantization;
+
+    /* encoder state (last quantized state and position of the current run-length byte) */
+    JsState last;
+    uint32_t run_delta;
+    uint32_t run_position;
+    bool has_run;
+} JsHistory;
+
+JsResult js_create_history(JsHistory * history, size_t number_of_blocks, unsigned int quantization);
+void js_destroy_history(JsHistory * history);
+
+/* states must be appended in chronological order */
+JsResult js_history_append(JsHistory * history, const JsState * state);
+/* obtain the most recent state at or before time (JsResult_nothing if time precedes the history) */
+JsResult js_history_query(const JsHistory * history, uint32_t time, JsState * state);
+/* decode all states of the index-th oldest block (returns the number of states written) */
+size_t js_history_decode_block(const JsHistory * history, size_t index, JsState * states, size_t max_number_of_states);
+
+size_t js_history_number_of_blocks(const JsHistory * history);
+size_t js_history_number_of_states(const JsHistory * history);
+/* number of bytes of encoded data (including key states) */
+size_t js_history_memory_usage(const JsHistory * history);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "js_impair.h"
+
+/****************************************************************************************************
+ *
+ * Impairments
+ *
+ ***************************************************************************************************/
+
+/* deterministic pseudo-random number in [0, 1) */
+static float js_impair_random(uint32_t * random)
+{
+    *random = *random * 1664525u + 1013904223u;
+    return (float) (*random >> 8) * (1.0f / 16777216.0f);
+}
+
+static bool js_impair_same_channel(const JsEvent * a, const JsEvent * b)
+{
+    return ((a->type ^ b->type) & ~JS_EVENT_INIT) == 0 && a->number == b->number;
+}
+
+JsResult js_impair_events(JsImpairment * impairment, const JsEvent * events, size_t number_of_events,
+    JsImpairedEvent ** impaired_events, size_t * number_of_impaired_events)
+{
+    impairment->number_of_dropped_events = 0;
+    impairment->number_of_lost_events = 0;
+    impairment->number_of_reordered_events = 0;
+    impairment->number_of_reconnects = 0;
+    impairment->number_of_synthetic_events = 0;
+
+    /* channels that are reported after a reconnect */
+    unsigned int number_of_axes = 0;
+    unsigned int number_of_buttons = 0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        if (events[i].type & JS_EVENT_BUTTON && events[i].number >= number_of_buttons) {
+            number_of_buttons = events[i].number + 1u;
+        }
+        else if (events[i].type & JS_EVENT_AXIS && events[i].number >= number_of_axes) {
+            number_of_axes = events[i].number + 1u;
+        }
+    }
+
+    /* each outage adds a synthetic event per channel */
+    const uint64_t span = number_of_events ? (uint64_t) (uint32_t) (events[number_of_events - 1].time - events[0].time) * 1'000'000 : 0;
+    const uint64_t interval = (uint64_t) impairment->disconnect_interval * 1000;
+    const uint64_t cycle = interval + (uint64_t) impairment->disconnect_duration * 1000;
+    const size_t max_number_of_reconnects = impairment->disconnect_interval ? (size_t) (span / cycle) + 1 : 0;
+    const size_t capacity = number_of_events + max_number_of_reconnects * (number_of_axes + number_of_buttons);
+
+    JsImpairedEvent * const impaired = (JsImpairedEvent*) malloc((capacity ? capacity : 1) * sizeof(JsImpairedEvent));
+    if (!impaired) {
+        return JsResult_failure;
+    }
+
+    const uint64_t delay = (uint64_t) impairment->delay * 1000;
+    uint32_t random = impairment->seed;
+    int16_t axes[256] = {0};
+    uint8_t buttons[256] = {0};
+    size_t n = 0;
+    uint64_t last_delivery_time = 0;
+    uint64_t stall_end = 0;
+    uint64_t report_delivery_time = 0;
+    bool is_report_dropped = false;
+
+    for (size_t i=0; i<number_of_events; ++i) {
+        const JsEvent * const event = &events[i];
+        const uint64_t t = (uint64_t) (uint32_t) (event->time - events[0].time) * 1'000'000;
+
+        /* random decisions are made once per report */
+        if (i == 0 || event->time != events[i - 1].time) {
+            is_report_dropped = js_impair_random(&random) < impairment->drop_probability;
+            if (t >= stall_end && js_impair_random(&random) < impairment->stall_probability) {
+                stall_end = t + (uint64_t) impairment->stall_duration * 1000;
+            }
+            report_delivery_time = t + delay + (uint64_t) (js_impair_random(&random) * (float) impairment->jitter * 1000.0f);
+            if (t < stall_end && report_delivery_time < stall_end + delay) {
+                report_delivery_time = stall_end + delay;
+            }
+        }
+
+        if (impairment->disconnect_interval) {
+            /* outages that have started up to t */
+            const size_t outages = t < interval ? 0 : (size_t) ((t - interval) / cycle) + 1;
+            if (t % cycle >= interval) {
+                ++impairment->number_of_lost_events;
+                goto update_source;
+            }
+            if (outages > impairment->number_of_reconnects) {
+                /* the reconnected device reports the current state (buttons first, like joydev) */
+                const uint64_t reconnect_time = outages * cycle;
+                last_delivery_time = reconnect_time + delay > last_delivery_time ? reconnect_time + delay : last_delivery_time;
+                for (unsigned int k=0; k<number_of_buttons + number_of_axes; ++k) {
+                    const bool is_button = k < number_of_buttons;
+                    const uint8_t number = (uint8_t) (is_button ? k : k - number_of_buttons);
+                    impaired[n++] = (JsImpairedEvent){
+                        .delivery_time = last_delivery_time,
+                        .source_time = reconnect_time,
+                        .event = {
+                            .value = is_button ? buttons[number] : axes[number],
+                            .type = JS_EVENT_INIT | (is_button ? JS_EVENT_BUTTON : JS_EVENT_AXIS),
+                            .number = number
+                        }
+                    };
+                }
+                impairment->number_of_synthetic_events += number_of_buttons + number_of_axes;
+                impairment->number_of_reconnects = outages;
+            }
+        }
+
+        if (is_report_dropped) {
+            ++impairment->number_of_dropped_events;
+            goto update_source;
+        }
+
+        /* the link delivers reports in order */
+        last_delivery_time = report_delivery_time > last_delivery_time ? report_delivery_time : last_delivery_time;
+        impaired[n++] = (JsImpairedEvent){.delivery_time = last_delivery_time, .source_time = t, .event = *event};
+
+        update_source:
+        if (event->type & JS_EVENT_BUTTON) {
+            buttons[event->number] = event->value != 0;
+        }
+        else if (event->type & JS_EVENT_AXIS) {
+            axes[event->number] = event->value;
+        }
+    }
+
+    /* swap events of different channels (the earlier event is held back and delivered together with
+     * the later one) */
+    for (size_t i=0; i+1<n; ++i) {
+        if (js_impair_random(&random) < impairment->reorder_probability
+            && !js_impair_same_channel(&impaired[i].event, &impaired[i + 1].event)) {
+            const JsImpairedEvent e = impaired[i];
+            impaired[i] = impaired[i + 1];
+            impaired[i + 1] = e;
+            impaired[i + 1].delivery_time = impaired[i].delivery_time;
+            impairment->number_of_reordered_events += 2;
+            ++i;
+        }
+    }
+
+    /* the kernel time is the time of arrival */
+    for (size_t i=0; i<n; ++i) {
+        impaired[i].event.time = events[0].time + (uint32_t) (impaired[i].delivery_time / 1'000'000);
+    }
+
+    *impaired_events = impaired;
+    *number_of_impaired_events = n;
+    return JsResult_success;
+}
+
+/****************************************************************************************************
+ *
+ * Fake Device
+ *
+ ***************************************************************************************************/
+
+/* longest sleep of the writer (bounds the time it takes to destroy the fake device) */
+#define js_fake_device_max_sleep 10'000'000
+
+static uint64_t js_impair_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+}
+
+/* pipes write up to PIPE_BUF bytes atomically, so the reader never sees a partial event */
+static_assert(js_fake_device_queue_capacity * sizeof(JsEvent) <= PIPE_BUF, "a full queue must be written atomically");
+static_assert(2 * 256 * sizeof(JsEvent) <= PIPE_BUF, "the state must be written atomically");
+
+/* discard all pending events and write the current state instead (returns the number of pending
+ * events discarded or -1) */
+static ssize_t js_fake_device_overflow(JsFakeDevice * device, const int16_t * axes, const uint8_t * buttons,
+    unsigned int number_of_axes, unsigned int number_of_buttons, uint32_t time)
+{
+    /* the consumer may read concurrently, only what is left is discarded */
+    ssize_t number_of_discarded_events = 0;
+    JsEvent pending[js_fake_device_queue_capacity];
+    ssize_t s;
+    while ((s = read(device->js, pending, sizeof(pending))) > 0) {
+        number_of_discarded_events += s / (ssize_t) sizeof(JsEvent);
+    }
+    if (s == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return -1;
+    }
+
+    /* buttons first, like joydev */
+    JsEvent state[2 * 256];
+    size_t n = 0;
+    for (unsigned int k=0; k<number_of_buttons + number_of_axes; ++k) {
+        const bool is_button = k < number_of_buttons;
+        const uint8_t number = (uint8_t) (is_button ? k : k - number_of_buttons);
+        state[n++] = (JsEvent){
+            .time = time,
+            .value = is_button ? buttons[number] : axes[number],
+            .type = JS_EVENT_INIT | (is_button ? JS_EVENT_BUTTON : JS_EVENT_AXIS),
+            .number = number
+        };
+    }
+    if (n > 0 && write(device->fd, state, n * sizeof(JsEvent)) != (ssize_t) (n * sizeof(JsEvent))) {
+        return -1;
+    }
+
+    atomic_fetch_add_explicit(&device->number_of_overflows, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&device->number_of_synthetic_events, n, memory_order_relaxed);
+    return number_of_discarded_events;
+}
+
+static int js_fake_device_main(void * arg)
+{
+    JsFakeDevice * const device = (JsFakeDevice*) arg;
+
+    /* state of the device (including discarded events) and channels seen so far */
+    int16_t axes[256] = {0};
+    uint8_t buttons[256] = {0};
+    unsigned int number_of_axes = 0;
+    unsigned int number_of_buttons = 0;
+
+    size_t i = 0;
+    while (i < device->number_of_events && device->is_running) {
+        const uint64_t now = js_impair_now();
+        const uint64_t t = device->start + device->events[i].delivery_time;
+        if (now < t) {
+            const uint64_t ns = t - now < js_fake_device_max_sleep ? t - now : js_fake_device_max_sleep;
+            thrd_sleep(&(struct timespec){.tv_nsec = (long) ns}, nullptr);
+            continue;
+        }
+
+        /* all due events at once */
+        JsEvent batch[js_fake_device_queue_capacity];
+        size_t k = 0;
+        while (i + k < device->number_of_events && k < js_fake_device_queue_capacity
+            && device->start + device->events[i + k].delivery_time <= now) {
+            const JsEvent * const event = &device->events[i + k].event;
+            if (event->type & JS_EVENT_BUTTON) {
+                buttons[event->number] = event->value != 0;
+                number_of_buttons = event->number >= number_of_buttons ? event->number + 1u : number_of_buttons;
+            }
+            else if (event->type & JS_EVENT_AXIS) {
+                axes[event->number] = event->value;
+                number_of_axes = event->number >= number_of_axes ? event->number + 1u : number_of_axes;
+            }
+            batch[k++] = *event;
+        }
+
+        int pending_bytes;
+        if (ioctl(device->js, FIONREAD, &pending_bytes) != 0) {
+            goto write_error;
+        }
+        if ((size_t) pending_bytes / sizeof(JsEvent) + k <= js_fake_device_queue_capacity) {
+            if (write(device->fd, batch, k * sizeof(JsEvent)) != (ssize_t) (k * sizeof(JsEvent))) {
+                goto write_error;
+            }
+        }
+        else {
+            const ssize_t d = js_fake_device_overflow(device, axes, buttons, number_of_axes, number_of_buttons, batch[k - 1].time);
+            if (d < 0) {
+                goto write_error;
+            }
+            atomic_fetch_add_explicit(&device->number_of_discarded_events, (size_t) d + k, memory_order_relaxed);
+        }
+        i += k;
+        atomic_store_explicit(&device->number_of_played_events, i, memory_order_release);
+    }
+
+    device->is_running = false;
+    return EXIT_SUCCESS;
+
+    write_error:
+    device->is_running = false;
+    return EXIT_FAILURE;
+}
+
+JsResult js_create_fake_device(JsFakeDevice * device, const JsImpairedEvent * events, size_t number_of_events)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return JsResult_failure;
+    }
+    if (fcntl(fds[0], F_SETFL, O_NONBLOCK) != 0 || fcntl(fds[1], F_SETFL, O_NONBLOCK) != 0) {
+        goto create_thread_error;
+    }
+
+    device->js = fds[0];
+    device->fd = fds[1];
+    device->events = events;
+    device->number_of_events = number_of_events;
+    atomic_init(&device->number_of_overflows, 0);
+    atomic_init(&device->number_of_discarded_events, 0);
+    atomic_init(&device->number_of_synthetic_events, 0);
+    atomic_init(&device->number_of_played_events, 0);
+    atomic_init(&device->is_running, true);
+    device->start = js_impair_now();
+
+    if (thrd_create(&device->thread_id, js_fake_device_main, (void*) device) != thrd_success) {
+        goto create_thread_error;
+    }
+    return JsResult_success;
+
+    create_thread_error:
+    close(fds[0]);
+    close(fds[1]);
+    return JsResult_failure;
+}
+
+void js_destroy_fake_device(JsFakeDevice * device)
+{
+    device->is_running = false;
+    thrd_join(device->thread_id, nullptr);
+    close(device->fd);
+    close(device->js);
+}
+
+bool js_fake_device_is_done(const JsFakeDevice * device)
+{
+    return atomic_load_explicit(&device->number_of_played_events, memory_order_acquire) == device->number_of_events;
+}
@@ -0,0 +1,128 @@
+#ifndef JS_IMPAIR_H
+#define JS_IMPAIR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Impairments
+ *
+ ***************************************************************************************************/
+
+/*
+ * Turns a stream of events (synthetic or from a recording, with kernel times in ms) into the stream
+ * a consumer would receive over a bad USB or wireless link, by assigning each event the time at which
+ * it is delivered:
+ *
+ * + delay and jitter: every report (consecutive events with equal kernel times) is delayed by delay
+ *   plus a uniformly distributed random time of up to jitter (the link stays FIFO, so a report is
+ *   never delivered before its predecessor),
+ * + drops: reports are lost with drop_probability,
+ * + bursts: with stall_probability per report, the link stalls for stall_duration and delivers all
+ *   reports of the stall at once when it ends,
+ * + reordering: with reorder_probability, an event is swapped with its successor if the successor
+ *   belongs to a different channel (axis or button), so events of each channel stay in order,
+ * + disconnects: every disconnect_interval, the device disconnects for disconnect_duration; all
+ *   events of the outage are lost and the reconnected device first sends the current state as
+ *   synthetic (JS_EVENT_INIT) events for all axes and buttons seen in the stream, like joydev.
+ *
+ * Delivered events carry their delivery time as kernel time (a kernel stamps events when they
+ * arrive), the time at which they occurred at the source is kept for latency measurements. The
+ * random decisions are deterministic for a given seed.
+ */
+
+typedef struct JsImpairment {
+    /* all times in us */
+    uint32_t delay;
+    uint32_t jitter;
+    float drop_probability;
+    float stall_probability;
+    uint32_t stall_duration;
+    float reorder_probability;
+    /* 0 disables disconnects */
+    uint32_t disconnect_interval;
+    uint32_t disconnect_duration;
+    uint32_t seed;
+
+    /* statistics (set by js_impair_events) */
+    size_t number_of_dropped_events;
+    /* events lost while disconnected */
+    size_t number_of_lost_events;
+    size_t number_of_reordered_events;
+    size_t number_of_reconnects;
+    size_t number_of_synthetic_events;
+} JsImpairment;
+
+typedef struct JsImpairedEvent {
+    /* times in ns relative to the first event of the source */
+    uint64_t delivery_time;
+    uint64_t source_time;
+    JsEvent event;
+} JsImpairedEvent;
+
+/* allocates *impaired_events (in the order of delivery, to be freed by the caller) */
+JsResult js_impair_events(JsImpairment * impairment, const JsEvent * events, size_t number_of_events,
+    JsImpairedEvent ** impaired_events, size_t * number_of_impaired_events);
+
+/****************************************************************************************************
+ *
+ * Fake Device
+ *
+ ***************************************************************************************************/
+
+/*
+ * Plays impaired events in real time: a thread writes the events at their delivery times into a
+ * pipe, whose non-blocking read end (js) can be used like a joystick, e.g. by an event handler
+ * (js_get_properties fails on it, and FIONREAD reports the queue depth). Events delivered at once are
+ * written with a single write, so bursts arrive as a backlog.
+ *
+ * The pipe is bounded like the queue of joydev: if the events due would take the number of pending
+ * events above js_fake_device_queue_capacity because the consumer does not keep up, the queue
+ * overflows. All pending and due events are discarded and the current state is written instead as
+ * synthetic (JS_EVENT_INIT) events for all axes and buttons seen so far (buttons first), which is
+ * what a reader of joydev receives after an overflow.
+ */
+
+/* size of the event queue of joydev */
+#define js_fake_device_queue_capacity 64
+
+typedef struct JsFakeDevice {
+    /* read end of the pipe (closed by js_destroy_fake_device) */
+    int js;
+    /* CLOCK_MONOTONIC time in ns corresponding to time 0 of the impaired events */
+    uint64_t start;
+
+    /* statistics (final once js_fake_device_is_done): overflows of the queue, events discarded by
+     * them (pending or due) and synthetic events written after them, so that a consumer reads
+     * number_of_events + number_of_synthetic_events - number_of_discarded_events events in total */
+    atomic_size_t number_of_overflows;
+    atomic_size_t number_of_discarded_events;
+    atomic_size_t number_of_synthetic_events;
+
+    /* internal state (must not be modified) */
+    int fd;
+    const JsImpairedEvent * events;
+    size_t number_of_events;
+    /* number of events written or discarded so far */
+    atomic_size_t number_of_played_events;
+    atomic_bool is_running;
+    thrd_t thread_id;
+} JsFakeDevice;
+
+/* the events must stay valid until the fake device is destroyed */
+JsResult js_create_fake_device(JsFakeDevice * device, const JsImpairedEvent * events, size_t number_of_events);
+void js_destroy_fake_device(JsFakeDevice * device);
+/* all events have been written */
+bool js_fake_device_is_done(const JsFakeDevice * device);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef JS_PIPELINE_HPP
+#define JS_PIPELINE_HPP
+
+/*
+ * Composable event pipeline (C++20, header only)
+ *
+ * A pipeline is built from a source and an arbitrary number of stages using operator|, e.g.
+ *
+ *     auto pipeline = js::source(fd) | js::coalesce() | js::remap(map) | js::deadzone(dz)
+ *                   | js::sink([&](const js::Event & event) {...});
+ *
+ * Every stage is a distinct type and the pipeline is a single std::tuple of stages. Processing a
+ * batch is one loop over the events in which all stages are applied in order (folded at compile
+ * time), so adding a stage costs neither a virtual call nor an intermediate buffer nor an allocation
+ * (stages providing prepare, see below, start a new loop unless they come first).
+ *
+ * A stage is any type derived from js::Stage providing
+ *
+ *     bool operator()(js::Event & event, std::size_t index);
+ *
+ * which may modify the event in place and returns false to drop it (the remaining stages are then
+ * skipped). A stage may additionally provide
+ *
+ *     void prepare(const js::Event * events, std::size_t number_of_events);
+ *
+ * which is called once per batch with the events as transformed by the preceding stages, before the
+ * loop applying the stage and its successors (used e.g. for coalescing). Events dropped by preceding
+ * stages are left in the batch with type 0, which no stage is passed.
+ *
+ * This header only depends on the kernel interface (and js_deadzone.h) and may be used independently
+ * of js.h.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <concepts>
+#include <type_traits>
+
+#include <unistd.h>
+#include <linux/joystick.h>
+
+#include "js_deadzone.h"
+
+namespace js {
+
+using Event = struct js_event;
+
+/****************************************************************************************************
+ *
+ * Stage Concept
+ *
+ ***************************************************************************************************/
+
+struct Stage {};
+
+template<class T>
+concept StageType = std::derived_from<std::remove_cvref_t<T>, Stage>;
+
+template<class T>
+concept PreparingStage = requires (T & stage, const Event * events, std::size_t n) {
+    stage.prepare(events, n);
+};
+
+/****************************************************************************************************
+ *
+ * Source
+ *
+ ***************************************************************************************************/
+
+/* reads up to batch_size events per call from a (non-blocking) file descriptor into a fixed buffer,
+ * optionally moving button events ahead of axis events (priority lanes) */
+template<std::size_t batch_size = 64>
+struct Source {
+    int js;
+    bool buttons_first = false;
+    std::array<Event, batch_size> buffer{};
+    std::array<Event, batch_size> axes{};
+
+    /* returns the number of events read, 0 if there was no event or -1 on error */
+    int read_batch()
+    {
+        const ssize_t s = ::read(js, buffer.data(), sizeof(buffer));
+        if (s > 0) {
+            /* the kernel only ever returns whole events */
+            if (s % sizeof(Event) != 0) {
+                return -1;
+            }
+            const std::size_t n = static_cast<std::size_t>(s) / sizeof(Event);
+            if (buttons_first) {
+                prioritize_buttons(n);
+            }
+            return static_cast<int>(n);
+        }
+        if (s == 0 || errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        return -1;
+    }
+
+    /* stable partition of the batch (before any stage sees it, so event indices stay valid) */
+    void prioritize_buttons(std::size_t n)
+    {
+        std::size_t number_of_buttons = 0;
+        std::size_t number_of_axes = 0;
+        for (std::size_t i=0; i<n; ++i) {
+            if (buffer[i].type & JS_EVENT_BUTTON) {
+                buffer[number_of_buttons++] = buffer[i];
+            }
+            else {
+                axes[number_of_axes++] = buffer[i];
+            }
+        }
+        std::copy_n(axes.begin(), number_of_axes, buffer.begin() + number_of_buttons);
+    }
+};
+
+template<std::size_t batch_size = 64>
+inline Source<batch_size> source(int js, bool buttons_first = false)
+{
+    return Source<batch_size>{js, buttons_first};
+}
+
+/****************************************************************************************************
+ *
+ * Pipeline
+ *
+ ***************************************************************************************************/
+
+template<class Src, StageType... Stages>
+class Pipeline {
+public:
+    Pipeline(Src src, std::tuple<Stages...> stages) : src_(std::move(src)), stages_(std::move(stages)) {}
+
+    /* process an externally supplied batch in place (events may be modified by the stages, dropped
+     * events have type 0 afterwards) */
+    void process(Event * events, std::size_t number_of_events)
+    {
+        process_from<0>(events, number_of_events);
+    }
+
+    /* read one batch from the source and process it; returns the result of Source::read_batch */
+    int poll() requires (!std::is_same_v<Src, std::nullptr_t>)
+    {
+        const int n = src_.read_batch();
+        if (n > 0) {
+            process(src_.buffer.data(), static_cast<std::size_t>(n));
+        }
+        return n;
+    }
+
+    template<std::size_t i>
+    auto & stage() {return std::get<i>(stages_);}
+
+    template<StageType Next>
+    friend Pipeline<Src, Stages..., std::remove_cvref_t<Next>> operator|(Pipeline && p, Next && next)
+    {
+        return {
+            std::move(p.src_),
+            std::tuple_cat(std::move(p.stages_), std::make_tuple(std::forward<Next>(next)))
+        };
+    }
+
+private:
+    /* index of the first stage providing prepare at or after stage i (or the number of stages) */
+    template<std::size_t i>
+    static constexpr std::size_t next_preparing()
+    {
+        if constexpr (i >= sizeof...(Stages)) {
+            return sizeof...(Stages);
+        }
+        else if constexpr (PreparingStage<std::tuple_element_t<i, std::tuple<Stages...>>>) {
+            return i;
+        }
+        else {
+            return next_preparing<i + 1>();
+        }
+    }
+
+    /* one loop over the batch applying the stages from begin up to the next stage providing prepare */
+    template<std::size_t begin>
+    void process_from(Event * events, std::size_t n)
+    {
+        if constexpr (begin < sizeof...(Stages)) {
+            constexpr std::size_t end = next_preparing<begin + 1>();
+            if constexpr (PreparingStage<std::tuple_element_t<begin, std::tuple<Stages...>>>) {
+                std::get<begin>(stages_).prepare(static_cast<const Event *>(events), n);
+            }
+            for (std::size_t i=0; i<n; ++i) {
+                if (events[i].type && !apply<begin>(events[i], i, std::make_index_sequence<end - begin>{})) {
+                    events[i].type = 0;
+                }
+            }
+            process_from<end>(events, n);
+        }
+    }
+
+    template<std::size_t begin, std::size_t... is>
+    bool apply(Event & event, std::size_t index, std::index_sequence<is...>)
+    {
+        /* short-circuits as soon as a stage drops the event */
+        return (std::get<begin + is>(stages_)(event, index) && ...);
+    }
+
+    Src src_;
+    std::tuple<Stages...> stages_;
+};
+
+template<std::size_t batch_size, StageType Next>
+inline Pipeline<Source<batch_size>, std::remove_cvref_t<Next>> operator|(Source<batch_size> src, Next && next)
+{
+    return {std::move(src), std::make_tuple(std::forward<Next>(next))};
+}
+
+/* pipeline without a source, e.g. for processing batches obtained through js_get_event */
+inline Pipeline<std::nullptr_t> pipeline()
+{
+    return {nullptr, {}};
+}
+
+/****************************************************************************************************
+ *
+ * Stages
+ *
+ ***************************************************************************************************/
+
+/* drops every axis event that is superseded by a later event for the same axis in the same batch */
+struct Coalesce : Stage {
+    /* index of the most recent event for each axis (only valid for axes occuring in the batch, after
+     * the preceding stages) */
+    std::array<std::size_t, 256> last{};
+
+    void prepare(const Event * events, std::size_t n)
+    {
+        for (std::size_t i=0; i<n; ++i) {
+            if (events[i].type & JS_EVENT_AXIS) {
+                last[events[i].number] = i;
+            }
+        }
+    }
+
+    bool operator()(Event & event, std::size_t index) const
+    {
+        return !(event.type & JS_EVENT_AXIS) || last[event.number] == index;
+    }
+};
+
+inline Coalesce coalesce() {return {};}
+
+/* maps button/axis numbers to new numbers; mapping a number to remap_drop drops its events */
+struct Remap : Stage {
+    static constexpr std::uint8_t remap_drop = 0xFF;
+
+    std::array<std::uint8_t, 256> buttons;
+    std::array<std::uint8_t, 256> axes;
+
+    Remap()
+    {
+        for (std::size_t i=0; i<256; ++i) {
+            buttons[i] = axes[i] = static_cast<std::uint8_t>(i);
+        }
+    }
+
+    bool operator()(Event & event, std::size_t) const
+    {
+        const std::uint8_t n = (event.type & JS_EVENT_BUTTON ? buttons : axes)[event.number];
+        event.number = n;
+        return n != remap_drop;
+    }
+};
+
+inline Remap remap() {return {};}
+
+/* sets small axis values to 0 and (optionally) rescales the remaining range to the full range */
+struct Deadzone : Stage {
+    std::array<std::int16_t, 256> radius{};
+    bool rescale = true;
+
+    bool operator()(Event & event, std::size_t) const
+    {
+        if (!(event.type & JS_EVENT_AXIS)) {
+            return true;
+        }
+        event.value = js_apply_deadzone(event.value, radius[event.number], rescale);
+        return true;
+    }
+};
+
+/* radius must be in [0, js_max_deadzone] */
+inline Deadzone deadzone(std::int16_t radius, bool rescale = true)
+{
+    if (radius < 0 || radius > js_max_deadzone) {
+        throw std::out_of_range("js::deadzone: radius must be in [0, 32766]");
+    }
+    Deadzone d;
+    d.radius.fill(radius);
+    d.rescale = rescale;
+    return d;
+}
+
+/* keeps only events for which the predicate returns true */
+template<class Predicate>
+struct Filter : Stage {
+    Predicate predicate;
+
+    bool operator()(Event & event, std::size_t) {return predicate(static_cast<const Event &>(event));}
+};
+
+template<class Predicate>
+inline Filter<std::decay_t<Predicate>> filter(Predicate && predicate)
+{
+    return {{}, std::forward<Predicate>(predicate)};
+}
+
+/* passes every event to a callable (usually the last stage) */
+template<class Action>
+struct Sink : Stage {
+    Action action;
+
+    bool operator()(Event & event, std::size_t)
+    {
+        action(static_cast<const Event &>(event));
+        return true;
+    }
+};
+
+template<class Action>
+inline Sink<std::decay_t<Action>> sink(Action && action)
+{
+    return {{}, std::forward<Action>(action)};
+}
+
+} /* namespace js */
+
+#endif
@@ -0,0 +1,448 @@
+#include <string.h>
+
+#include "js_q15.h"
+
+#if !defined(JS_Q15_SCALAR) && js_max_number_of_axes == 8
+#if defined(__SSE2__)
+#define JS_Q15_SSE2
+#include <emmintrin.h>
+/* the NEON kernel has not been verified on ARM hardware yet (only against the reference with an
+ * emulation of the intrinsics), so it has to be enabled explicitly */
+#elif defined(__ARM_NEON) && defined(JS_Q15_ENABLE_NEON)
+#define JS_Q15_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+/****************************************************************************************************
+ *
+ * Fixed-Point (Q15) Conditioning
+ *
+ ***************************************************************************************************/
+
+/* the sums of the mixing stage stay within 32 bits: 32768 * 65535 + 8192 < 2^31 (which also
+ * excludes the only overflow of a pairwise multiply-add, -32768 * -32768 twice) */
+#define js_q15_max_mix_weight 65535
+
+/* spacing of the curve points */
+#define js_q15_curve_shift 12
+
+void js_init_q15_conditioner(JsQ15Conditioner * conditioner)
+{
+    *conditioner = (JsQ15Conditioner) {
+        .event_action = conditioner->event_action,
+        .event_action_arg = conditioner->event_action_arg
+    };
+
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        conditioner->deadzone_gain[i] = 16384;
+        conditioner->gain[i] = 4096;
+        for (size_t k=0; k<js_q15_curve_points; ++k) {
+            const int32_t x = -32768 + ((int32_t) k << js_q15_curve_shift);
+            conditioner->curves[i][k] = (int16_t) (x > 32767 ? 32767 : x);
+        }
+        conditioner->mix[i][i] = 16384;
+        conditioner->filter_weights[i][0] = 32767;
+    }
+}
+
+JsResult js_q15_set_deadzone(JsQ15Conditioner * conditioner, uint8_t axis, int16_t radius)
+{
+    if (axis >= js_max_number_of_axes || radius < 0 || radius > js_q15_max_deadzone) {
+        return JsResult_failure;
+    }
+
+    const int32_t range = 32767 - radius;
+    conditioner->deadzone[axis] = radius;
+    conditioner->deadzone_gain[axis] = (int16_t) ((32767 * 16384 + range / 2) / range);
+    conditioner->stages |= JsQ15Stage_deadzone;
+    return JsResult_success;
+}
+
+JsResult js_q15_set_gain(JsQ15Conditioner * conditioner, uint8_t axis, int16_t gain)
+{
+    if (axis >= js_max_number_of_axes) {
+        return JsResult_failure;
+    }
+
+    conditioner->gain[axis] = gain;
+    conditioner->stages |= JsQ15Stage_gain;
+    return JsResult_success;
+}
+
+JsResult js_q15_set_curve(JsQ15Conditioner * conditioner, uint8_t axis, const int16_t points[js_q15_curve_points])
+{
+    if (axis >= js_max_number_of_axes) {
+        return JsResult_failure;
+    }
+
+    memcpy(conditioner->curves[axis], points, sizeof(conditioner->curves[axis]));
+    conditioner->stages |= JsQ15Stage_curve;
+    return JsResult_success;
+}
+
+JsResult js_q15_set_expo(JsQ15Conditioner * conditioner, uint8_t axis, int16_t expo)
+{
+    if (expo < 0) {
+        return JsResult_failure;
+    }
+
+    int16_t points[js_q15_curve_points];
+    for (size_t k=0; k<js_q15_curve_points; ++k) {
+        const int64_t x = -32768 + ((int64_t) k << js_q15_curve_shift);
+        const int64_t cube = (x * x * x) >> 30;
+        const int64_t y = ((32768 - expo) * x + expo * cube + 16384) >> 15;
+        points[k] = (int16_t) (y > 32767 ? 32767 : (y < -32768 ? -32768 : y));
+    }
+    return js_q15_set_curve(conditioner, axis, points);
+}
+
+JsResult js_q15_set_mix(JsQ15Conditioner * conditioner, const int16_t mix[js_max_number_of_axes][js_max_number_of_axes])
+{
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        int32_t sum = 0;
+        for (size_t j=0; j<js_max_number_of_axes; ++j) {
+            sum += mix[i][j] < 0 ? -mix[i][j] : mix[i][j];
+        }
+        if (sum > js_q15_max_mix_weight) {
+            return JsResult_failure;
+        }
+    }
+
+    memcpy(conditioner->mix, mix, sizeof(conditioner->mix));
+    conditioner->stages |= JsQ15Stage_mix;
+    return JsResult_success;
+}
+
+JsResult js_q15_set_filter(JsQ15Conditioner * conditioner, uint8_t axis, int32_t alpha)
+{
+    if (axis >= js_max_number_of_axes || alpha <= 0 || alpha > 32768) {
+        return JsResult_failure;
+    }
+
+    /* alpha x + (32768 - alpha) s, where alpha = 32768 does not fit into 16 bits */
+    conditioner->filter_weights[axis][0] = (int16_t) (alpha - 1);
+    conditioner->filter_weights[axis][1] = (int16_t) (32768 - alpha);
+    conditioner->stages |= JsQ15Stage_filter;
+    return JsResult_success;
+}
+
+static inline int32_t js_q15_saturate(int32_t x)
+{
+    return x > 32767 ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+void js_q15_condition_reference(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output)
+{
+    const uint32_t stages = conditioner->stages;
+    int32_t x[js_max_number_of_axes];
+
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        x[i] = input[i];
+    }
+
+    if (stages & JsQ15Stage_deadzone) {
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            const int32_t a = x[i] < 0 ? -x[i] : x[i];
+            const int32_t d = a > conditioner->deadzone[i] ? a - conditioner->deadzone[i] : 0;
+            const int32_t m = js_q15_saturate((d * conditioner->deadzone_gain[i] + 8192) >> 14);
+            x[i] = x[i] < 0 ? -m : m;
+        }
+    }
+
+    if (stages & JsQ15Stage_gain) {
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            x[i] = js_q15_saturate((x[i] * conditioner->gain[i] + 2048) >> 12);
+        }
+    }
+
+    if (stages & JsQ15Stage_curve) {
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            const int32_t u = x[i] + 32768;
+            const int16_t * const p = &conditioner->curves[i][u >> js_q15_curve_shift];
+            const int32_t f = u & ((1 << js_q15_curve_shift) - 1);
+            x[i] = p[0] + (((p[1] - p[0]) * f + 2048) >> js_q15_curve_shift);
+        }
+    }
+
+    if (stages & JsQ15Stage_mix) {
+        int32_t sums[js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            sums[i] = 8192;
+            for (size_t j=0; j<js_max_number_of_axes; ++j) {
+                sums[i] += conditioner->mix[i][j] * x[j];
+            }
+        }
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            x[i] = js_q15_saturate(sums[i] >> 14);
+        }
+    }
+
+    if (stages & JsQ15Stage_filter) {
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            const int32_t s = conditioner->filtered[i];
+            const int32_t alpha = conditioner->filter_weights[i][0] + 1;
+            x[i] = js_q15_saturate(s + ((alpha * (x[i] - s) + 16384) >> 15));
+            conditioner->filtered[i] = (int16_t) x[i];
+        }
+    }
+
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        output[i] = (int16_t) x[i];
+    }
+}
+
+/*
+ * The SIMD kernels keep the 8 axes in 16 bit lanes and widen only the products to 32 bit, which are
+ * rounded, shifted and narrowed with saturation in the end. The curve stage gathers its points with
+ * scalar loads and interpolates p0 (4096 - f) + p1 f, and the filter computes
+ * (alpha - 1) x + (32768 - alpha) s + x, which both equal the reference exactly.
+ */
+
+#ifdef JS_Q15_SSE2
+
+/* sat16((v + 2^(shift - 1)) >> shift) for the 32 bit lanes of low and high */
+static inline __m128i js_q15_narrow(__m128i low, __m128i high, int shift)
+{
+    const __m128i rounding = _mm_set1_epi32(1 << (shift - 1));
+    low = _mm_srai_epi32(_mm_add_epi32(low, rounding), shift);
+    high = _mm_srai_epi32(_mm_add_epi32(high, rounding), shift);
+    return _mm_packs_epi32(low, high);
+}
+
+static inline __m128i js_q15_sign_extend_low(__m128i x)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+}
+
+static inline __m128i js_q15_sign_extend_high(__m128i x)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+}
+
+/* the 4 sums of the lanes of a, b, c and d */
+static inline __m128i js_q15_add_lanes(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const __m128i ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+    const __m128i cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+    return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+static void js_q15_condition_sse2(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output)
+{
+    const uint32_t stages = conditioner->stages;
+    __m128i x = _mm_loadu_si128((const __m128i*) input);
+
+    if (stages & JsQ15Stage_deadzone) {
+        /* |x| and its distance to the radius as unsigned values (|-32768| = 32768) */
+        const __m128i sign = _mm_srai_epi16(x, 15);
+        const __m128i a = _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+        const __m128i d = _mm_subs_epu16(a, _mm_loadu_si128((const __m128i*) conditioner->deadzone));
+        const __m128i gain = _mm_loadu_si128((const __m128i*) conditioner->deadzone_gain);
+        const __m128i low = _mm_mullo_epi16(d, gain);
+        const __m128i high = _mm_mulhi_epu16(d, gain);
+        const __m128i m = js_q15_narrow(_mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high), 14);
+        x = _mm_sub_epi16(_mm_xor_si128(m, sign), sign);
+    }
+
+    if (stages & JsQ15Stage_gain) {
+        const __m128i gain = _mm_loadu_si128((const __m128i*) conditioner->gain);
+        const __m128i low = _mm_mullo_epi16(x, gain);
+        const __m128i high = _mm_mulhi_epi16(x, gain);
+        x = js_q15_narrow(_mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high), 12);
+    }
+
+    if (stages & JsQ15Stage_curve) {
+        const __m128i u = _mm_xor_si128(x, _mm_set1_epi16(INT16_MIN));
+        const __m128i f = _mm_and_si128(u, _mm_set1_epi16((1 << js_q15_curve_shift) - 1));
+        uint16_t k[js_max_number_of_axes];
+        _mm_storeu_si128((__m128i*) k, _mm_srli_epi16(u, js_q15_curve_shift));
+
+        /* p0 and p1 of each axis next to each other, like the weights 4096 - f and f */
+        int16_t points[2 * js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            points[2 * i] = conditioner->curves[i][k[i]];
+            points[2 * i + 1] = conditioner->curves[i][k[i] + 1];
+        }
+        const __m128i g = _mm_sub_epi16(_mm_set1_epi16(1 << js_q15_curve_shift), f);
+        const __m128i low = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) points), _mm_unpacklo_epi16(g, f));
+        const __m128i high = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) &points[8]), _mm_unpackhi_epi16(g, f));
+        x = js_q15_narrow(low, high, js_q15_curve_shift);
+    }
+
+    if (stages & JsQ15Stage_mix) {
+        __m128i rows[js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            rows[i] = _mm_madd_epi16(_mm_loadu_si128((const __m128i*) conditioner->mix[i]), x);
+        }
+        x = js_q15_narrow(
+            js_q15_add_lanes(rows[0], rows[1], rows[2], rows[3]),
+            js_q15_add_lanes(rows[4], rows[5], rows[6], rows[7]),
+            14
+        );
+    }
+
+    if (stages & JsQ15Stage_filter) {
+        const __m128i s = _mm_loadu_si128((const __m128i*) conditioner->filtered);
+        const __m128i low = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpacklo_epi16(x, s), _mm_loadu_si128((const __m128i*) conditioner->filter_weights[0])),
+            js_q15_sign_extend_low(x)
+        );
+        const __m128i high = _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpackhi_epi16(x, s), _mm_loadu_si128((const __m128i*) conditioner->filter_weights[4])),
+            js_q15_sign_extend_high(x)
+        );
+        x = js_q15_narrow(low, high, 15);
+        _mm_storeu_si128((__m128i*) conditioner->filtered, x);
+    }
+
+    _mm_storeu_si128((__m128i*) output, x);
+}
+
+#endif
+
+#ifdef JS_Q15_NEON
+
+/* the 4 sums of the lanes of a, b, c and d */
+static inline int32x4_t js_q15_add_lanes(int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d)
+{
+    const int32x2_t ab = vpadd_s32(
+        vpadd_s32(vget_low_s32(a), vget_high_s32(a)),
+        vpadd_s32(vget_low_s32(b), vget_high_s32(b))
+    );
+    const int32x2_t cd = vpadd_s32(
+        vpadd_s32(vget_low_s32(c), vget_high_s32(c)),
+        vpadd_s32(vget_low_s32(d), vget_high_s32(d))
+    );
+    return vcombine_s32(ab, cd);
+}
+
+static void js_q15_condition_neon(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output)
+{
+    const uint32_t stages = conditioner->stages;
+    int16x8_t x = vld1q_s16(input);
+
+    if (stages & JsQ15Stage_deadzone) {
+        /* |x| and its distance to the radius as unsigned values (|-32768| = 32768) */
+        const int16x8_t sign = vshrq_n_s16(x, 15);
+        const uint16x8_t d = vqsubq_u16(
+            vreinterpretq_u16_s16(vabsq_s16(x)),
+            vreinterpretq_u16_s16(vld1q_s16(conditioner->deadzone))
+        );
+        const uint16x8_t gain = vreinterpretq_u16_s16(vld1q_s16(conditioner->deadzone_gain));
+        const int16x8_t m = vcombine_s16(
+            vqrshrn_n_s32(vreinterpretq_s32_u32(vmull_u16(vget_low_u16(d), vget_low_u16(gain))), 14),
+            vqrshrn_n_s32(vreinterpretq_s32_u32(vmull_u16(vget_high_u16(d), vget_high_u16(gain))), 14)
+        );
+        x = vsubq_s16(veorq_s16(m, sign), sign);
+    }
+
+    if (stages & JsQ15Stage_gain) {
+        const int16x8_t gain = vld1q_s16(conditioner->gain);
+        x = vcombine_s16(
+            vqrshrn_n_s32(vmull_s16(vget_low_s16(x), vget_low_s16(gain)), 12),
+            vqrshrn_n_s32(vmull_s16(vget_high_s16(x), vget_high_s16(gain)), 12)
+        );
+    }
+
+    if (stages & JsQ15Stage_curve) {
+        const uint16x8_t u = veorq_u16(vreinterpretq_u16_s16(x), vdupq_n_u16(0x8000));
+        const int16x8_t f = vreinterpretq_s16_u16(vandq_u16(u, vdupq_n_u16((1 << js_q15_curve_shift) - 1)));
+        uint16_t k[js_max_number_of_axes];
+        vst1q_u16(k, vshrq_n_u16(u, js_q15_curve_shift));
+
+        int16_t p0[js_max_number_of_axes];
+        int16_t p1[js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            p0[i] = conditioner->curves[i][k[i]];
+            p1[i] = conditioner->curves[i][k[i] + 1];
+        }
+        const int16x8_t a = vld1q_s16(p0);
+        const int16x8_t b = vld1q_s16(p1);
+        const int16x8_t g = vsubq_s16(vdupq_n_s16(1 << js_q15_curve_shift), f);
+        x = vcombine_s16(
+            vqrshrn_n_s32(vmlal_s16(vmull_s16(vget_low_s16(a), vget_low_s16(g)), vget_low_s16(b), vget_low_s16(f)), js_q15_curve_shift),
+            vqrshrn_n_s32(vmlal_s16(vmull_s16(vget_high_s16(a), vget_high_s16(g)), vget_high_s16(b), vget_high_s16(f)), js_q15_curve_shift)
+        );
+    }
+
+    if (stages & JsQ15Stage_mix) {
+        int32x4_t rows[js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            const int16x8_t row = vld1q_s16(conditioner->mix[i]);
+            rows[i] = vmlal_s16(vmull_s16(vget_low_s16(row), vget_low_s16(x)), vget_high_s16(row), vget_high_s16(x));
+        }
+        x = vcombine_s16(
+            vqrshrn_n_s32(js_q15_add_lanes(rows[0], rows[1], rows[2], rows[3]), 14),
+            vqrshrn_n_s32(js_q15_add_lanes(rows[4], rows[5], rows[6], rows[7]), 14)
+        );
+    }
+
+    if (stages & JsQ15Stage_filter) {
+        const int16x8_t s = vld1q_s16(conditioner->filtered);
+        const int16x8x2_t weights = vld2q_s16(conditioner->filter_weights[0]);
+        const int32x4_t low = vaddw_s16(
+            vmlal_s16(vmull_s16(vget_low_s16(x), vget_low_s16(weights.val[0])), vget_low_s16(s), vget_low_s16(weights.val[1])),
+            vget_low_s16(x)
+        );
+        const int32x4_t high = vaddw_s16(
+            vmlal_s16(vmull_s16(vget_high_s16(x), vget_high_s16(weights.val[0])), vget_high_s16(s), vget_high_s16(weights.val[1])),
+            vget_high_s16(x)
+        );
+        x = vcombine_s16(vqrshrn_n_s32(low, 15), vqrshrn_n_s32(high, 15));
+        vst1q_s16(conditioner->filtered, x);
+    }
+
+    vst1q_s16(output, x);
+}
+
+#endif
+
+void js_q15_condition(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output)
+{
+#if defined(JS_Q15_SSE2)
+    js_q15_condition_sse2(conditioner, input, output);
+#elif defined(JS_Q15_NEON)
+    js_q15_condition_neon(conditioner, input, output);
+#else
+    js_q15_condition_reference(conditioner, input, output);
+#endif
+}
+
+JsResult js_q15_event_action(const JsEvent * event, void * arg)
+{
+    JsQ15Conditioner * const conditioner = (JsQ15Conditioner*) arg;
+
+    if (js_update_state(&conditioner->input, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    if (!(event->type & JS_EVENT_AXIS)) {
+        return conditioner->event_action ? conditioner->event_action(event, conditioner->event_action_arg) : JsResult_success;
+    }
+
+    int16_t output[js_max_number_of_axes];
+    js_q15_condition(conditioner, conditioner->input.axes, output);
+
+    /* mixing may change other axes, the initial event of an axis is always forwarded */
+    for (uint8_t i=0; i<js_max_number_of_axes; ++i) {
+        if (output[i] == conditioner->output[i] && !(i == event->number && (event->type & JS_EVENT_INIT))) {
+            continue;
+        }
+        conditioner->output[i] = output[i];
+
+        if (conditioner->event_action) {
+            const JsEvent conditioned = {
+                .time = event->time,
+                .value = output[i],
+                .type = event->type,
+                .number = i
+            };
+            const JsResult r = conditioner->event_action(&conditioned, conditioner->event_action_arg);
+            if (r != JsResult_success) {
+                return r;
+            }
+        }
+    }
+    return JsResult_success;
+}
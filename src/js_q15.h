@@ -0,0 +1,101 @@
+#ifndef JS_Q15_H
+#define JS_Q15_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Fixed-Point (Q15) Conditioning
+ *
+ ***************************************************************************************************/
+
+/*
+ * Integer-only conditioning of the axes of a JsState (for targets without FPU or where converting
+ * to float dominates the input path). Axis values are Q15 numbers (32767 ~ 1.0), and each call of
+ * js_q15_condition applies the enabled stages to all axes at once:
+ *
+ * 1. deadzone: values within the radius become 0, the remaining range is rescaled to the full range,
+ * 2. gain: multiplication by a Q12 factor (4096 = 1.0, range [-8, 8)), with saturation,
+ * 3. curve: piecewise linear response curve through js_q15_curve_points points spread evenly over
+ *    [-32768, 32768] (e.g. generated by js_q15_set_expo),
+ * 4. mixing: multiplication by a Q14 matrix (16384 = 1.0, output axis i = row i), e.g. for tank or
+ *    elevon mixing,
+ * 5. filtering: first order low-pass per axis with a Q15 coefficient (32768 = no filtering), whose
+ *    state advances on each call.
+ *
+ * Every result is rounded to nearest and saturated to [-32768, 32767] as specified by the scalar
+ * reference js_q15_condition_reference. js_q15_condition computes bit-exactly the same result
+ * using SIMD kernels that process all axes in a single 128 bit register with 16 bit lanes (SSE2 on
+ * x86-64, NEON on ARM if JS_Q15_ENABLE_NEON is defined, since that kernel has not been verified on
+ * ARM hardware yet), provided that js_max_number_of_axes is 8 and JS_Q15_SCALAR is not defined, and
+ * is the scalar reference otherwise.
+ */
+
+#define js_q15_curve_points 17
+
+/* largest deadzone radius (the rescaling gain must fit into Q14) */
+#define js_q15_max_deadzone 16383
+
+typedef enum {
+    JsQ15Stage_deadzone = (1 << 0),
+    JsQ15Stage_gain     = (1 << 1),
+    JsQ15Stage_curve    = (1 << 2),
+    JsQ15Stage_mix      = (1 << 3),
+    JsQ15Stage_filter   = (1 << 4)
+} JsQ15Stage;
+
+typedef struct JsQ15Conditioner {
+    /* optional callback executed for each button event and for each conditioned axis that changed
+     * (when used as event action) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (to be modified through the js_q15_set_* functions only) */
+    /* enabled stages (JsQ15Stage flags) */
+    uint32_t stages;
+    int16_t deadzone[js_max_number_of_axes];
+    /* Q14 rescaling gain 32767 / (32767 - radius) */
+    int16_t deadzone_gain[js_max_number_of_axes];
+    int16_t gain[js_max_number_of_axes];
+    int16_t curves[js_max_number_of_axes][js_q15_curve_points];
+    /* mixing matrix (mix[i][j]: weight of input j for output i) */
+    int16_t mix[js_max_number_of_axes][js_max_number_of_axes];
+    /* filter weights alpha - 1 and 32768 - alpha (of the new and the filtered value) */
+    int16_t filter_weights[js_max_number_of_axes][2];
+    /* filter state (initially 0) */
+    int16_t filtered[js_max_number_of_axes];
+    /* raw and conditioned state (event action) */
+    JsState input;
+    int16_t output[js_max_number_of_axes];
+} JsQ15Conditioner;
+
+/* all stages disabled (identity), the callback is kept */
+void js_init_q15_conditioner(JsQ15Conditioner * conditioner);
+
+/* the setters fail for invalid parameters (and enable the respective stage otherwise) */
+JsResult js_q15_set_deadzone(JsQ15Conditioner * conditioner, uint8_t axis, int16_t radius);
+JsResult js_q15_set_gain(JsQ15Conditioner * conditioner, uint8_t axis, int16_t gain);
+JsResult js_q15_set_curve(JsQ15Conditioner * conditioner, uint8_t axis, const int16_t points[js_q15_curve_points]);
+/* curve (1 - expo) x + expo x^3 with expo in Q15 [0, 32767] */
+JsResult js_q15_set_expo(JsQ15Conditioner * conditioner, uint8_t axis, int16_t expo);
+/* the sum of the absolute weights of each row must not exceed 65535 (~4.0) */
+JsResult js_q15_set_mix(JsQ15Conditioner * conditioner, const int16_t mix[js_max_number_of_axes][js_max_number_of_axes]);
+/* alpha in (0, 32768], the weight of the new value */
+JsResult js_q15_set_filter(JsQ15Conditioner * conditioner, uint8_t axis, int32_t alpha);
+
+/* condition all axes (input and output may be the same array) */
+void js_q15_condition(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output);
+void js_q15_condition_reference(JsQ15Conditioner * conditioner, const int16_t * input, int16_t * output);
+
+/* event action to be used by an event handler (with event_action_arg pointing to the JsQ15Conditioner) */
+JsResult js_q15_event_action(const JsEvent * event, void * arg);
+
+#pragma GCC visibility pop
+
+#endif
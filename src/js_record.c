@@ -0,0 +1,851 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "js_record.h"
+
+/****************************************************************************************************
+ *
+ * Block Compression
+ *
+ ***************************************************************************************************/
+
+/* longest sleep of a replay between checks of is_running (in ns) */
+#define js_replay_max_sleep 100'000'000
+
+#define js_lz4_min_match 4
+/* the last match must start at least 12 bytes before the end of the input */
+#define js_lz4_mf_limit 12
+/* the last 5 bytes are always literals */
+#define js_lz4_last_literals 5
+#define js_lz4_hash_bits 12
+#define js_lz4_max_offset 65535
+
+static uint32_t js_read32(const uint8_t * p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t js_lz4_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - js_lz4_hash_bits);
+}
+
+/* write an extended length (the part exceeding 15) */
+static uint8_t * js_lz4_put_length(uint8_t * op, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t) length;
+    return op;
+}
+
+static size_t js_lz4_sequence_size(size_t literals)
+{
+    return 1 + (literals >= 15 ? 1 + (literals - 15) / 255 : 0) + literals;
+}
+
+size_t js_compress(const uint8_t * src, size_t src_size, uint8_t * dst, size_t dst_capacity)
+{
+    uint32_t table[1 << js_lz4_hash_bits] = {};
+    uint8_t * op = dst;
+    uint8_t * const op_end = dst + dst_capacity;
+    size_t ip = 0;
+    size_t anchor = 0;
+
+    if (src_size > js_lz4_mf_limit) {
+        const size_t ip_limit = src_size - js_lz4_mf_limit;
+        const size_t match_limit = src_size - js_lz4_last_literals;
+
+        while (ip < ip_limit) {
+            const uint32_t sequence = js_read32(&src[ip]);
+            const uint32_t h = js_lz4_hash(sequence);
+            const size_t ref = table[h];
+            table[h] = (uint32_t) ip;
+
+            if (ref >= ip || ip - ref > js_lz4_max_offset || js_read32(&src[ref]) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            size_t match_length = js_lz4_min_match;
+            while (ip + match_length < match_limit && src[ref + match_length] == src[ip + match_length]) {
+                ++match_length;
+            }
+
+            /* literals, offset (2 bytes) and extended match length */
+            const size_t literals = ip - anchor;
+            const size_t ml = match_length - js_lz4_min_match;
+            if (op + js_lz4_sequence_size(literals) + 2 + (ml >= 15 ? 1 + ml / 255 : 0) > op_end) {
+                return 0;
+            }
+            uint8_t * const token = op++;
+            *token = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+            if (literals >= 15) {
+                op = js_lz4_put_length(op, literals - 15);
+            }
+            memcpy(op, &src[anchor], literals);
+            op += literals;
+
+            const size_t offset = ip - ref;
+            *op++ = (uint8_t) offset;
+            *op++ = (uint8_t) (offset >> 8);
+
+            *token |= (uint8_t) (ml < 15 ? ml : 15);
+            if (ml >= 15) {
+                op = js_lz4_put_length(op, ml - 15);
+            }
+
+            ip += match_length;
+            anchor = ip;
+        }
+    }
+
+    /* last literals */
+    const size_t literals = src_size - anchor;
+    if (op + js_lz4_sequence_size(literals) > op_end) {
+        return 0;
+    }
+    *op++ = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        op = js_lz4_put_length(op, literals - 15);
+    }
+    memcpy(op, &src[anchor], literals);
+    op += literals;
+
+    return op - dst;
+}
+
+size_t js_decompress(const uint8_t * src, size_t src_size, uint8_t * dst, size_t dst_capacity)
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < src_size) {
+        const uint8_t token = src[ip++];
+
+        /* literals */
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= src_size) {
+                    return 0;
+                }
+                b = src[ip++];
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > src_size - ip || literals > dst_capacity - op) {
+            return 0;
+        }
+        memcpy(&dst[op], &src[ip], literals);
+        ip += literals;
+        op += literals;
+
+        /* the last sequence has no match */
+        if (ip == src_size) {
+            break;
+        }
+
+        /* match */
+        if (src_size - ip < 2) {
+            return 0;
+        }
+        const size_t offset = src[ip] | (((size_t) src[ip + 1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) {
+            return 0;
+        }
+        size_t match_length = token & 15;
+        if (match_length == 15) {
+            uint8_t b;
+            do {
+                if (ip >= src_size) {
+                    return 0;
+                }
+                b = src[ip++];
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += js_lz4_min_match;
+        if (match_length > dst_capacity - op) {
+            return 0;
+        }
+        /* matches may overlap with the output (byte-wise copy) */
+        for (size_t i=0; i<match_length; ++i, ++op) {
+            dst[op] = dst[op - offset];
+        }
+    }
+
+    return op;
+}
+
+/****************************************************************************************************
+ *
+ * Block Checksum
+ *
+ ***************************************************************************************************/
+
+static uint32_t js_crc32c_table[256];
+static once_flag js_crc32c_once = ONCE_FLAG_INIT;
+
+static void js_crc32c_init(void)
+{
+    for (uint32_t i=0; i<256; ++i) {
+        uint32_t c = i;
+        for (unsigned int k=0; k<8; ++k) {
+            c = (c >> 1) ^ (c & 1 ? 0x82F63B78 : 0);
+        }
+        js_crc32c_table[i] = c;
+    }
+}
+
+static uint32_t js_crc32c(uint32_t crc, const uint8_t * data, size_t size)
+{
+    crc = ~crc;
+    for (size_t i=0; i<size; ++i) {
+        crc = js_crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* CRC-32C of the header (with a zero checksum) and the payload */
+static uint32_t js_record_block_checksum(const JsRecordBlockHeader * header, const uint8_t * payload)
+{
+    call_once(&js_crc32c_once, js_crc32c_init);
+
+    JsRecordBlockHeader h = *header;
+    h.checksum = 0;
+    const uint32_t crc = js_crc32c(0, (const uint8_t*) &h, sizeof(h));
+    return js_crc32c(crc, payload, header->size);
+}
+
+/****************************************************************************************************
+ *
+ * Recorder
+ *
+ ***************************************************************************************************/
+
+/* worst case size of a compressed block */
+#define js_record_max_payload \
+    (js_record_block_events * sizeof(JsEvent) + js_record_block_events * sizeof(JsEvent) / 255 + 16)
+
+static JsResult js_write_all(int fd, const void * data, size_t size)
+{
+    const uint8_t * p = (const uint8_t*) data;
+    while (size > 0) {
+        const ssize_t s = write(fd, p, size);
+        if (s < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return JsResult_failure;
+        }
+        p += s;
+        size -= s;
+    }
+    return JsResult_success;
+}
+
+/* make the directory entry of a newly created file durable */
+static JsResult js_sync_parent_directory(const char * path)
+{
+    char directory[4096] = ".";
+    const char * const slash = strrchr(path, '/');
+    if (slash) {
+        const size_t length = slash == path ? 1 : (size_t) (slash - path);
+        if (length >= sizeof(directory)) {
+            return JsResult_failure;
+        }
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+    }
+
+    const int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return JsResult_failure;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced ? JsResult_success : JsResult_failure;
+}
+
+static JsResult js_recorder_add_index_entry(JsRecorder * recorder, const JsRecordIndexEntry * entry)
+{
+    if (recorder->number_of_blocks == recorder->index_capacity) {
+        const size_t capacity = recorder->index_capacity ? 2 * recorder->index_capacity : 64;
+        JsRecordIndexEntry * const index = realloc(recorder->index, capacity * sizeof(*index));
+        if (!index) {
+            return JsResult_failure;
+        }
+        recorder->index = index;
+        recorder->index_capacity = capacity;
+    }
+    recorder->index[recorder->number_of_blocks++] = *entry;
+    return JsResult_success;
+}
+
+/* compress and write a block (only called by the compressor thread) */
+static JsResult js_recorder_write_block(JsRecorder * recorder, const JsEvent * events, size_t number_of_events)
+{
+    static thread_local JsEvent deltas[js_record_block_events];
+    static thread_local uint8_t payload[js_record_max_payload];
+
+    if (number_of_events == 0) {
+        return JsResult_success;
+    }
+
+    /* store time differences */
+    uint32_t previous = events[0].time;
+    for (size_t i=0; i<number_of_events; ++i) {
+        deltas[i] = events[i];
+        deltas[i].time = events[i].time - previous;
+        previous = events[i].time;
+    }
+
+    const size_t raw_size = number_of_events * sizeof(JsEvent);
+    JsRecordBlockHeader header = {
+        .magic = js_record_block_magic,
+        .number_of_events = number_of_events,
+        .first_time = events[0].time,
+        .last_time = events[number_of_events - 1].time
+    };
+
+    /* fall back to raw storage if compression does not pay off */
+    const uint8_t * data = payload;
+    header.size = js_compress((const uint8_t*) deltas, raw_size, payload, raw_size - 1);
+    if (header.size == 0) {
+        header.size = raw_size;
+        header.flags |= JsRecordBlockFlag_raw;
+        data = (const uint8_t*) deltas;
+    }
+    header.checksum = js_record_block_checksum(&header, data);
+
+    const JsRecordIndexEntry entry = {
+        .offset = recorder->offset,
+        .number_of_events = header.number_of_events,
+        .first_time = header.first_time
+    };
+    if (js_write_all(recorder->fd, &header, sizeof(header)) != JsResult_success
+        || js_write_all(recorder->fd, data, header.size) != JsResult_success
+        || js_recorder_add_index_entry(recorder, &entry) != JsResult_success) {
+        return JsResult_failure;
+    }
+    recorder->offset += sizeof(header) + header.size;
+    recorder->is_synced = false;
+    return JsResult_success;
+}
+
+/* write the events of block i that have not been written yet */
+static JsResult js_recorder_flush_block(JsRecorder * recorder, size_t i)
+{
+    const size_t n = atomic_load_explicit(&recorder->block_sizes[i], memory_order_acquire);
+    const size_t flushed = recorder->block_flushed[i];
+    recorder->block_flushed[i] = n;
+    return js_recorder_write_block(recorder, &recorder->blocks[i][flushed], n - flushed);
+}
+
+static struct timespec js_recorder_next_sync(const JsRecorder * recorder)
+{
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    const int64_t ns = t.tv_nsec + ((int64_t) recorder->sync_interval) * 1'000'000;
+    t.tv_sec += ns / 1'000'000'000;
+    t.tv_nsec = ns % 1'000'000'000;
+    return t;
+}
+
+static bool js_timespec_reached(const struct timespec * t)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec > t->tv_sec || (now.tv_sec == t->tv_sec && now.tv_nsec >= t->tv_nsec);
+}
+
+static int js_recorder_main(void * arg)
+{
+    JsRecorder * const recorder = (JsRecorder*) arg;
+    struct timespec next_sync = js_recorder_next_sync(recorder);
+
+    for (;;) {
+        if (mtx_lock(&recorder->lock) != thrd_success) {
+            goto exit_failure;
+        }
+        while (recorder->head == recorder->tail && recorder->is_running) {
+            /* with a durability window, wake up at least once per window */
+            if (recorder->sync_interval) {
+                if (cnd_timedwait(&recorder->block_ready, &recorder->lock, &next_sync) == thrd_timedout) {
+                    break;
+                }
+            }
+            else {
+                cnd_wait(&recorder->block_ready, &recorder->lock);
+            }
+        }
+        const bool has_block = recorder->head != recorder->tail;
+        const bool is_done = !has_block && !recorder->is_running;
+        const size_t i = (has_block ? recorder->head : recorder->tail) % js_recorder_queue_length;
+        mtx_unlock(&recorder->lock);
+
+        JsResult r = JsResult_success;
+        if (has_block) {
+            /* the block is not touched by the recording thread until head is advanced */
+            r = js_recorder_flush_block(recorder, i);
+
+            mtx_lock(&recorder->lock);
+            atomic_store_explicit(&recorder->block_sizes[i], 0, memory_order_relaxed);
+            recorder->block_flushed[i] = 0;
+            ++recorder->head;
+            cnd_signal(&recorder->block_free);
+            mtx_unlock(&recorder->lock);
+        }
+
+        /* group commit: once per window, write the queued blocks, then the events of the block being
+         * filled, and sync (the window only restarts when everything has been written) */
+        if (r == JsResult_success && recorder->sync_interval && js_timespec_reached(&next_sync)) {
+            mtx_lock(&recorder->lock);
+            const bool is_drained = recorder->head == recorder->tail;
+            const bool is_filling = recorder->is_running;
+            const size_t k = recorder->tail % js_recorder_queue_length;
+            mtx_unlock(&recorder->lock);
+
+            if (is_drained) {
+                if (is_filling) {
+                    r = js_recorder_flush_block(recorder, k);
+                }
+                if (r == JsResult_success && !recorder->is_synced) {
+                    r = fdatasync(recorder->fd) == 0 ? JsResult_success : JsResult_failure;
+                    recorder->is_synced = true;
+                }
+                next_sync = js_recorder_next_sync(recorder);
+            }
+        }
+
+        if (r != JsResult_success) {
+            mtx_lock(&recorder->lock);
+            recorder->has_failed = true;
+            cnd_signal(&recorder->block_free);
+            mtx_unlock(&recorder->lock);
+            goto exit_failure;
+        }
+        if (is_done) {
+            break;
+        }
+    }
+
+    return EXIT_SUCCESS;
+
+    exit_failure:
+    return EXIT_FAILURE;
+}
+
+JsResult js_create_recorder(JsRecorder * recorder, const char * path, uint32_t sync_interval)
+{
+    recorder->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (recorder->fd < 0) {
+        return JsResult_failure;
+    }
+
+    for (size_t i=0; i<js_recorder_queue_length; ++i) {
+        atomic_init(&recorder->block_sizes[i], 0);
+        recorder->block_flushed[i] = 0;
+    }
+    recorder->head = 0;
+    recorder->tail = 0;
+    recorder->index = nullptr;
+    recorder->number_of_blocks = 0;
+    recorder->index_capacity = 0;
+    recorder->sync_interval = sync_interval;
+    recorder->is_synced = false;
+    recorder->is_running = true;
+    recorder->has_failed = false;
+
+    const JsRecordFileHeader header = {.magic = js_record_magic, .version = js_record_version};
+    if (js_write_all(recorder->fd, &header, sizeof(header)) != JsResult_success) {
+        goto init_lock_error;
+    }
+    recorder->offset = sizeof(header);
+
+    /* the file itself has to survive a crash for its blocks to be recoverable */
+    if (sync_interval && (fsync(recorder->fd) != 0 || js_sync_parent_directory(path) != JsResult_success)) {
+        goto init_lock_error;
+    }
+
+    if (mtx_init(&recorder->lock, mtx_plain) != thrd_success) {
+        goto init_lock_error;
+    }
+    if (cnd_init(&recorder->block_ready) != thrd_success) {
+        goto init_block_ready_error;
+    }
+    if (cnd_init(&recorder->block_free) != thrd_success) {
+        goto init_block_free_error;
+    }
+    if (thrd_create(&recorder->thread_id, js_recorder_main, (void*) recorder) != thrd_success) {
+        goto create_thread_error;
+    }
+
+    return JsResult_success;
+
+    create_thread_error:
+    cnd_destroy(&recorder->block_free);
+    init_block_free_error:
+    cnd_destroy(&recorder->block_ready);
+    init_block_ready_error:
+    mtx_destroy(&recorder->lock);
+    init_lock_error:
+    close(recorder->fd);
+    return JsResult_failure;
+}
+
+/* hand the block currently being filled over to the compressor thread */
+static JsResult js_recorder_submit(JsRecorder * recorder)
+{
+    if (mtx_lock(&recorder->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+    ++recorder->tail;
+    cnd_signal(&recorder->block_ready);
+
+    /* wait for a free block (only happens if the disk cannot keep up) */
+    while (recorder->tail - recorder->head == js_recorder_queue_length && !recorder->has_failed) {
+        cnd_wait(&recorder->block_free, &recorder->lock);
+    }
+    const bool has_failed = recorder->has_failed;
+
+    if (mtx_unlock(&recorder->lock) != thrd_success || has_failed) {
+        return JsResult_failure;
+    }
+    return JsResult_success;
+}
+
+JsResult js_record_event(JsRecorder * recorder, const JsEvent * event)
+{
+    const size_t i = recorder->tail % js_recorder_queue_length;
+    const size_t n = atomic_load_explicit(&recorder->block_sizes[i], memory_order_relaxed);
+    recorder->blocks[i][n] = *event;
+
+    /* publish the event to the compressor thread (which may write partial blocks) */
+    atomic_store_explicit(&recorder->block_sizes[i], n + 1, memory_order_release);
+
+    return (
+        n + 1 == js_record_block_events
+        ? js_recorder_submit(recorder)
+        : JsResult_success
+    );
+}
+
+JsResult js_recorder_event_action(const JsEvent * event, void * arg)
+{
+    return js_record_event((JsRecorder*) arg, event);
+}
+
+JsResult js_destroy_recorder(JsRecorder * recorder)
+{
+    JsResult r = JsResult_success;
+
+    /* flush the partially filled block and let the compressor thread finish */
+    mtx_lock(&recorder->lock);
+    const size_t i = recorder->tail % js_recorder_queue_length;
+    if (atomic_load_explicit(&recorder->block_sizes[i], memory_order_relaxed) > 0) {
+        ++recorder->tail;
+    }
+    recorder->is_running = false;
+    cnd_signal(&recorder->block_ready);
+    mtx_unlock(&recorder->lock);
+
+    int return_val;
+    if (thrd_join(recorder->thread_id, &return_val) != thrd_success || return_val != EXIT_SUCCESS
+        || recorder->has_failed) {
+        r = JsResult_failure;
+    }
+
+    /* block index */
+    const JsRecordFileFooter footer = {
+        .magic = js_record_index_magic,
+        .number_of_blocks = recorder->number_of_blocks,
+        .index_offset = recorder->offset
+    };
+    if (r == JsResult_success && (
+        js_write_all(recorder->fd, recorder->index, recorder->number_of_blocks * sizeof(JsRecordIndexEntry)) != JsResult_success
+        || js_write_all(recorder->fd, &footer, sizeof(footer)) != JsResult_success
+        || (recorder->sync_interval && fdatasync(recorder->fd) != 0))) {
+        r = JsResult_failure;
+    }
+
+    free(recorder->index);
+    cnd_destroy(&recorder->block_free);
+    cnd_destroy(&recorder->block_ready);
+    mtx_destroy(&recorder->lock);
+    if (close(recorder->fd) != 0) {
+        r = JsResult_failure;
+    }
+    return r;
+}
+
+/****************************************************************************************************
+ *
+ * Recording (Reader)
+ *
+ ***************************************************************************************************/
+
+/* copy and validate the block at offset (headers within the file need not be aligned) */
+static bool js_recording_block_header(const JsRecording * recording, size_t offset, JsRecordBlockHeader * header)
+{
+    if (offset > recording->size || recording->size - offset < sizeof(*header)) {
+        return false;
+    }
+    memcpy(header, &recording->data[offset], sizeof(*header));
+    return (
+        header->magic == js_record_block_magic
+        && header->number_of_events > 0 && header->number_of_events <= js_record_block_events
+        && header->size <= recording->size - offset - sizeof(*header)
+        && header->checksum == js_record_block_checksum(header, &recording->data[offset + sizeof(*header)])
+    );
+}
+
+static JsResult js_recording_add_block(JsRecording * recording, size_t * capacity, size_t offset,
+    const JsRecordBlockHeader * header)
+{
+    if (recording->number_of_blocks == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 64;
+        JsRecordBlockInfo * const blocks = realloc(recording->blocks, *capacity * sizeof(*blocks));
+        if (!blocks) {
+            return JsResult_failure;
+        }
+        recording->blocks = blocks;
+    }
+    recording->blocks[recording->number_of_blocks++] = (JsRecordBlockInfo){
+        .offset = offset,
+        .first_event = recording->number_of_events,
+        .number_of_events = header->number_of_events,
+        .first_time = header->first_time
+    };
+    recording->number_of_events += header->number_of_events;
+    return JsResult_success;
+}
+
+/* use the block index at the end of the file (if there is a valid one) */
+static bool js_recording_read_index(JsRecording * recording, size_t * capacity)
+{
+    const size_t minimum_size = sizeof(JsRecordFileHeader) + sizeof(JsRecordFileFooter);
+    if (recording->size < minimum_size) {
+        return false;
+    }
+    JsRecordFileFooter footer;
+    memcpy(&footer, &recording->data[recording->size - sizeof(footer)], sizeof(footer));
+    if (footer.magic != js_record_index_magic || footer.index_offset < sizeof(JsRecordFileHeader)
+        || footer.index_offset > recording->size - sizeof(footer)
+        || (recording->size - sizeof(footer) - footer.index_offset) != footer.number_of_blocks * sizeof(JsRecordIndexEntry)) {
+        return false;
+    }
+
+    for (size_t i=0; i<footer.number_of_blocks; ++i) {
+        JsRecordIndexEntry entry;
+        memcpy(&entry, &recording->data[footer.index_offset + i * sizeof(entry)], sizeof(entry));
+        JsRecordBlockHeader header;
+        if (!js_recording_block_header(recording, entry.offset, &header)
+            || js_recording_add_block(recording, capacity, entry.offset, &header) != JsResult_success) {
+            recording->number_of_blocks = 0;
+            recording->number_of_events = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+JsResult js_open_recording(JsRecording * recording, const char * path)
+{
+    *recording = (JsRecording){};
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return JsResult_failure;
+    }
+    struct stat s;
+    if (fstat(fd, &s) != 0 || !(recording->data = malloc(s.st_size ? s.st_size : 1))) {
+        goto read_error;
+    }
+    while (recording->size < (size_t) s.st_size) {
+        const ssize_t n = read(fd, &recording->data[recording->size], s.st_size - recording->size);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            goto read_error;
+        }
+        recording->size += n;
+    }
+    close(fd);
+
+    JsRecordFileHeader header;
+    if (recording->size < sizeof(header)) {
+        goto format_error;
+    }
+    memcpy(&header, recording->data, sizeof(header));
+    if (header.magic != js_record_magic || header.version != js_record_version) {
+        goto format_error;
+    }
+
+    /* reconstruct the index by scanning the blocks if the recording was not closed properly */
+    size_t capacity = 0;
+    if (!js_recording_read_index(recording, &capacity)) {
+        size_t offset = sizeof(header);
+        JsRecordBlockHeader block;
+        while (js_recording_block_header(recording, offset, &block)) {
+            if (js_recording_add_block(recording, &capacity, offset, &block) != JsResult_success) {
+                goto format_error;
+            }
+            offset += sizeof(block) + block.size;
+        }
+    }
+
+    return JsResult_success;
+
+    read_error:
+    close(fd);
+    format_error:
+    js_close_recording(recording);
+    return JsResult_failure;
+}
+
+void js_close_recording(JsRecording * recording)
+{
+    free(recording->blocks);
+    free(recording->data);
+    *recording = (JsRecording){};
+}
+
+JsResult js_decode_block(const JsRecording * recording, size_t block, JsEvent * events)
+{
+    if (block >= recording->number_of_blocks) {
+        return JsResult_failure;
+    }
+    const size_t offset = recording->blocks[block].offset;
+    JsRecordBlockHeader header;
+    memcpy(&header, &recording->data[offset], sizeof(header));
+    const uint8_t * const payload = &recording->data[offset + sizeof(header)];
+    const size_t raw_size = header.number_of_events * sizeof(JsEvent);
+
+    if (header.flags & JsRecordBlockFlag_raw) {
+        if (header.size != raw_size) {
+            return JsResult_failure;
+        }
+        memcpy(events, payload, raw_size);
+    }
+    else if (js_decompress(payload, header.size, (uint8_t*) events, raw_size) != raw_size) {
+        return JsResult_failure;
+    }
+
+    /* restore absolute times */
+    uint32_t time = header.first_time;
+    for (size_t i=0; i<header.number_of_events; ++i) {
+        time += events[i].time;
+        events[i].time = time;
+    }
+    return JsResult_success;
+}
+
+typedef struct JsDecodeTask {
+    const JsRecording * recording;
+    JsEvent * events;
+    atomic_size_t next_block;
+    atomic_bool has_failed;
+} JsDecodeTask;
+
+static int js_decode_main(void * arg)
+{
+    JsDecodeTask * const task = (JsDecodeTask*) arg;
+
+    /* blocks are handed out one at a time, so threads finishing early pick up the remaining work */
+    size_t block;
+    while ((block = atomic_fetch_add(&task->next_block, 1)) < task->recording->number_of_blocks) {
+        JsEvent * const events = &task->events[task->recording->blocks[block].first_event];
+        if (js_decode_block(task->recording, block, events) != JsResult_success) {
+            task->has_failed = true;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+JsResult js_decode_recording(const JsRecording * recording, JsEvent * events, unsigned int number_of_threads)
+{
+    JsDecodeTask task = {.recording = recording, .events = events};
+    atomic_init(&task.next_block, 0);
+    atomic_init(&task.has_failed, false);
+
+    if (number_of_threads < 1) {
+        number_of_threads = 1;
+    }
+    thrd_t * const threads = malloc((number_of_threads - 1) * sizeof(thrd_t) + 1);
+    if (!threads) {
+        return JsResult_failure;
+    }
+
+    /* the calling thread takes part in decoding */
+    unsigned int number_of_started_threads = 0;
+    while (number_of_started_threads < number_of_threads - 1
+        && thrd_create(&threads[number_of_started_threads], js_decode_main, &task) == thrd_success) {
+        ++number_of_started_threads;
+    }
+    js_decode_main(&task);
+    for (unsigned int i=0; i<number_of_started_threads; ++i) {
+        thrd_join(threads[i], nullptr);
+    }
+    free(threads);
+
+    return task.has_failed ? JsResult_failure : JsResult_success;
+}
+
+JsResult js_replay_events(const JsEvent * events, size_t number_of_events, double speed,
+    JsResult (*event_action)(const JsEvent * event, void * arg), void * event_action_arg, const atomic_bool * is_running)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i=0; i<number_of_events; ++i) {
+        /* sleep until the (scaled) event time relative to the first event, in slices so that the
+         * replay stops soon after is_running is cleared (even during long gaps of slowed replays) */
+        if (speed > 0) {
+            const double delay = ((double) (uint32_t) (events[i].time - events[0].time)) / speed;
+            const int64_t due = (int64_t) start.tv_sec * 1'000'000'000 + start.tv_nsec + (int64_t) (delay * 1'000'000.0);
+            while (true) {
+                if (is_running && !*is_running) {
+                    return JsResult_success;
+                }
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                const int64_t remaining = due - ((int64_t) now.tv_sec * 1'000'000'000 + now.tv_nsec);
+                if (remaining <= 0) {
+                    break;
+                }
+                const int64_t ns = remaining < js_replay_max_sleep ? remaining : js_replay_max_sleep;
+                const struct timespec t = {.tv_sec = ns / 1'000'000'000, .tv_nsec = ns % 1'000'000'000};
+                clock_nanosleep(CLOCK_MONOTONIC, 0, &t, nullptr);
+            }
+        }
+        else if (is_running && !*is_running) {
+            return JsResult_success;
+        }
+
+        switch (event_action(&events[i], event_action_arg)) {
+            case JsResult_stop:
+                return JsResult_success;
+            case JsResult_failure:
+                return JsResult_failure;
+            default:
+                break;
+        }
+    }
+    return JsResult_success;
+}
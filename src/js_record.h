@@ -0,0 +1,176 @@
+#ifndef JS_RECORD_H
+#define JS_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Block Compression
+ *
+ ***************************************************************************************************/
+
+/* LZ4 block format (compatible with LZ4_decompress_safe), returns the compressed size or 0 if the
+ * result does not fit into the destination buffer */
+size_t js_compress(const uint8_t * src, size_t src_size, uint8_t * dst, size_t dst_capacity);
+/* returns the decompressed size or 0 if the input is malformed or does not fit */
+size_t js_decompress(const uint8_t * src, size_t src_size, uint8_t * dst, size_t dst_capacity);
+
+/****************************************************************************************************
+ *
+ * Recording File Format
+ *
+ ***************************************************************************************************/
+
+/*
+ * A recording consists of a file header followed by independently compressed blocks of events and
+ * a block index at the end of the file:
+ *
+ *     JsRecordFileHeader
+ *     JsRecordBlockHeader, payload (LZ4 compressed or raw events)
+ *     ...
+ *     JsRecordIndexEntry[number_of_blocks]
+ *     JsRecordFileFooter
+ *
+ * Within a block, the event time is stored as the difference to the previous event (to the first
+ * event time of the block for the first event), which makes the events highly compressible.
+ * Blocks are self-delimiting and checksummed, so recordings without index (e.g. of a crashed
+ * process or after a power loss) can still be read by scanning the blocks up to the first block
+ * that is incomplete or corrupted.
+ */
+
+#define js_record_magic 0x4352534A /* "JSRC" */
+#define js_record_block_magic 0x4B42534A /* "JSBK" */
+#define js_record_index_magic 0x5849534A /* "JSIX" */
+#define js_record_version 2
+
+/* maximum number of events per block */
+#define js_record_block_events 4096
+
+typedef struct JsRecordFileHeader {
+    uint32_t magic;
+    uint32_t version;
+} JsRecordFileHeader;
+
+typedef enum {
+    JsRecordBlockFlag_raw = (1 << 0)
+} JsRecordBlockFlag;
+
+typedef struct JsRecordBlockHeader {
+    uint32_t magic;
+    /* number of payload bytes following the header */
+    uint32_t size;
+    uint32_t number_of_events;
+    uint32_t first_time;
+    uint32_t last_time;
+    uint32_t flags;
+    /* CRC-32C of the header (with checksum 0) and the payload */
+    uint32_t checksum;
+} JsRecordBlockHeader;
+
+typedef struct JsRecordIndexEntry {
+    /* file offset of the block header */
+    uint64_t offset;
+    uint32_t number_of_events;
+    uint32_t first_time;
+} JsRecordIndexEntry;
+
+typedef struct JsRecordFileFooter {
+    uint32_t magic;
+    uint32_t number_of_blocks;
+    uint64_t index_offset;
+} JsRecordFileFooter;
+
+/****************************************************************************************************
+ *
+ * Recorder
+ *
+ ***************************************************************************************************/
+
+/* number of blocks that may be waiting for compression */
+#define js_recorder_queue_length 4
+
+typedef struct JsRecorder {
+    int fd;
+    /* raw blocks: filled by the recording thread, compressed and written by the compressor thread */
+    JsEvent blocks[js_recorder_queue_length][js_record_block_events];
+    _Atomic size_t block_sizes[js_recorder_queue_length];
+    /* number of events of each block already written (partial blocks are written on sync) */
+    size_t block_flushed[js_recorder_queue_length];
+    /* blocks [head, tail) are waiting for compression, block tail % length is being filled */
+    size_t head;
+    size_t tail;
+    /* block index */
+    JsRecordIndexEntry * index;
+    size_t number_of_blocks;
+    size_t index_capacity;
+    uint64_t offset;
+    /* durability window in ms (0 if the recording is never synced) */
+    uint32_t sync_interval;
+    bool is_synced;
+
+    mtx_t lock;
+    cnd_t block_ready;
+    cnd_t block_free;
+    thrd_t thread_id;
+    bool is_running;
+    bool has_failed;
+} JsRecorder;
+
+/* the JsRecorder is large and should be allocated dynamically or statically; with sync_interval > 0,
+ * all events are written and synced to disk (fdatasync) within sync_interval ms */
+JsResult js_create_recorder(JsRecorder * recorder, const char * path, uint32_t sync_interval);
+/* flushes all pending events and writes the block index */
+JsResult js_destroy_recorder(JsRecorder * recorder);
+JsResult js_record_event(JsRecorder * recorder, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsRecorder) */
+JsResult js_recorder_event_action(const JsEvent * event, void * arg);
+
+/****************************************************************************************************
+ *
+ * Recording (Reader)
+ *
+ ***************************************************************************************************/
+
+typedef struct JsRecordBlockInfo {
+    /* offset of the block header within data */
+    size_t offset;
+    /* index of the first event of the block within the recording */
+    size_t first_event;
+    uint32_t number_of_events;
+    uint32_t first_time;
+} JsRecordBlockInfo;
+
+typedef struct JsRecording {
+    /* file contents */
+    uint8_t * data;
+    size_t size;
+    /* block index (read from the file or reconstructed by scanning the blocks) */
+    JsRecordBlockInfo * blocks;
+    size_t number_of_blocks;
+    size_t number_of_events;
+} JsRecording;
+
+JsResult js_open_recording(JsRecording * recording, const char * path);
+void js_close_recording(JsRecording * recording);
+
+/* decode a single block into events (which must provide space for the number of events of the block) */
+JsResult js_decode_block(const JsRecording * recording, size_t block, JsEvent * events);
+/* decode all blocks using number_of_threads threads (events must provide space for all events) */
+JsResult js_decode_recording(const JsRecording * recording, JsEvent * events, unsigned int number_of_threads);
+
+/* replay events (in real time multiplied by speed, or as fast as possible if speed <= 0) until all
+ * events are replayed or the optional is_running is cleared (which is noticed within 100 ms) */
+JsResult js_replay_events(const JsEvent * events, size_t number_of_events, double speed,
+    JsResult (*event_action)(const JsEvent * event, void * arg), void * event_action_arg, const atomic_bool * is_running);
+
+#pragma GCC visibility pop
+
+#endif
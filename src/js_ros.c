@@ -0,0 +1,373 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "js_ros.h"
+
+/****************************************************************************************************
+ *
+ * sensor_msgs/Joy Serialization (ROS1 Wire Format)
+ *
+ ***************************************************************************************************/
+
+/* the ROS1 wire format is little endian (as is every platform this library runs on) */
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "big endian platforms are not supported");
+
+static void js_put_u32(uint8_t * data, uint32_t value)
+{
+    memcpy(data, &value, sizeof(value));
+}
+
+size_t js_joy_message_size(const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons)
+{
+    return (
+        4                                   /* length prefix */
+        + 4 + 4 + 4 + 4 + strlen(frame_id)  /* header */
+        + 4 + 4 * number_of_axes            /* axes */
+        + 4 + 4 * number_of_buttons         /* buttons */
+    );
+}
+
+JsResult js_init_joy_message(JsJoyMessage * message, uint8_t * buffer, size_t capacity,
+    const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons)
+{
+    if (number_of_axes > js_max_number_of_axes || number_of_buttons > js_max_number_of_buttons) {
+        return JsResult_failure;
+    }
+    const size_t size = js_joy_message_size(frame_id, number_of_axes, number_of_buttons);
+    if (capacity < size) {
+        return JsResult_failure;
+    }
+    const size_t frame_id_length = strlen(frame_id);
+
+    *message = (JsJoyMessage){
+        .data = buffer,
+        .size = size,
+        .stamp_offset = 4 + 4,
+        .axes_offset = 4 + 16 + frame_id_length + 4,
+        .buttons_offset = 4 + 16 + frame_id_length + 4 + 4 * number_of_axes + 4,
+        .number_of_axes = number_of_axes,
+        .number_of_buttons = number_of_buttons
+    };
+
+    /* fixed part of the layout */
+    memset(buffer, 0, size);
+    js_put_u32(&buffer[0], size - 4);
+    js_put_u32(&buffer[16], frame_id_length);
+    memcpy(&buffer[20], frame_id, frame_id_length);
+    js_put_u32(&buffer[message->axes_offset - 4], number_of_axes);
+    js_put_u32(&buffer[message->buttons_offset - 4], number_of_buttons);
+
+    return JsResult_success;
+}
+
+void js_serialize_joy(JsJoyMessage * message, const JsState * state, const struct timespec * stamp)
+{
+    struct timespec now;
+    if (!stamp) {
+        timespec_get(&now, TIME_UTC);
+        stamp = &now;
+    }
+
+    uint8_t * const data = message->data;
+    js_put_u32(&data[4], message->seq++);
+    js_put_u32(&data[message->stamp_offset], (uint32_t) stamp->tv_sec);
+    js_put_u32(&data[message->stamp_offset + 4], (uint32_t) stamp->tv_nsec);
+
+    for (uint32_t i=0; i<message->number_of_axes; ++i) {
+        const float value = state->axes[i] ? -((float) state->axes[i]) / 32767.0f : 0.0f;
+        memcpy(&data[message->axes_offset + 4 * i], &value, sizeof(value));
+    }
+    for (uint32_t i=0; i<message->number_of_buttons; ++i) {
+        const int32_t value = (state->buttons >> i) & 1;
+        memcpy(&data[message->buttons_offset + 4 * i], &value, sizeof(value));
+    }
+}
+
+/****************************************************************************************************
+ *
+ * TCPROS Publisher
+ *
+ ***************************************************************************************************/
+
+static const char js_joy_message_definition[] =
+    "# Reports the state of a joysticks axes and buttons.\n"
+    "Header header\n"
+    "float32[] axes\n"
+    "int32[] buttons\n"
+    "\n"
+    "================================================================================\n"
+    "MSG: std_msgs/Header\n"
+    "uint32 seq\n"
+    "time stamp\n"
+    "string frame_id\n";
+
+/* maximum size of a connection header sent by a subscriber */
+#define js_ros_max_header_size 65536
+
+static uint64_t js_ros_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000 + t.tv_nsec / 1'000'000;
+}
+
+static JsResult js_read_exactly(int fd, void * data, size_t size)
+{
+    uint8_t * p = (uint8_t*) data;
+    while (size > 0) {
+        const ssize_t s = read(fd, p, size);
+        if (s <= 0) {
+            if (s < 0 && errno == EINTR) {
+                continue;
+            }
+            return JsResult_failure;
+        }
+        p += s;
+        size -= s;
+    }
+    return JsResult_success;
+}
+
+/* append a connection header field "key=value" (returns the new size or 0 if it does not fit) */
+static size_t js_ros_put_field(uint8_t * data, size_t size, size_t capacity, const char * key, const char * value)
+{
+    const size_t key_length = strlen(key);
+    const size_t value_length = strlen(value);
+    const size_t length = key_length + 1 + value_length;
+    if (size == 0 || capacity - size < 4 + length) {
+        return 0;
+    }
+    js_put_u32(&data[size], length);
+    memcpy(&data[size + 4], key, key_length);
+    data[size + 4 + key_length] = '=';
+    memcpy(&data[size + 5 + key_length], value, value_length);
+    return size + 4 + length;
+}
+
+/* look up a field of a connection header (returns its length or -1 if it is missing) */
+static ssize_t js_ros_get_field(const uint8_t * data, size_t size, const char * key, const char ** value)
+{
+    const size_t key_length = strlen(key);
+    size_t position = 0;
+    while (size - position >= 4) {
+        uint32_t length;
+        memcpy(&length, &data[position], sizeof(length));
+        position += 4;
+        if (length > size - position) {
+            return -1;
+        }
+        const char * const field = (const char*) &data[position];
+        if (length > key_length && memcmp(field, key, key_length) == 0 && field[key_length] == '=') {
+            *value = field + key_length + 1;
+            return length - key_length - 1;
+        }
+        position += length;
+    }
+    return -1;
+}
+
+static bool js_ros_field_matches(const uint8_t * data, size_t size, const char * key, const char * expected)
+{
+    const char * value;
+    const ssize_t length = js_ros_get_field(data, size, key, &value);
+    if (length < 0) {
+        /* missing fields are not checked */
+        return true;
+    }
+    return (
+        (length == 1 && value[0] == '*')
+        || ((size_t) length == strlen(expected) && memcmp(value, expected, length) == 0)
+    );
+}
+
+/* exchange connection headers with a newly connected subscriber once its header has arrived
+ * completely (returns JsResult_nothing if it has not) */
+static JsResult js_ros_handshake(JsRosPublisher * publisher, int fd)
+{
+    static thread_local uint8_t request[js_ros_max_header_size];
+    static thread_local uint8_t response[4096];
+
+    /* the header is only read when it is complete, so the reads below do not block */
+    uint32_t size;
+    const ssize_t s = recv(fd, &size, sizeof(size), MSG_PEEK | MSG_DONTWAIT);
+    if (s == 0 || (s < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        return JsResult_failure;
+    }
+    if (s < (ssize_t) sizeof(size)) {
+        return JsResult_nothing;
+    }
+    if (size > sizeof(request)) {
+        return JsResult_failure;
+    }
+    int available;
+    if (ioctl(fd, FIONREAD, &available) != 0) {
+        return JsResult_failure;
+    }
+    if ((size_t) available < sizeof(size) + size) {
+        return JsResult_nothing;
+    }
+    if (js_read_exactly(fd, &size, sizeof(size)) != JsResult_success
+        || js_read_exactly(fd, request, size) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    const bool matches = (
+        js_ros_field_matches(request, size, "md5sum", js_joy_md5sum)
+        && js_ros_field_matches(request, size, "type", js_joy_type)
+    );
+
+    /* the first 4 bytes hold the size of the header */
+    size_t n = 4;
+    if (matches) {
+        n = js_ros_put_field(response, n, sizeof(response), "callerid", publisher->callerid);
+        n = js_ros_put_field(response, n, sizeof(response), "latching", "0");
+        n = js_ros_put_field(response, n, sizeof(response), "md5sum", js_joy_md5sum);
+        n = js_ros_put_field(response, n, sizeof(response), "message_definition", js_joy_message_definition);
+        n = js_ros_put_field(response, n, sizeof(response), "topic", publisher->topic);
+        n = js_ros_put_field(response, n, sizeof(response), "type", js_joy_type);
+    }
+    else {
+        n = js_ros_put_field(response, n, sizeof(response), "error", "message type or md5sum mismatch");
+    }
+    if (n == 0) {
+        return JsResult_failure;
+    }
+    js_put_u32(response, n - 4);
+
+    /* the response fits into the empty send buffer of the new connection */
+    return (
+        send(fd, response, n, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t) n && matches
+        ? JsResult_success
+        : JsResult_failure
+    );
+}
+
+JsResult js_create_ros_publisher(JsRosPublisher * publisher, const char * address, uint16_t port,
+    const char * callerid, const char * topic, uint8_t * buffer, size_t capacity,
+    const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons)
+{
+    if (strlen(callerid) >= sizeof(publisher->callerid) || strlen(topic) >= sizeof(publisher->topic)) {
+        return JsResult_failure;
+    }
+    strcpy(publisher->callerid, callerid);
+    strcpy(publisher->topic, topic);
+    publisher->number_of_subscribers = 0;
+    publisher->number_of_pending = 0;
+
+    if (js_init_joy_message(&publisher->message, buffer, capacity, frame_id, number_of_axes, number_of_buttons) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    struct sockaddr_in a = {.sin_family = AF_INET, .sin_port = htons(port)};
+    if (inet_pton(AF_INET, address, &a.sin_addr) != 1) {
+        return JsResult_failure;
+    }
+
+    publisher->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (publisher->fd < 0) {
+        return JsResult_failure;
+    }
+    const int reuse = 1;
+    if (setsockopt(publisher->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+        || bind(publisher->fd, (const struct sockaddr*) &a, sizeof(a)) != 0
+        || listen(publisher->fd, js_ros_max_subscribers) != 0) {
+        close(publisher->fd);
+        return JsResult_failure;
+    }
+
+    return JsResult_success;
+}
+
+JsResult js_destroy_ros_publisher(JsRosPublisher * publisher)
+{
+    for (size_t i=0; i<publisher->number_of_subscribers; ++i) {
+        close(publisher->subscribers[i]);
+    }
+    publisher->number_of_subscribers = 0;
+    for (size_t i=0; i<publisher->number_of_pending; ++i) {
+        close(publisher->pending[i]);
+    }
+    publisher->number_of_pending = 0;
+    return close(publisher->fd) == 0 ? JsResult_success : JsResult_failure;
+}
+
+JsResult js_ros_publisher_accept(JsRosPublisher * publisher)
+{
+    JsResult r = JsResult_nothing;
+    const uint64_t now = js_ros_now();
+
+    int fd;
+    while ((fd = accept4(publisher->fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        const int no_delay = 1;
+        if (publisher->number_of_subscribers + publisher->number_of_pending == js_ros_max_subscribers
+            || setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay)) != 0) {
+            close(fd);
+            continue;
+        }
+        publisher->pending[publisher->number_of_pending] = fd;
+        publisher->pending_since[publisher->number_of_pending] = now;
+        ++publisher->number_of_pending;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        r = JsResult_failure;
+    }
+
+    for (size_t i=0; i<publisher->number_of_pending;) {
+        fd = publisher->pending[i];
+        const JsResult h = js_ros_handshake(publisher, fd);
+        if (h == JsResult_nothing && now - publisher->pending_since[i] < js_ros_handshake_timeout) {
+            ++i;
+            continue;
+        }
+
+        if (h == JsResult_success) {
+            publisher->subscribers[publisher->number_of_subscribers++] = fd;
+            if (r == JsResult_nothing) {
+                r = JsResult_success;
+            }
+        }
+        else {
+            close(fd);
+        }
+        --publisher->number_of_pending;
+        publisher->pending[i] = publisher->pending[publisher->number_of_pending];
+        publisher->pending_since[i] = publisher->pending_since[publisher->number_of_pending];
+    }
+
+    return r;
+}
+
+JsResult js_ros_publish(JsRosPublisher * publisher, const JsState * state, const struct timespec * stamp)
+{
+    js_serialize_joy(&publisher->message, state, stamp);
+
+    for (size_t i=0; i<publisher->number_of_subscribers;) {
+        const ssize_t s = send(
+            publisher->subscribers[i], publisher->message.data, publisher->message.size,
+            MSG_NOSIGNAL | MSG_DONTWAIT
+        );
+
+        /* message sent completely or skipped (socket buffer full) */
+        if (s == (ssize_t) publisher->message.size || (s < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+            ++i;
+            continue;
+        }
+
+        /* disconnected or partially sent (which would corrupt the stream) -> drop subscriber */
+        close(publisher->subscribers[i]);
+        publisher->subscribers[i] = publisher->subscribers[--publisher->number_of_subscribers];
+    }
+
+    return JsResult_success;
+}
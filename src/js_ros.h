@@ -0,0 +1,98 @@
+#ifndef JS_ROS_H
+#define JS_ROS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * sensor_msgs/Joy Serialization (ROS1 Wire Format)
+ *
+ ***************************************************************************************************/
+
+/*
+ * ROS1 serialization of sensor_msgs/Joy (little endian) preceded by the 4-byte length prefix used
+ * by TCPROS:
+ *
+ *     uint32 length
+ *     Header header (uint32 seq, uint32 secs, uint32 nsecs, string frame_id)
+ *     float32[] axes
+ *     int32[] buttons
+ *
+ * The layout only depends on the frame id and the numbers of axes and buttons, so it is written
+ * once by js_init_joy_message and js_serialize_joy only overwrites the variable fields in place.
+ * Axes are converted like the ROS joy node does, i.e. -value / 32767.
+ */
+
+#define js_joy_md5sum "5a9ea5f83505693b71e785041e67a8bb"
+#define js_joy_type "sensor_msgs/Joy"
+
+typedef struct JsJoyMessage {
+    /* preallocated buffer holding the serialized message (including the length prefix) */
+    uint8_t * data;
+    size_t size;
+    /* offsets of the variable fields */
+    size_t stamp_offset;
+    size_t axes_offset;
+    size_t buttons_offset;
+    uint32_t number_of_axes;
+    uint32_t number_of_buttons;
+    uint32_t seq;
+} JsJoyMessage;
+
+/* number of bytes required for a message (including the length prefix) */
+size_t js_joy_message_size(const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons);
+JsResult js_init_joy_message(JsJoyMessage * message, uint8_t * buffer, size_t capacity,
+    const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons);
+/* write state (and stamp, seq) into the message (stamp defaults to the current time if nullptr) */
+void js_serialize_joy(JsJoyMessage * message, const JsState * state, const struct timespec * stamp);
+
+/****************************************************************************************************
+ *
+ * TCPROS Publisher
+ *
+ ***************************************************************************************************/
+
+/*
+ * A minimal TCPROS server publishing sensor_msgs/Joy messages without any ROS client library (and
+ * without threads). It does not register with a ROS master, i.e. subscribers have to connect to the
+ * given address and port directly (e.g. a stand-in subscriber or a relay registered with the master).
+ */
+
+#define js_ros_max_subscribers 8
+/* connections that have not sent their connection header within this time (in ms) are dropped */
+#define js_ros_handshake_timeout 1000
+
+typedef struct JsRosPublisher {
+    int fd;
+    int subscribers[js_ros_max_subscribers];
+    size_t number_of_subscribers;
+    /* connections waiting for their connection header (and CLOCK_MONOTONIC time of accept in ms) */
+    int pending[js_ros_max_subscribers];
+    uint64_t pending_since[js_ros_max_subscribers];
+    size_t number_of_pending;
+    char callerid[64];
+    char topic[128];
+    JsJoyMessage message;
+} JsRosPublisher;
+
+/* the buffer must provide js_joy_message_size(...) bytes and stay valid until the publisher is destroyed */
+JsResult js_create_ros_publisher(JsRosPublisher * publisher, const char * address, uint16_t port,
+    const char * callerid, const char * topic, uint8_t * buffer, size_t capacity,
+    const char * frame_id, uint32_t number_of_axes, uint32_t number_of_buttons);
+JsResult js_destroy_ros_publisher(JsRosPublisher * publisher);
+/* accept new connections and complete the handshakes of connections whose connection header has
+ * arrived (never blocks, i.e. a handshake takes several calls if the header arrives later; returns
+ * JsResult_nothing if no subscriber has been added) */
+JsResult js_ros_publisher_accept(JsRosPublisher * publisher);
+/* serialize the state and send it to all subscribers (subscribers that cannot keep up miss messages) */
+JsResult js_ros_publish(JsRosPublisher * publisher, const JsState * state, const struct timespec * stamp);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,191 @@
+#include <string.h>
+
+#include <sys/mman.h>
+
+#include "js_rt.h"
+
+/****************************************************************************************************
+ *
+ * Real-Time Profile
+ *
+ ***************************************************************************************************/
+
+static_assert(sizeof(JsState) % sizeof(uint32_t) == 0, "JsState must consist of whole 32-bit words");
+
+#define js_rt_number_of_words (sizeof(JsState) / sizeof(uint32_t))
+
+void js_init_rt_state(JsRtState * rt_state)
+{
+    rt_state->state = (JsState){};
+    atomic_init(&rt_state->sequence, 0);
+    for (size_t i=0; i<js_rt_number_of_words; ++i) {
+        atomic_init(&rt_state->words[i], 0);
+    }
+    atomic_init(&rt_state->stamp_sequence, 0);
+    atomic_init(&rt_state->stamp_time, 0);
+}
+
+JsResult js_rt_state_update(JsRtState * rt_state, const JsEvent * event)
+{
+    if (js_update_state(&rt_state->state, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    uint32_t words[js_rt_number_of_words];
+    memcpy(words, &rt_state->state, sizeof(words));
+    const JsEventStamp stamp = js_get_event_stamp();
+
+    const uint32_t s = atomic_load_explicit(&rt_state->sequence, memory_order_relaxed);
+    atomic_store_explicit(&rt_state->sequence, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i=0; i<js_rt_number_of_words; ++i) {
+        atomic_store_explicit(&rt_state->words[i], words[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&rt_state->stamp_sequence, stamp.sequence, memory_order_relaxed);
+    atomic_store_explicit(&rt_state->stamp_time, stamp.time, memory_order_relaxed);
+    atomic_store_explicit(&rt_state->sequence, s + 2, memory_order_release);
+
+    return JsResult_success;
+}
+
+JsResult js_rt_state_event_action(const JsEvent * event, void * arg)
+{
+    JsRtState * const rt_state = (JsRtState*) arg;
+
+    if (js_rt_state_update(rt_state, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    return rt_state->event_action ? rt_state->event_action(event, rt_state->event_action_arg) : JsResult_success;
+}
+
+JsResult js_rt_query_state(const JsRtState * rt_state, JsState * state)
+{
+    JsEventStamp stamp;
+    return js_rt_query_stamped_state(rt_state, state, &stamp);
+}
+
+JsResult js_rt_query_stamped_state(const JsRtState * rt_state, JsState * state, JsEventStamp * stamp)
+{
+    for (unsigned int i=0; i<js_rt_max_retries; ++i) {
+        const uint32_t before = atomic_load_explicit(&rt_state->sequence, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        uint32_t words[js_rt_number_of_words];
+        for (size_t j=0; j<js_rt_number_of_words; ++j) {
+            words[j] = atomic_load_explicit(&rt_state->words[j], memory_order_relaxed);
+        }
+        const JsEventStamp s = {
+            .sequence = atomic_load_explicit(&rt_state->stamp_sequence, memory_order_relaxed),
+            .time = atomic_load_explicit(&rt_state->stamp_time, memory_order_relaxed)
+        };
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&rt_state->sequence, memory_order_relaxed) == before) {
+            memcpy(state, words, sizeof(words));
+            *stamp = s;
+            return JsResult_success;
+        }
+    }
+
+    return JsResult_nothing;
+}
+
+JsResult js_init_rt_queue(JsRtQueue * rt_queue, JsEvent * events, uint32_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1))) {
+        return JsResult_failure;
+    }
+
+    rt_queue->events = events;
+    rt_queue->capacity = capacity;
+    atomic_init(&rt_queue->head, 0);
+    atomic_init(&rt_queue->tail, 0);
+    atomic_init(&rt_queue->button_head, 0);
+    atomic_init(&rt_queue->button_tail, 0);
+    atomic_init(&rt_queue->number_of_dropped_events, 0);
+    atomic_init(&rt_queue->number_of_dropped_button_events, 0);
+
+    return JsResult_success;
+}
+
+/* single producer/single consumer ring (JsResult_nothing if it is full) */
+static JsResult js_rt_ring_push(JsEvent * events, uint32_t capacity, _Atomic uint32_t * head,
+    _Atomic uint32_t * tail, const JsEvent * event)
+{
+    const uint32_t t = atomic_load_explicit(tail, memory_order_relaxed);
+    const uint32_t h = atomic_load_explicit(head, memory_order_acquire);
+    if (t - h == capacity) {
+        return JsResult_nothing;
+    }
+
+    events[t & (capacity - 1)] = *event;
+    atomic_store_explicit(tail, t + 1, memory_order_release);
+
+    return JsResult_success;
+}
+
+static JsResult js_rt_ring_pop(const JsEvent * events, uint32_t capacity, _Atomic uint32_t * head,
+    _Atomic uint32_t * tail, JsEvent * event)
+{
+    const uint32_t h = atomic_load_explicit(head, memory_order_relaxed);
+    const uint32_t t = atomic_load_explicit(tail, memory_order_acquire);
+    if (h == t) {
+        return JsResult_nothing;
+    }
+
+    *event = events[h & (capacity - 1)];
+    atomic_store_explicit(head, h + 1, memory_order_release);
+
+    return JsResult_success;
+}
+
+JsResult js_rt_queue_push(JsRtQueue * rt_queue, const JsEvent * event)
+{
+    /* button edges are rare and must not be lost to a backlog of axis events */
+    const bool is_button = event->type & JS_EVENT_BUTTON;
+    const JsResult r = (
+        is_button
+        ? js_rt_ring_push(rt_queue->button_events, js_rt_button_lane_capacity, &rt_queue->button_head, &rt_queue->button_tail, event)
+        : js_rt_ring_push(rt_queue->events, rt_queue->capacity, &rt_queue->head, &rt_queue->tail, event)
+    );
+    if (r != JsResult_success) {
+        atomic_fetch_add_explicit(&rt_queue->number_of_dropped_events, 1, memory_order_relaxed);
+        if (is_button) {
+            atomic_fetch_add_explicit(&rt_queue->number_of_dropped_button_events, 1, memory_order_relaxed);
+        }
+    }
+
+    return r;
+}
+
+JsResult js_rt_queue_event_action(const JsEvent * event, void * arg)
+{
+    JsRtQueue * const rt_queue = (JsRtQueue*) arg;
+
+    /* a full queue is not an error of the event handler */
+    js_rt_queue_push(rt_queue, event);
+
+    return rt_queue->event_action ? rt_queue->event_action(event, rt_queue->event_action_arg) : JsResult_success;
+}
+
+JsResult js_rt_queue_pop(JsRtQueue * rt_queue, JsEvent * event)
+{
+    if (js_rt_ring_pop(rt_queue->button_events, js_rt_button_lane_capacity, &rt_queue->button_head, &rt_queue->button_tail, event) == JsResult_success) {
+        return JsResult_success;
+    }
+    return js_rt_ring_pop(rt_queue->events, rt_queue->capacity, &rt_queue->head, &rt_queue->tail, event);
+}
+
+JsResult js_rt_lock_memory(size_t stack_size)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        return JsResult_failure;
+    }
+
+    /* touch the stack so that later growth does not cause page faults */
+    unsigned char stack[stack_size ? stack_size : 1];
+    explicit_bzero(stack, sizeof(stack));
+
+    return JsResult_success;
+}
@@ -0,0 +1,113 @@
+#ifndef JS_RT_H
+#define JS_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Real-Time Profile
+ *
+ ***************************************************************************************************/
+
+/*
+ * In the real-time profile, the input path (event handler thread -> callbacks -> RT thread) neither
+ * allocates memory, nor takes a mutex, nor prints, nor makes a syscall that may block for an
+ * unbounded time once it has been set up:
+ *
+ * + the event handler only performs non-blocking reads of the device and bounded sleeps (and reads
+ *   CLOCK_MONOTONIC through the vDSO if a budget is set),
+ * + the state is published to the RT thread by a JsRtState (seqlock, readers never block the writer
+ *   and give up after a bounded number of retries),
+ * + events are passed to the RT thread by a JsRtQueue (single producer/single consumer rings in
+ *   preallocated memory, full queues drop new events and count them; button events have a lane of
+ *   their own, so a backlog of axis events never costs a button edge).
+ *
+ * RT-safe after creation: js_get_event(s), js_update_state, JsEventHandler, JsRtState, JsRtQueue,
+ * JsGestureRecognizer, JsHistory (js_history_append), JsEventRing (js_publish_event, and
+ * js_receive_event on the subscriber side), JsLiveConfig (js_live_config_event_action, while
+ * configurations are published from other threads), JsHidDevice (js_hid_process_ready),
+ * JsQ15Conditioner (js_q15_event_action), JsScopeRing (js_scope_ring_push).
+ * Not RT-safe (they lock non-PI mutexes or allocate): JsAsyncState, JsTiming, JsFeatureExtractor,
+ * JsRecorder, JsTimerWheel/JsInputTimers, the ROS publisher and all display functions.
+ *
+ * `make rt-verify` checks exactly the functions listed as RT-safe in a stress run that intercepts
+ * allocation, locking, waiting, stdio and file synchronization calls and fails if any of them occurs
+ * on the input path. The C++ pipeline (js_pipeline.hpp) does not allocate or lock either, but it is
+ * not covered by the stress run.
+ */
+
+/* number of attempts of js_rt_query_state before giving up */
+#define js_rt_max_retries 64
+
+typedef struct JsRtState {
+    /* optional callback executed for each event (after the state has been published) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    JsState state;
+    /* odd while an update is in progress */
+    _Atomic uint32_t sequence;
+    /* published copy of state */
+    _Atomic uint32_t words[sizeof(JsState) / sizeof(uint32_t)];
+    /* published stamp of the most recent update (see js_get_event_stamp) */
+    _Atomic uint64_t stamp_sequence;
+    _Atomic uint64_t stamp_time;
+} JsRtState;
+
+void js_init_rt_state(JsRtState * rt_state);
+/* update and publish the state (single writer) */
+JsResult js_rt_state_update(JsRtState * rt_state, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsRtState) */
+JsResult js_rt_state_event_action(const JsEvent * event, void * arg);
+/* obtain a consistent copy of the state without blocking (JsResult_nothing if the writer kept interfering) */
+JsResult js_rt_query_state(const JsRtState * rt_state, JsState * state);
+/* same as js_rt_query_state, additionally obtaining the stamp of the event that last updated the state */
+JsResult js_rt_query_stamped_state(const JsRtState * rt_state, JsState * state, JsEventStamp * stamp);
+
+/* capacity of the button lane of a JsRtQueue (power of 2) */
+#define js_rt_button_lane_capacity 256
+
+typedef struct JsRtQueue {
+    /* optional callback executed for each event (after it has been queued) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    JsEvent * events;
+    uint32_t capacity;
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    /* button events (popped before the other events) */
+    JsEvent button_events[js_rt_button_lane_capacity];
+    _Atomic uint32_t button_head;
+    _Atomic uint32_t button_tail;
+    atomic_uint_fast64_t number_of_dropped_events;
+    /* dropped button events (also counted by number_of_dropped_events) */
+    atomic_uint_fast64_t number_of_dropped_button_events;
+} JsRtQueue;
+
+/* events must provide capacity (a power of 2) events and stay valid while the queue is in use (button
+ * events are queued separately in js_rt_button_lane_capacity events of the queue itself) */
+JsResult js_init_rt_queue(JsRtQueue * rt_queue, JsEvent * events, uint32_t capacity);
+/* producer side (JsResult_nothing if the lane of the event is full and the event was dropped) */
+JsResult js_rt_queue_push(JsRtQueue * rt_queue, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsRtQueue) */
+JsResult js_rt_queue_event_action(const JsEvent * event, void * arg);
+/* consumer side (JsResult_nothing if the queue is empty); queued button events come first, i.e. a
+ * button event may overtake axis events queued before it (each lane keeps its order) */
+JsResult js_rt_queue_pop(JsRtQueue * rt_queue, JsEvent * event);
+
+/* lock all current and future pages into memory and prefault stack_size bytes of the calling
+ * thread's stack (to be called during startup of each RT thread) */
+JsResult js_rt_lock_memory(size_t stack_size);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,454 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include "js_scope.h"
+
+/****************************************************************************************************
+ *
+ * Sample Ring
+ *
+ ***************************************************************************************************/
+
+#define js_scope_words_per_sample (sizeof(JsScopeSample) / sizeof(uint32_t))
+
+static_assert(sizeof(JsScopeSample) % sizeof(uint32_t) == 0, "samples must consist of whole words");
+
+JsResult js_create_scope_ring(JsScopeRing * ring, size_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1))) {
+        return JsResult_failure;
+    }
+
+    ring->words = (_Atomic uint32_t*) malloc(capacity * js_scope_words_per_sample * sizeof(_Atomic uint32_t));
+    if (!ring->words) {
+        return JsResult_failure;
+    }
+    for (size_t i=0; i<capacity * js_scope_words_per_sample; ++i) {
+        atomic_init(&ring->words[i], 0);
+    }
+    ring->capacity = capacity;
+    atomic_init(&ring->head, 0);
+    ring->state = (JsState){};
+
+    return JsResult_success;
+}
+
+void js_destroy_scope_ring(JsScopeRing * ring)
+{
+    free(ring->words);
+    ring->words = nullptr;
+}
+
+JsResult js_scope_ring_push(JsScopeRing * ring, const JsEvent * event)
+{
+    if (js_update_state(&ring->state, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    /* outside of an event handler, the sample is stamped with the current time */
+    const JsEventStamp stamp = js_get_event_stamp();
+    JsScopeSample sample = {
+        .time = stamp.time,
+        .event_time = event->time,
+        .buttons = ring->state.buttons
+    };
+    if (stamp.sequence == 0) {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        sample.time = (uint64_t) t.tv_sec * 1'000'000'000 + (uint64_t) t.tv_nsec;
+    }
+    memcpy(sample.axes, ring->state.axes, sizeof(sample.axes));
+
+    uint32_t words[js_scope_words_per_sample];
+    memcpy(words, &sample, sizeof(words));
+    const uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    _Atomic uint32_t * const slot = &ring->words[(head & (ring->capacity - 1)) * js_scope_words_per_sample];
+    /* the words must not become visible before the head published by the previous push (pairs with
+     * the acquire fence of js_scope_ring_read: a reader that sees any word of this sample also sees
+     * head >= this index and discards the slot) */
+    atomic_thread_fence(memory_order_release);
+    for (size_t i=0; i<js_scope_words_per_sample; ++i) {
+        atomic_store_explicit(&slot[i], words[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return JsResult_success;
+}
+
+JsResult js_scope_ring_event_action(const JsEvent * event, void * arg)
+{
+    JsScopeRing * const ring = (JsScopeRing*) arg;
+
+    if (js_scope_ring_push(ring, event) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    return ring->event_action ? ring->event_action(event, ring->event_action_arg) : JsResult_success;
+}
+
+size_t js_scope_ring_read(const JsScopeRing * ring, JsScopeSample * samples, size_t max_number_of_samples, uint64_t since)
+{
+    const uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t n = max_number_of_samples < ring->capacity ? max_number_of_samples : ring->capacity;
+    n = head < n ? (size_t) head : n;
+
+    /* walk back from the newest sample to the first one older than since (only the time is loaded;
+     * a slot overwritten in the meantime holds a newer time and is discarded below anyway) */
+    if (since > 0) {
+        size_t k = 0;
+        while (k < n) {
+            const uint_fast64_t index = head - 1 - k;
+            const _Atomic uint32_t * const slot = &ring->words[(index & (ring->capacity - 1)) * js_scope_words_per_sample];
+            uint32_t words[sizeof(uint64_t) / sizeof(uint32_t)];
+            for (size_t j=0; j<sizeof(words) / sizeof(words[0]); ++j) {
+                words[j] = atomic_load_explicit(&slot[j], memory_order_relaxed);
+            }
+            uint64_t time;
+            memcpy(&time, words, sizeof(time));
+            ++k;
+            if (time < since) {
+                break;
+            }
+        }
+        n = k;
+    }
+
+    for (size_t i=0; i<n; ++i) {
+        const uint_fast64_t index = head - n + i;
+        const _Atomic uint32_t * const slot = &ring->words[(index & (ring->capacity - 1)) * js_scope_words_per_sample];
+        uint32_t words[js_scope_words_per_sample];
+        for (size_t j=0; j<js_scope_words_per_sample; ++j) {
+            words[j] = atomic_load_explicit(&slot[j], memory_order_relaxed);
+        }
+        memcpy(&samples[i], words, sizeof(words));
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    /* the writer may have overwritten the oldest samples in the meantime (including the one it is
+     * currently writing, which belongs to index head - capacity) */
+    const uint_fast64_t end = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const uint_fast64_t first_valid = end >= ring->capacity ? end - ring->capacity + 1 : 0;
+    const uint_fast64_t first = head - n;
+    if (first_valid > first) {
+        const size_t skipped = first_valid - first < n ? (size_t) (first_valid - first) : n;
+        memmove(samples, &samples[skipped], (n - skipped) * sizeof(JsScopeSample));
+        n -= skipped;
+    }
+
+    return n;
+}
+
+/****************************************************************************************************
+ *
+ * Terminal Oscilloscope
+ *
+ ***************************************************************************************************/
+
+/* columns of the labels left of the lanes (e.g. "A0  -32767 ") */
+#define js_scope_label_width 11
+#define js_scope_min_plot_width 8
+
+/* range of the interval lane (decades of ns) */
+#define js_scope_min_interval_decade 5.0
+#define js_scope_max_interval_decade 9.0
+
+static inline unsigned int js_scope_dots_x(const JsScope * scope)
+{
+    return scope->style == JsScopeStyle_braille ? 2 : 1;
+}
+
+static inline unsigned int js_scope_dots_y(const JsScope * scope)
+{
+    return scope->style == JsScopeStyle_braille ? 4 : 2;
+}
+
+JsResult js_create_scope(JsScope * scope)
+{
+    unsigned int number_of_axes = 0;
+    for (unsigned int i=0; i<js_max_number_of_axes; ++i) {
+        number_of_axes += (scope->axes >> i) & 1;
+    }
+
+    /* one lane per axis and the interval lane above the status line */
+    scope->number_of_lanes = number_of_axes + 1;
+    scope->lane_height = scope->height > 1 ? (scope->height - 1) / scope->number_of_lanes : 0;
+    if (scope->lane_height == 0 || scope->width < js_scope_label_width + js_scope_min_plot_width
+        || scope->window == 0 || scope->style > JsScopeStyle_blocks) {
+        return JsResult_failure;
+    }
+
+    const size_t number_of_cells = (size_t) scope->width * scope->height;
+    const size_t number_of_dots = (size_t) (scope->width - js_scope_label_width) * js_scope_dots_x(scope)
+        * scope->lane_height * js_scope_dots_y(scope);
+    /* worst case: cursor positioning and a 3 byte character for every cell */
+    scope->output_capacity = number_of_cells * 16 + 64;
+    scope->cells = (uint32_t*) malloc(number_of_cells * sizeof(uint32_t));
+    scope->previous = (uint32_t*) malloc(number_of_cells * sizeof(uint32_t));
+    scope->dots = (uint8_t*) malloc(number_of_dots);
+    scope->output = (char*) malloc(scope->output_capacity);
+    if (!scope->cells || !scope->previous || !scope->dots || !scope->output) {
+        js_destroy_scope(scope);
+        return JsResult_failure;
+    }
+
+    js_scope_invalidate(scope);
+    return JsResult_success;
+}
+
+void js_destroy_scope(JsScope * scope)
+{
+    free(scope->cells);
+    free(scope->previous);
+    free(scope->dots);
+    free(scope->output);
+    scope->cells = nullptr;
+    scope->previous = nullptr;
+    scope->dots = nullptr;
+    scope->output = nullptr;
+}
+
+void js_scope_invalidate(JsScope * scope)
+{
+    /* no cell is ever 0, so every cell differs */
+    memset(scope->previous, 0, (size_t) scope->width * scope->height * sizeof(uint32_t));
+}
+
+static void js_scope_text(JsScope * scope, unsigned int row, unsigned int column, unsigned int width, const char * text)
+{
+    uint32_t * const cells = &scope->cells[(size_t) row * scope->width + column];
+    for (unsigned int i=0; i<width && column + i < scope->width; ++i) {
+        cells[i] = *text ? (uint32_t) (unsigned char) *text++ : ' ';
+    }
+}
+
+/* dot row of an axis value (+32767 at the top) */
+static inline unsigned int js_scope_value_row(int32_t value, unsigned int number_of_rows)
+{
+    return (unsigned int) ((int64_t) (32767 - value) * (number_of_rows - 1) / 65535);
+}
+
+static void js_scope_plot_axis(JsScope * scope, const JsScopeSample * samples, size_t number_of_samples,
+    uint64_t start, unsigned int axis, unsigned int columns, unsigned int rows)
+{
+    /* each dot column covers an equal part of the window: the segment between the minimum and
+     * the maximum of the value held at its start and the values of its samples is set */
+    size_t i = 0;
+    bool has_value = false;
+    int32_t value = 0;
+    for (unsigned int c=0; c<columns; ++c) {
+        const uint64_t end = start + (scope->window * (c + 1)) / columns;
+        int32_t minimum = value;
+        int32_t maximum = value;
+        bool is_set = has_value;
+        for (; i<number_of_samples && samples[i].time < end; ++i) {
+            value = samples[i].axes[axis];
+            minimum = !is_set || value < minimum ? value : minimum;
+            maximum = !is_set || value > maximum ? value : maximum;
+            is_set = true;
+        }
+        has_value = is_set;
+        if (!is_set) {
+            continue;
+        }
+        const unsigned int top = js_scope_value_row(maximum, rows);
+        const unsigned int bottom = js_scope_value_row(minimum, rows);
+        for (unsigned int r=top; r<=bottom; ++r) {
+            scope->dots[(size_t) r * columns + c] = 1;
+        }
+    }
+}
+
+static void js_scope_plot_intervals(JsScope * scope, const JsScopeSample * samples, size_t number_of_samples,
+    uint64_t start, unsigned int columns, unsigned int rows)
+{
+    /* one dot per event at the height of the interval to its predecessor (longer intervals higher) */
+    for (size_t i=1; i<number_of_samples; ++i) {
+        if (samples[i].time < start) {
+            continue;
+        }
+        const uint64_t interval = samples[i].time - samples[i - 1].time;
+        double decade = interval ? log10((double) interval) : js_scope_min_interval_decade;
+        decade = decade < js_scope_min_interval_decade ? js_scope_min_interval_decade : decade;
+        decade = decade > js_scope_max_interval_decade ? js_scope_max_interval_decade : decade;
+        const unsigned int r = (unsigned int) ((js_scope_max_interval_decade - decade)
+            / (js_scope_max_interval_decade - js_scope_min_interval_decade) * (rows - 1) + 0.5);
+        uint64_t c = (samples[i].time - start) * columns / scope->window;
+        c = c < columns ? c : columns - 1;
+        scope->dots[(size_t) r * columns + c] = 1;
+    }
+}
+
+/* convert the dots of a lane into the cells of its plot area */
+static void js_scope_fill_lane(JsScope * scope, unsigned int lane, unsigned int columns)
+{
+    static const uint8_t braille_bits[4][2] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+    const unsigned int dx = js_scope_dots_x(scope);
+    const unsigned int dy = js_scope_dots_y(scope);
+
+    for (unsigned int row=0; row<scope->lane_height; ++row) {
+        uint32_t * const cells = &scope->cells[(size_t) (lane * scope->lane_height + row) * scope->width + js_scope_label_width];
+        for (unsigned int column=0; column<scope->width - js_scope_label_width; ++column) {
+            unsigned int bits = 0;
+            for (unsigned int y=0; y<dy; ++y) {
+                for (unsigned int x=0; x<dx; ++x) {
+                    if (scope->dots[(size_t) (row * dy + y) * columns + column * dx + x]) {
+                        bits |= scope->style == JsScopeStyle_braille ? braille_bits[y][x] : (1u << y);
+                    }
+                }
+            }
+            if (bits == 0) {
+                cells[column] = ' ';
+            }
+            else if (scope->style == JsScopeStyle_braille) {
+                cells[column] = 0x2800 + bits;
+            }
+            else {
+                /* upper half, lower half or full block */
+                cells[column] = bits == 1 ? 0x2580 : (bits == 2 ? 0x2584 : 0x2588);
+            }
+        }
+    }
+}
+
+static void js_scope_status(JsScope * scope, const JsScopeSample * samples, size_t number_of_samples, uint64_t start)
+{
+    size_t n = 0;
+    uint64_t min_interval = UINT64_MAX;
+    uint64_t max_interval = 0;
+    /* latency jitter: spread of the read time relative to the kernel time of the events */
+    int64_t min_offset = INT64_MAX;
+    int64_t max_offset = INT64_MIN;
+    for (size_t i=0; i<number_of_samples; ++i) {
+        if (samples[i].time < start) {
+            continue;
+        }
+        ++n;
+        const int64_t offset = (int64_t) (samples[i].time - samples[0].time)
+            - (int64_t) (uint32_t) (samples[i].event_time - samples[0].event_time) * 1'000'000;
+        min_offset = offset < min_offset ? offset : min_offset;
+        max_offset = offset > max_offset ? offset : max_offset;
+        if (i > 0) {
+            const uint64_t interval = samples[i].time - samples[i - 1].time;
+            min_interval = interval < min_interval ? interval : min_interval;
+            max_interval = interval > max_interval ? interval : max_interval;
+        }
+    }
+
+    char text[256];
+    if (n > 1) {
+        snprintf(text, sizeof(text), "%.0f events/s  interval %.2f-%.2f ms  latency jitter %.1f ms  buttons %08" PRIx32,
+            (double) n * 1e9 / (double) scope->window, (double) min_interval * 1e-6, (double) max_interval * 1e-6,
+            (double) (max_offset - min_offset) * 1e-6, samples[number_of_samples - 1].buttons);
+    }
+    else {
+        snprintf(text, sizeof(text), "%zu events  buttons %08" PRIx32, n,
+            number_of_samples ? samples[number_of_samples - 1].buttons : 0);
+    }
+    js_scope_text(scope, scope->height - 1, 0, scope->width, text);
+}
+
+static inline size_t js_scope_encode(uint32_t code_point, char * output)
+{
+    if (code_point < 0x80) {
+        output[0] = (char) code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        output[0] = (char) (0xC0 | (code_point >> 6));
+        output[1] = (char) (0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    output[0] = (char) (0xE0 | (code_point >> 12));
+    output[1] = (char) (0x80 | ((code_point >> 6) & 0x3F));
+    output[2] = (char) (0x80 | (code_point & 0x3F));
+    return 3;
+}
+
+static JsResult js_scope_write(int fd, const char * data, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return JsResult_failure;
+        }
+        data += n;
+        size -= (size_t) n;
+    }
+    return JsResult_success;
+}
+
+JsResult js_scope_draw(JsScope * scope, const JsScopeSample * samples, size_t number_of_samples, uint64_t now, int fd)
+{
+    const uint64_t start = now > scope->window ? now - scope->window : 0;
+    const unsigned int columns = (scope->width - js_scope_label_width) * js_scope_dots_x(scope);
+    const unsigned int rows = scope->lane_height * js_scope_dots_y(scope);
+    const JsScopeSample * const last = number_of_samples ? &samples[number_of_samples - 1] : nullptr;
+
+    for (size_t i=0; i<(size_t) scope->width * scope->height; ++i) {
+        scope->cells[i] = ' ';
+    }
+
+    /* axis lanes */
+    char label[32];
+    unsigned int lane = 0;
+    for (unsigned int axis=0; axis<js_max_number_of_axes; ++axis) {
+        if (!((scope->axes >> axis) & 1)) {
+            continue;
+        }
+        memset(scope->dots, 0, (size_t) columns * rows);
+        js_scope_plot_axis(scope, samples, number_of_samples, start, axis, columns, rows);
+        js_scope_fill_lane(scope, lane, columns);
+        snprintf(label, sizeof(label), "A%-2u %6d", axis, last ? last->axes[axis] : 0);
+        js_scope_text(scope, lane * scope->lane_height, 0, js_scope_label_width, label);
+        ++lane;
+    }
+
+    /* interval lane */
+    memset(scope->dots, 0, (size_t) columns * rows);
+    js_scope_plot_intervals(scope, samples, number_of_samples, start, columns, rows);
+    js_scope_fill_lane(scope, lane, columns);
+    if (number_of_samples > 1) {
+        snprintf(label, sizeof(label), "dt %5.1fms", (double) (last->time - last[-1].time) * 1e-6);
+    }
+    else {
+        snprintf(label, sizeof(label), "dt");
+    }
+    js_scope_text(scope, lane * scope->lane_height, 0, js_scope_label_width, label);
+    if (scope->lane_height > 1) {
+        js_scope_text(scope, (lane + 1) * scope->lane_height - 1, 0, js_scope_label_width, "   (log)");
+    }
+
+    js_scope_status(scope, samples, number_of_samples, start);
+
+    /* write the changed cells */
+    size_t size = 0;
+    unsigned int cursor_row = UINT32_MAX;
+    unsigned int cursor_column = UINT32_MAX;
+    for (unsigned int row=0; row<scope->height; ++row) {
+        for (unsigned int column=0; column<scope->width; ++column) {
+            const size_t i = (size_t) row * scope->width + column;
+            if (scope->cells[i] == scope->previous[i]) {
+                continue;
+            }
+            if (row != cursor_row || column != cursor_column) {
+                size += (size_t) snprintf(&scope->output[size], scope->output_capacity - size, "\033[%u;%uH", row + 1, column + 1);
+            }
+            size += js_scope_encode(scope->cells[i], &scope->output[size]);
+            scope->previous[i] = scope->cells[i];
+            cursor_row = row;
+            cursor_column = column + 1;
+        }
+    }
+
+    return size ? js_scope_write(fd, scope->output, size) : JsResult_success;
+}
@@ -0,0 +1,116 @@
+#ifndef JS_SCOPE_H
+#define JS_SCOPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Sample Ring
+ *
+ ***************************************************************************************************/
+
+/*
+ * The event handler thread appends the state after each event, stamped with its read time, to a
+ * ring that keeps the most recent samples. Readers (e.g. a display thread) copy any number of recent
+ * samples without blocking the writer: like JsRtState, the samples are stored as atomic words, and
+ * samples that the writer overwrote while they were being copied are discarded.
+ */
+
+typedef struct JsScopeSample {
+    /* CLOCK_MONOTONIC time in ns at which the event was read */
+    uint64_t time;
+    /* kernel time of the event in ms */
+    uint32_t event_time;
+    uint32_t buttons;
+    int16_t axes[js_max_number_of_axes];
+} JsScopeSample;
+
+typedef struct JsScopeRing {
+    /* optional callback executed for each event (after it has been appended) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    _Atomic uint32_t * words;
+    size_t capacity;
+    /* number of samples appended so far */
+    atomic_uint_fast64_t head;
+    JsState state;
+} JsScopeRing;
+
+/* capacity (number of samples) must be a power of 2 */
+JsResult js_create_scope_ring(JsScopeRing * ring, size_t capacity);
+void js_destroy_scope_ring(JsScopeRing * ring);
+/* update the state and append it (single writer) */
+JsResult js_scope_ring_push(JsScopeRing * ring, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsScopeRing) */
+JsResult js_scope_ring_event_action(const JsEvent * event, void * arg);
+/* copy up to max_number_of_samples of the most recent samples (oldest first) and return their number;
+ * if since is not 0, only the samples read at or after since and the last one before it (the state
+ * at since) are copied */
+size_t js_scope_ring_read(const JsScopeRing * ring, JsScopeSample * samples, size_t max_number_of_samples, uint64_t since);
+
+/****************************************************************************************************
+ *
+ * Terminal Oscilloscope
+ *
+ ***************************************************************************************************/
+
+/*
+ * Renders the samples of a time window as scrolling traces into a terminal of width x height cells:
+ * one lane per axis (with its label and current value), a lane showing the interval to the previous
+ * event of each event (logarithmic from 100 us to 1 s, so that the rate and its jitter are
+ * visible) and a status line. Braille characters provide 2 x 4 dots per cell, half blocks (for fonts
+ * without braille) 1 x 2.
+ *
+ * Every frame is rendered into a cell buffer and only the cells that differ from the previous frame
+ * are written (with cursor positioning between runs of changed cells), in a single write, so that a
+ * running scope costs little CPU and bandwidth (e.g. over SSH).
+ */
+
+typedef enum {
+    JsScopeStyle_braille,
+    JsScopeStyle_blocks
+} JsScopeStyle;
+
+typedef struct JsScope {
+    /* size of the terminal in cells */
+    unsigned int width;
+    unsigned int height;
+    uint8_t style;
+    /* axes to be shown (bit i: axis i) */
+    uint32_t axes;
+    /* time span shown in ns */
+    uint64_t window;
+
+    /* internal state (must not be modified) */
+    unsigned int number_of_lanes;
+    unsigned int lane_height;
+    /* current and previously written frame (unicode code points, row by row) */
+    uint32_t * cells;
+    uint32_t * previous;
+    /* dots of the plot area of a lane (one byte per dot) */
+    uint8_t * dots;
+    char * output;
+    size_t output_capacity;
+} JsScope;
+
+/* width, height, style, axes and window have to be set before; fails if the terminal is too small */
+JsResult js_create_scope(JsScope * scope);
+void js_destroy_scope(JsScope * scope);
+/* the next frame is written completely (e.g. after the screen has been cleared) */
+void js_scope_invalidate(JsScope * scope);
+/* render the samples (oldest first) of the window ending at now and write the changes to fd
+ * (cursor positions are relative to the top left corner of the screen) */
+JsResult js_scope_draw(JsScope * scope, const JsScopeSample * samples, size_t number_of_samples, uint64_t now, int fd);
+
+#pragma GCC visibility pop
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "js_shm.h"
+
+/****************************************************************************************************
+ *
+ * Shared-Memory Event Ring (Multi-Process Broadcast)
+ *
+ ***************************************************************************************************/
+
+static_assert(sizeof(JsEvent) == sizeof(uint64_t), "events must fit into a single 64-bit word");
+
+static const uint32_t js_event_ring_magic = 0x4A534552; /* "JSER" */
+
+static uint64_t js_event_to_bits(const JsEvent * event)
+{
+    uint64_t bits;
+    memcpy(&bits, event, sizeof(bits));
+    return bits;
+}
+
+static void js_event_from_bits(uint64_t bits, JsEvent * event)
+{
+    memcpy(event, &bits, sizeof(bits));
+}
+
+static size_t js_event_ring_size(uint32_t capacity)
+{
+    return sizeof(JsEventRingHeader) + ((size_t) capacity) * sizeof(JsEventRingSlot);
+}
+
+/* the segment has been left behind by a producer that no longer runs (or is not a ring) */
+static bool js_event_ring_is_stale(const char * name)
+{
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        /* removed meanwhile */
+        return errno == ENOENT;
+    }
+
+    struct stat s;
+    bool is_stale = false;
+    if (fstat(fd, &s) == 0) {
+        if ((size_t) s.st_size < sizeof(JsEventRingHeader)) {
+            is_stale = true;
+        }
+        else {
+            const JsEventRingHeader * const header = (const JsEventRingHeader*) mmap(
+                nullptr, sizeof(JsEventRingHeader), PROT_READ, MAP_SHARED, fd, 0
+            );
+            if (header != MAP_FAILED) {
+                const pid_t owner = (pid_t) atomic_load(&header->owner);
+                is_stale = header->magic != js_event_ring_magic || owner <= 0
+                    || (kill(owner, 0) != 0 && errno == ESRCH);
+                munmap((void*) header, sizeof(JsEventRingHeader));
+            }
+        }
+    }
+    close(fd);
+    return is_stale;
+}
+
+JsResult js_create_event_ring(JsEventRing * event_ring, const char * name, uint32_t capacity)
+{
+    if (strlen(name) >= sizeof(event_ring->name) || capacity == 0 || capacity > (1u << 31)) {
+        return JsResult_failure;
+    }
+    strcpy(event_ring->name, name);
+
+    /* round capacity up to a power of 2 */
+    uint32_t c = 1;
+    while (c < capacity) {
+        c <<= 1;
+    }
+    event_ring->size = js_event_ring_size(c);
+
+    /* replace stale segments (e.g. left behind by a crashed producer), but never the ring of a
+     * running producer */
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0 && errno == EEXIST && js_event_ring_is_stale(name)) {
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+    }
+    if (fd < 0) {
+        return JsResult_failure;
+    }
+    /* subscribers map the segment writable (futex and waiter count), independently of the umask */
+    if (fchmod(fd, 0660) != 0 || ftruncate(fd, event_ring->size) != 0) {
+        goto truncate_error;
+    }
+
+    void * const memory = mmap(nullptr, event_ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        goto truncate_error;
+    }
+    close(fd);
+
+    /* the segment is zero-initialized by ftruncate */
+    event_ring->header = (JsEventRingHeader*) memory;
+    event_ring->header->capacity = c;
+    atomic_store_explicit(&event_ring->header->write_sequence, 0, memory_order_relaxed);
+    atomic_store_explicit(&event_ring->header->owner, (int32_t) getpid(), memory_order_relaxed);
+    /* publish the magic number last (subscribers check it) */
+    atomic_thread_fence(memory_order_release);
+    event_ring->header->magic = js_event_ring_magic;
+
+    return JsResult_success;
+
+    truncate_error:
+    close(fd);
+    shm_unlink(name);
+    return JsResult_failure;
+}
+
+JsResult js_destroy_event_ring(JsEventRing * event_ring)
+{
+    /* existing subscribers keep their mapping until they unsubscribe */
+    const bool unmapped = munmap(event_ring->header, event_ring->size) == 0;
+    const bool unlinked = shm_unlink(event_ring->name) == 0;
+    return unmapped && unlinked ? JsResult_success : JsResult_failure;
+}
+
+void js_publish_event(JsEventRing * event_ring, const JsEvent * event)
+{
+    JsEventRingHeader * const header = event_ring->header;
+
+    const uint64_t w = atomic_load_explicit(&header->write_sequence, memory_order_relaxed);
+    JsEventRingSlot * const slot = &header->slots[w & (header->capacity - 1)];
+
+    /* mark the slot as being written (readers of the previous event in this slot detect the overrun) */
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->event, js_event_to_bits(event), memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, w + 1, memory_order_release);
+
+    /* sequentially consistent store/load pair (pairs with js_wait_event) */
+    atomic_store(&header->write_sequence, w + 1);
+    if (atomic_load(&header->waiters)) {
+        atomic_fetch_add(&header->futex, 1);
+        syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+JsResult js_event_ring_event_action(const JsEvent * event, void * arg)
+{
+    js_publish_event((JsEventRing*) arg, event);
+    return JsResult_success;
+}
+
+JsResult js_subscribe_event_ring(JsEventSubscriber * subscriber, const char * name)
+{
+    /* the mapping has to be writable for the futex and the waiter count */
+    const int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return JsResult_failure;
+    }
+
+    struct stat s;
+    if (fstat(fd, &s) != 0 || ((size_t) s.st_size) < sizeof(JsEventRingHeader)) {
+        close(fd);
+        return JsResult_failure;
+    }
+
+    void * const memory = mmap(nullptr, s.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return JsResult_failure;
+    }
+
+    JsEventRingHeader * const header = (JsEventRingHeader*) memory;
+    if (header->magic != js_event_ring_magic || js_event_ring_size(header->capacity) != (size_t) s.st_size) {
+        munmap(memory, s.st_size);
+        return JsResult_failure;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    *subscriber = (JsEventSubscriber){
+        .header = header,
+        .size = s.st_size,
+        .cursor = atomic_load_explicit(&header->write_sequence, memory_order_acquire)
+    };
+    return JsResult_success;
+}
+
+JsResult js_unsubscribe_event_ring(JsEventSubscriber * subscriber)
+{
+    return munmap(subscriber->header, subscriber->size) == 0 ? JsResult_success : JsResult_failure;
+}
+
+JsResult js_receive_event(JsEventSubscriber * subscriber, JsEvent * event)
+{
+    JsEventRingHeader * const header = subscriber->header;
+    const uint64_t capacity = header->capacity;
+
+    for (;;) {
+        const uint64_t c = subscriber->cursor;
+        const uint64_t w = atomic_load_explicit(&header->write_sequence, memory_order_acquire);
+        if (c >= w) {
+            return JsResult_nothing;
+        }
+
+        /* the producer has lapped this subscriber -> skip to the oldest event still available */
+        if (w - c > capacity) {
+            subscriber->lost += w - capacity - c;
+            subscriber->cursor = w - capacity;
+            continue;
+        }
+
+        const JsEventRingSlot * const slot = &header->slots[c & (capacity - 1)];
+        const uint64_t s = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        const uint64_t bits = atomic_load_explicit(&slot->event, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+
+        /* the slot has been (or is being) overwritten in the meantime */
+        if (s != c + 1 || atomic_load_explicit(&slot->sequence, memory_order_relaxed) != s) {
+            subscriber->lost += 1;
+            subscriber->cursor = c + 1;
+            continue;
+        }
+
+        js_event_from_bits(bits, event);
+        subscriber->cursor = c + 1;
+        return JsResult_success;
+    }
+}
+
+JsResult js_wait_event(JsEventSubscriber * subscriber, JsEvent * event, int timeout)
+{
+    JsEventRingHeader * const header = subscriber->header;
+
+    JsResult r = js_receive_event(subscriber, event);
+    if (r != JsResult_nothing) {
+        return r;
+    }
+
+    /* register as waiter before re-checking (pairs with js_publish_event) */
+    atomic_fetch_add(&header->waiters, 1);
+    const uint32_t f = atomic_load(&header->futex);
+    r = js_receive_event(subscriber, event);
+    if (r == JsResult_nothing) {
+        const struct timespec t = {.tv_sec = timeout / 1000, .tv_nsec = (timeout % 1000) * 1'000'000};
+        const long s = syscall(
+            SYS_futex, &header->futex, FUTEX_WAIT, f, timeout < 0 ? nullptr : &t, nullptr, 0
+        );
+        if (s != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+            r = JsResult_failure;
+        }
+        else {
+            r = js_receive_event(subscriber, event);
+        }
+    }
+    atomic_fetch_sub(&header->waiters, 1);
+
+    return r;
+}
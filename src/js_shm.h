@@ -0,0 +1,81 @@
+#ifndef JS_SHM_H
+#define JS_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Shared-Memory Event Ring (Multi-Process Broadcast)
+ *
+ ***************************************************************************************************/
+
+/*
+ * A single producer process publishes every raw event into a ring buffer in a POSIX shared memory
+ * segment, which any number of subscriber processes read at their own pace. Subscribers keep their
+ * cursors locally, so the producer never waits for (or even knows about) subscribers. A subscriber
+ * that falls behind by more than the capacity of the ring detects the overrun and skips ahead.
+ * The producer only enters the kernel (futex wake) if at least one subscriber is actually sleeping.
+ */
+
+typedef struct JsEventRingSlot {
+    /* sequence number of the event + 1 (0 while the slot is being written) */
+    _Atomic uint64_t sequence;
+    /* event stored as a single 64-bit word (a JsEvent has exactly 8 bytes) */
+    _Atomic uint64_t event;
+} JsEventRingSlot;
+
+typedef struct JsEventRingHeader {
+    uint32_t magic;
+    uint32_t capacity;
+    /* number of events published so far */
+    _Atomic uint64_t write_sequence;
+    /* futex word (incremented on every publication while subscribers are waiting) */
+    _Atomic uint32_t futex;
+    /* number of subscribers currently waiting on the futex */
+    _Atomic uint32_t waiters;
+    /* process id of the producer */
+    _Atomic int32_t owner;
+    JsEventRingSlot slots[];
+} JsEventRingHeader;
+
+typedef struct JsEventRing {
+    char name[64];
+    JsEventRingHeader * header;
+    size_t size;
+} JsEventRing;
+
+typedef struct JsEventSubscriber {
+    JsEventRingHeader * header;
+    size_t size;
+    /* sequence number of the next event to be read */
+    uint64_t cursor;
+    /* total number of events lost due to overruns */
+    uint64_t lost;
+} JsEventSubscriber;
+
+/* producer (name must start with '/', capacity is rounded up to a power of 2); fails if a ring of
+ * that name is owned by a running process (rings of terminated producers are replaced); the segment
+ * is readable and writable by the user and the group of the producer */
+JsResult js_create_event_ring(JsEventRing * event_ring, const char * name, uint32_t capacity);
+JsResult js_destroy_event_ring(JsEventRing * event_ring);
+void js_publish_event(JsEventRing * event_ring, const JsEvent * event);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsEventRing) */
+JsResult js_event_ring_event_action(const JsEvent * event, void * arg);
+
+/* subscriber (starts reading at the most recent event) */
+JsResult js_subscribe_event_ring(JsEventSubscriber * subscriber, const char * name);
+JsResult js_unsubscribe_event_ring(JsEventSubscriber * subscriber);
+/* returns JsResult_nothing if there is no new event (overruns are accounted for in lost) */
+JsResult js_receive_event(JsEventSubscriber * subscriber, JsEvent * event);
+/* blocks for at most timeout ms (negative for no timeout) until an event is available */
+JsResult js_wait_event(JsEventSubscriber * subscriber, JsEvent * event, int timeout);
+
+#pragma GCC visibility pop
+
+#endif
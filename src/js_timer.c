@@ -0,0 +1,514 @@
+#include <stdlib.h>
+#include <threads.h>
+#include <errno.h>
+#include <time.h>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "js_timer.h"
+
+/****************************************************************************************************
+ *
+ * Hierarchical Timer Wheel
+ *
+ ***************************************************************************************************/
+
+/* marks timers that have been moved to the list of expired timers */
+#define js_timer_level_expired 0xFF
+
+static uint64_t js_monotonic_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000 + ((uint64_t) t.tv_nsec) / 1'000'000;
+}
+
+static void js_timer_push(JsTimer ** list, JsTimer * timer)
+{
+    timer->next = *list;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    timer->pprev = list;
+    *list = timer;
+}
+
+static void js_timer_unlink(JsTimerWheel * timer_wheel, JsTimer * timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = nullptr;
+    timer->pprev = nullptr;
+
+    /* keep occupancy bits up to date */
+    if (timer->level != js_timer_level_expired && !timer_wheel->slots[timer->level][timer->slot]) {
+        timer_wheel->occupied[timer->level] &= ~(((uint64_t) 1) << timer->slot);
+    }
+}
+
+static void js_timer_insert(JsTimerWheel * timer_wheel, JsTimer * timer)
+{
+    const uint64_t delta = timer->expires - timer_wheel->now;
+
+    /* find the lowest level covering the delay */
+    unsigned int level = 0;
+    while (level < js_timer_wheel_levels - 1 && delta >= (((uint64_t) 1) << (js_timer_wheel_bits * (level + 1)))) {
+        ++level;
+    }
+
+    /* clamp delays exceeding the range of the wheel (they are cascaded again when due) */
+    const uint64_t max_delta = (((uint64_t) 1) << (js_timer_wheel_bits * js_timer_wheel_levels)) - 1;
+    const uint64_t expires = delta > max_delta ? timer_wheel->now + max_delta : timer->expires;
+
+    timer->level = level;
+    timer->slot = (expires >> (js_timer_wheel_bits * level)) & (js_timer_wheel_slots - 1);
+    js_timer_push(&timer_wheel->slots[level][timer->slot], timer);
+    timer_wheel->occupied[level] |= ((uint64_t) 1) << timer->slot;
+}
+
+static void js_timer_wheel_cascade(JsTimerWheel * timer_wheel, unsigned int level, unsigned int slot)
+{
+    JsTimer * timer;
+    while ((timer = timer_wheel->slots[level][slot])) {
+        js_timer_unlink(timer_wheel, timer);
+        js_timer_insert(timer_wheel, timer);
+    }
+}
+
+static void js_timer_wheel_tick(JsTimerWheel * timer_wheel)
+{
+    const uint64_t now = ++timer_wheel->now;
+
+    /* move timers from higher levels down once their block is reached */
+    for (unsigned int level=1; level<js_timer_wheel_levels; ++level) {
+        const unsigned int shift = js_timer_wheel_bits * level;
+        if (now & ((((uint64_t) 1) << shift) - 1)) {
+            break;
+        }
+        js_timer_wheel_cascade(timer_wheel, level, (now >> shift) & (js_timer_wheel_slots - 1));
+    }
+
+    /* all timers in the current slot of the lowest level expire now */
+    const unsigned int slot = now & (js_timer_wheel_slots - 1);
+    JsTimer * timer;
+    while ((timer = timer_wheel->slots[0][slot])) {
+        js_timer_unlink(timer_wheel, timer);
+        timer->level = js_timer_level_expired;
+        js_timer_push(&timer_wheel->expired, timer);
+    }
+}
+
+static void js_timer_wheel_advance(JsTimerWheel * timer_wheel, uint64_t now)
+{
+    while (timer_wheel->now < now) {
+        bool is_empty = true;
+        for (unsigned int level=0; level<js_timer_wheel_levels; ++level) {
+            is_empty = is_empty && !timer_wheel->occupied[level];
+        }
+        /* nothing to do (skip ahead) */
+        if (is_empty) {
+            timer_wheel->now = now;
+            break;
+        }
+        js_timer_wheel_tick(timer_wheel);
+    }
+}
+
+/* time of the next tick at which a timer may expire or has to be cascaded (0 if there is none) */
+static uint64_t js_timer_wheel_next_deadline(const JsTimerWheel * timer_wheel)
+{
+    const uint64_t now = timer_wheel->now;
+    uint64_t deadline = 0;
+
+    if (timer_wheel->occupied[0]) {
+        /* rotate the occupancy bits such that bit 0 corresponds to the next tick */
+        const unsigned int r = (now + 1) & (js_timer_wheel_slots - 1);
+        const uint64_t bits = timer_wheel->occupied[0];
+        const uint64_t rotated = r ? (bits >> r) | (bits << (js_timer_wheel_slots - r)) : bits;
+        deadline = now + 1 + __builtin_ctzll(rotated);
+    }
+
+    for (unsigned int level=1; level<js_timer_wheel_levels; ++level) {
+        if (timer_wheel->occupied[level]) {
+            const uint64_t cascade = (now | (js_timer_wheel_slots - 1)) + 1;
+            if (!deadline || cascade < deadline) {
+                deadline = cascade;
+            }
+            break;
+        }
+    }
+
+    return deadline;
+}
+
+static JsResult js_timer_wheel_program(JsTimerWheel * timer_wheel, uint64_t deadline)
+{
+    if (deadline == timer_wheel->deadline) {
+        return JsResult_success;
+    }
+
+    /* a zero value disarms the timerfd */
+    const struct itimerspec spec = {
+        .it_value = {.tv_sec = deadline / 1000, .tv_nsec = (deadline % 1000) * 1'000'000}
+    };
+    if (timerfd_settime(timer_wheel->fd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+        return JsResult_failure;
+    }
+    timer_wheel->deadline = deadline;
+    return JsResult_success;
+}
+
+/* execute expired timers (called with the lock held, which is released during callbacks) */
+static JsResult js_timer_wheel_run_expired(JsTimerWheel * timer_wheel)
+{
+    JsTimer * timer;
+    while ((timer = timer_wheel->expired)) {
+        js_timer_unlink(timer_wheel, timer);
+
+        /* re-arm periodic timers before executing the callback (so it may cancel them) */
+        if (timer->period) {
+            timer->expires += timer->period;
+            if (timer->expires <= timer_wheel->now) {
+                timer->expires = timer_wheel->now + 1;
+            }
+            js_timer_insert(timer_wheel, timer);
+        }
+
+        timer_wheel->running = timer;
+        timer_wheel->running_thread_id = thrd_current();
+        if (mtx_unlock(&timer_wheel->lock) != thrd_success) {
+            return JsResult_failure;
+        }
+        const JsResult r = timer->timer_action(timer, timer->timer_action_arg);
+        if (mtx_lock(&timer_wheel->lock) != thrd_success) {
+            return JsResult_failure;
+        }
+
+        if (r == JsResult_stop && timer->pprev) {
+            js_timer_unlink(timer_wheel, timer);
+        }
+        timer_wheel->running = nullptr;
+        cnd_broadcast(&timer_wheel->callback_done);
+        if (r == JsResult_failure) {
+            return JsResult_failure;
+        }
+    }
+    return JsResult_success;
+}
+
+JsResult js_timer_wheel_process_ready(JsTimerWheel * timer_wheel)
+{
+    uint64_t expirations;
+    if (read(timer_wheel->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return errno == EAGAIN || errno == EINTR ? JsResult_nothing : JsResult_failure;
+    }
+
+    if (mtx_lock(&timer_wheel->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    /* the (one-shot) timerfd has expired and is no longer armed */
+    timer_wheel->deadline = 0;
+    js_timer_wheel_advance(timer_wheel, js_monotonic_ms());
+    JsResult r = js_timer_wheel_run_expired(timer_wheel);
+    if (r == JsResult_success) {
+        r = js_timer_wheel_program(timer_wheel, js_timer_wheel_next_deadline(timer_wheel));
+    }
+
+    if (mtx_unlock(&timer_wheel->lock) != thrd_success || r != JsResult_success) {
+        timer_wheel->is_running = false;
+        return JsResult_failure;
+    }
+    return JsResult_success;
+}
+
+static int js_timer_wheel_main(void * arg)
+{
+    JsTimerWheel * const timer_wheel = (JsTimerWheel*) arg;
+
+    while (timer_wheel->is_running) {
+        /* block until the next deadline */
+        struct pollfd pfd = {.fd = timer_wheel->fd, .events = POLLIN};
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            goto exit_failure;
+        }
+        if (!timer_wheel->is_running) {
+            break;
+        }
+
+        if (js_timer_wheel_process_ready(timer_wheel) == JsResult_failure) {
+            goto exit_failure;
+        }
+    }
+
+    return EXIT_SUCCESS;
+
+    exit_failure:
+    timer_wheel->is_running = false;
+    return EXIT_FAILURE;
+}
+
+JsResult js_init_timer_wheel(JsTimerWheel * timer_wheel)
+{
+    *timer_wheel = (JsTimerWheel){.now = js_monotonic_ms()};
+    atomic_init(&timer_wheel->is_running, true);
+
+    timer_wheel->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_wheel->fd < 0) {
+        return JsResult_failure;
+    }
+
+    if (mtx_init(&timer_wheel->lock, mtx_plain) != thrd_success) {
+        goto init_lock_error;
+    }
+    if (cnd_init(&timer_wheel->callback_done) != thrd_success) {
+        goto init_condition_error;
+    }
+
+    return JsResult_success;
+
+    init_condition_error:
+    mtx_destroy(&timer_wheel->lock);
+    init_lock_error:
+    close(timer_wheel->fd);
+    return JsResult_failure;
+}
+
+JsResult js_create_timer_wheel(JsTimerWheel * timer_wheel)
+{
+    if (js_init_timer_wheel(timer_wheel) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    if (thrd_create(&timer_wheel->thread_id, js_timer_wheel_main, (void*) timer_wheel) != thrd_success) {
+        cnd_destroy(&timer_wheel->callback_done);
+        mtx_destroy(&timer_wheel->lock);
+        close(timer_wheel->fd);
+        return JsResult_failure;
+    }
+    timer_wheel->has_thread = true;
+
+    return JsResult_success;
+}
+
+JsResult js_destroy_timer_wheel(JsTimerWheel * timer_wheel)
+{
+    const bool is_running = timer_wheel->is_running;
+    timer_wheel->is_running = false;
+
+    int join_result = thrd_success;
+    int return_val = EXIT_SUCCESS;
+    if (timer_wheel->has_thread) {
+        /* wake up the timer thread by letting the timerfd expire immediately */
+        const struct itimerspec spec = {.it_value = {.tv_nsec = 1}};
+        timerfd_settime(timer_wheel->fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+        join_result = thrd_join(timer_wheel->thread_id, &return_val);
+    }
+    else if (!is_running) {
+        return_val = EXIT_FAILURE;
+    }
+
+    cnd_destroy(&timer_wheel->callback_done);
+    mtx_destroy(&timer_wheel->lock);
+    close(timer_wheel->fd);
+
+    return (
+        join_result == thrd_success && return_val == EXIT_SUCCESS
+        ? JsResult_success
+        : JsResult_failure
+    );
+}
+
+bool js_timer_wheel_is_running(const JsTimerWheel * timer_wheel)
+{
+    return timer_wheel->is_running;
+}
+
+JsResult js_arm_timer(JsTimerWheel * timer_wheel, JsTimer * timer, uint32_t delay)
+{
+    if (mtx_lock(&timer_wheel->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    if (timer->pprev) {
+        js_timer_unlink(timer_wheel, timer);
+    }
+
+    /* the time of the wheel only advances while it holds timers (afterwards, it would have to tick
+     * through the whole idle period) */
+    const uint64_t now = js_monotonic_ms();
+    bool is_empty = true;
+    for (unsigned int level=0; level<js_timer_wheel_levels; ++level) {
+        is_empty = is_empty && !timer_wheel->occupied[level];
+    }
+    if (is_empty && now > timer_wheel->now) {
+        timer_wheel->now = now;
+    }
+
+    /* the wheel may lag behind the actual time (timers expire no earlier than one tick from now) */
+    timer->expires = now + delay;
+    if (timer->expires <= timer_wheel->now) {
+        timer->expires = timer_wheel->now + 1;
+    }
+    js_timer_insert(timer_wheel, timer);
+
+    const JsResult r = js_timer_wheel_program(timer_wheel, js_timer_wheel_next_deadline(timer_wheel));
+
+    if (mtx_unlock(&timer_wheel->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+    return r;
+}
+
+JsResult js_cancel_timer(JsTimerWheel * timer_wheel, JsTimer * timer)
+{
+    if (mtx_lock(&timer_wheel->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    /* the timerfd is not reprogrammed (an early wakeup is harmless) */
+    if (timer->pprev) {
+        js_timer_unlink(timer_wheel, timer);
+    }
+
+    /* wait until a running callback of the timer has returned (unless called from it) */
+    while (timer_wheel->running == timer && !thrd_equal(timer_wheel->running_thread_id, thrd_current())) {
+        if (cnd_wait(&timer_wheel->callback_done, &timer_wheel->lock) != thrd_success) {
+            mtx_unlock(&timer_wheel->lock);
+            return JsResult_failure;
+        }
+    }
+    /* a periodic timer re-armed by the callback meanwhile stays cancelled */
+    if (timer->pprev) {
+        js_timer_unlink(timer_wheel, timer);
+    }
+
+    if (mtx_unlock(&timer_wheel->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+    return JsResult_success;
+}
+
+bool js_timer_is_armed(const JsTimer * timer)
+{
+    return timer->pprev != nullptr;
+}
+
+/****************************************************************************************************
+ *
+ * Time-Based Input Features (Long Press, Auto-Repeat, Timeout)
+ *
+ ***************************************************************************************************/
+
+static JsResult js_long_press_timer_action(JsTimer * timer, void * arg)
+{
+    JsInputTimers * const input_timers = (JsInputTimers*) arg;
+    const uint8_t number = timer - input_timers->long_press_timers;
+    return input_timers->timer_event_action(
+        JsTimerEvent_long_press, number, input_timers->timer_event_action_arg
+    );
+}
+
+static JsResult js_repeat_timer_action(JsTimer * timer, void * arg)
+{
+    JsInputTimers * const input_timers = (JsInputTimers*) arg;
+    const uint8_t number = timer - input_timers->repeat_timers;
+    return input_timers->timer_event_action(
+        JsTimerEvent_repeat, number, input_timers->timer_event_action_arg
+    );
+}
+
+static JsResult js_timeout_timer_action(JsTimer * timer, void * arg)
+{
+    JsInputTimers * const input_timers = (JsInputTimers*) arg;
+    return input_timers->timer_event_action(
+        JsTimerEvent_timeout, 0, input_timers->timer_event_action_arg
+    );
+}
+
+void js_init_input_timers(JsInputTimers * input_timers)
+{
+    for (unsigned int i=0; i<js_max_number_of_buttons; ++i) {
+        input_timers->long_press_timers[i] = (JsTimer){
+            .timer_action = js_long_press_timer_action,
+            .timer_action_arg = (void*) input_timers
+        };
+        input_timers->repeat_timers[i] = (JsTimer){
+            .timer_action = js_repeat_timer_action,
+            .timer_action_arg = (void*) input_timers,
+            .period = input_timers->repeat_period
+        };
+    }
+    input_timers->timeout_timer = (JsTimer){
+        .timer_action = js_timeout_timer_action,
+        .timer_action_arg = (void*) input_timers
+    };
+}
+
+JsResult js_input_timers_event_action(const JsEvent * event, void * arg)
+{
+    JsInputTimers * const input_timers = (JsInputTimers*) arg;
+    JsTimerWheel * const timer_wheel = input_timers->timer_wheel;
+
+    /* any event restarts the timeout */
+    if (input_timers->timeout) {
+        if (js_arm_timer(timer_wheel, &input_timers->timeout_timer, input_timers->timeout) != JsResult_success) {
+            return JsResult_failure;
+        }
+    }
+
+    /* synthetic events only describe the initial state (and are no button presses) */
+    if ((event->type & JS_EVENT_BUTTON) && !(event->type & JS_EVENT_INIT)
+        && event->number < js_max_number_of_buttons) {
+        JsTimer * const long_press_timer = &input_timers->long_press_timers[event->number];
+        JsTimer * const repeat_timer = &input_timers->repeat_timers[event->number];
+        const bool repeat = input_timers->repeat_delay && (input_timers->repeat_buttons & (1u << event->number));
+
+        JsResult r = JsResult_success;
+        if (event->value) {
+            if (input_timers->long_press_delay) {
+                r = js_arm_timer(timer_wheel, long_press_timer, input_timers->long_press_delay);
+            }
+            if (r == JsResult_success && repeat) {
+                r = js_arm_timer(timer_wheel, repeat_timer, input_timers->repeat_delay);
+            }
+        }
+        else {
+            r = js_cancel_timer(timer_wheel, long_press_timer);
+            if (r == JsResult_success) {
+                r = js_cancel_timer(timer_wheel, repeat_timer);
+            }
+        }
+        if (r != JsResult_success) {
+            return JsResult_failure;
+        }
+    }
+
+    return (
+        input_timers->event_action
+        ? input_timers->event_action(event, input_timers->event_action_arg)
+        : JsResult_success
+    );
+}
+
+JsResult js_cancel_input_timers(JsInputTimers * input_timers)
+{
+    JsTimerWheel * const timer_wheel = input_timers->timer_wheel;
+
+    JsResult r = js_cancel_timer(timer_wheel, &input_timers->timeout_timer);
+    for (unsigned int i=0; i<js_max_number_of_buttons; ++i) {
+        if (js_cancel_timer(timer_wheel, &input_timers->long_press_timers[i]) != JsResult_success
+            || js_cancel_timer(timer_wheel, &input_timers->repeat_timers[i]) != JsResult_success) {
+            r = JsResult_failure;
+        }
+    }
+    return r;
+}
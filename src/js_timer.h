@@ -0,0 +1,138 @@
+#ifndef JS_TIMER_H
+#define JS_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Hierarchical Timer Wheel
+ *
+ ***************************************************************************************************/
+
+/* the wheel has js_timer_wheel_levels levels of 2^js_timer_wheel_bits slots each, with a resolution
+ * of 1 ms (matching the kernel event time), i.e. it directly covers delays of up to ~4.6 hours
+ * (longer delays are cascaded repeatedly) */
+#define js_timer_wheel_levels 4
+#define js_timer_wheel_bits 6
+#define js_timer_wheel_slots (1 << js_timer_wheel_bits)
+
+typedef struct JsTimer JsTimer;
+
+struct JsTimer {
+    /* callback executed (by the timer wheel thread or in js_timer_wheel_process_ready) when the timer
+     * expires: returning JsResult_stop
+     * prevents a periodic timer from being re-armed, JsResult_failure terminates the timer wheel */
+    JsResult (*timer_action)(JsTimer * timer, void * arg);
+    void * timer_action_arg;
+    /* period in ms for periodic timers (0 for one-shot timers) */
+    uint32_t period;
+
+    /* intrusive list node (must not be modified) */
+    JsTimer * next;
+    JsTimer ** pprev;
+    uint64_t expires;
+    uint8_t level;
+    uint8_t slot;
+};
+
+typedef struct JsTimerWheel {
+    /* timerfd (CLOCK_MONOTONIC, non-blocking) driving the wheel */
+    int fd;
+    /* mutex for synchronization */
+    mtx_t lock;
+    /* signaled whenever a callback has returned */
+    cnd_t callback_done;
+    /* current time in ms (CLOCK_MONOTONIC) and currently programmed deadline (0 if none) */
+    uint64_t now;
+    uint64_t deadline;
+    /* one bit per non-empty slot for each level */
+    uint64_t occupied[js_timer_wheel_levels];
+    /* timer lists */
+    JsTimer * slots[js_timer_wheel_levels][js_timer_wheel_slots];
+    /* list of expired timers currently being executed */
+    JsTimer * expired;
+    /* timer whose callback is being executed (with the lock released) and the executing thread */
+    JsTimer * running;
+    thrd_t running_thread_id;
+
+    thrd_t thread_id;
+    bool has_thread;
+    atomic_bool is_running;
+} JsTimerWheel;
+
+/* creates a thread executing the callbacks (concurrently with the callbacks of event handlers) */
+JsResult js_create_timer_wheel(JsTimerWheel * timer_wheel);
+/* works for both timer wheels created by js_create_timer_wheel and by js_init_timer_wheel */
+JsResult js_destroy_timer_wheel(JsTimerWheel * timer_wheel);
+bool js_timer_wheel_is_running(const JsTimerWheel * timer_wheel);
+
+/*
+ * Integration with the event loop of the event handlers (see js_process_ready): instead of creating a
+ * thread, initialize the timer wheel with js_init_timer_wheel, wait for fd to become readable (POLLIN)
+ * in the loop and call js_timer_wheel_process_ready, which executes all expired timers inline, so
+ * that timer callbacks and event callbacks never run concurrently. It returns JsResult_nothing if no
+ * timer has expired yet.
+ */
+JsResult js_init_timer_wheel(JsTimerWheel * timer_wheel);
+JsResult js_timer_wheel_process_ready(JsTimerWheel * timer_wheel);
+
+/* arm a timer to expire after delay ms (re-arms the timer if it is already armed) */
+JsResult js_arm_timer(JsTimerWheel * timer_wheel, JsTimer * timer, uint32_t delay);
+/* once it returns, the callback of the timer is no longer being executed (unless it is called from
+ * that callback) */
+JsResult js_cancel_timer(JsTimerWheel * timer_wheel, JsTimer * timer);
+bool js_timer_is_armed(const JsTimer * timer);
+
+/****************************************************************************************************
+ *
+ * Time-Based Input Features (Long Press, Auto-Repeat, Timeout)
+ *
+ ***************************************************************************************************/
+
+typedef enum {
+    JsTimerEvent_long_press,
+    JsTimerEvent_repeat,
+    JsTimerEvent_timeout
+} JsTimerEvent;
+
+typedef struct JsInputTimers {
+    /* timer wheel shared by any number of devices */
+    JsTimerWheel * timer_wheel;
+    /* delays/periods in ms (0 disables the respective feature) */
+    uint32_t long_press_delay;
+    uint32_t repeat_delay;
+    uint32_t repeat_period;
+    uint32_t timeout;
+    /* buttons subject to auto-repeat (bit n for button n) */
+    uint32_t repeat_buttons;
+    /* callback executed for timer events (number is the button number or 0 for timeouts) */
+    JsResult (*timer_event_action)(JsTimerEvent timer_event, uint8_t number, void * arg);
+    void * timer_event_action_arg;
+    /* optional callback executed for each device event (after the timers have been updated) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal timers (must not be modified) */
+    JsTimer long_press_timers[js_max_number_of_buttons];
+    JsTimer repeat_timers[js_max_number_of_buttons];
+    JsTimer timeout_timer;
+} JsInputTimers;
+
+/* to be called after filling in the configuration fields and before the first event */
+void js_init_input_timers(JsInputTimers * input_timers);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsInputTimers) */
+JsResult js_input_timers_event_action(const JsEvent * event, void * arg);
+/* cancel all pending timers and wait for running callbacks (must be called before the JsInputTimers
+ * is invalidated) */
+JsResult js_cancel_input_timers(JsInputTimers * input_timers);
+
+#pragma GCC visibility pop
+
+#endif
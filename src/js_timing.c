@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "js_timing.h"
+
+/****************************************************************************************************
+ *
+ * Timing Analysis
+ *
+ ***************************************************************************************************/
+
+/* weight of the most recent interval in the exponentially weighted averages */
+static const double js_timing_alpha = 1.0 / 64.0;
+
+static double js_timespec_diff_ms(const struct timespec * a, const struct timespec * b)
+{
+    return ((double) (a->tv_sec - b->tv_sec)) * 1e3 + ((double) (a->tv_nsec - b->tv_nsec)) * 1e-6;
+}
+
+JsResult js_init_timing(JsTiming * timing)
+{
+    timing->metrics = (JsTimingMetrics){};
+    timing->has_report = false;
+    timing->kernel_time = 0;
+    timing->interval_variance = 0.0;
+    timing->mean_x = 0.0;
+    timing->mean_y = 0.0;
+    timing->m2_x = 0.0;
+    timing->c_xy = 0.0;
+
+    return mtx_init(&timing->lock, mtx_plain) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+void js_destroy_timing(JsTiming * timing)
+{
+    mtx_destroy(&timing->lock);
+}
+
+static void js_timing_add_report(JsTiming * timing, uint32_t kernel_time, const struct timespec * read_time)
+{
+    JsTimingMetrics * const metrics = &timing->metrics;
+
+    if (!timing->has_report) {
+        if (read_time) {
+            timing->first_read_time = *read_time;
+        }
+    }
+    else {
+        /* kernel interval (modulo 2^32 ms) */
+        const uint32_t kernel_interval = kernel_time - timing->last_kernel_time;
+        timing->kernel_time += kernel_interval;
+
+        /* interval observed by the reading thread */
+        const double interval = read_time ? js_timespec_diff_ms(read_time, &timing->report_read_time) : kernel_interval;
+        if (metrics->number_of_reports == 1) {
+            metrics->report_interval = interval;
+        }
+        else {
+            const double d = interval - metrics->report_interval;
+            metrics->report_interval += js_timing_alpha * d;
+            timing->interval_variance = (1.0 - js_timing_alpha) * (timing->interval_variance + js_timing_alpha * d * d);
+        }
+
+        if (read_time) {
+            const double us = interval * 1e3;
+            unsigned int bucket = 0;
+            while (bucket < js_timing_histogram_size - 1 && us >= (double) (2u << bucket)) {
+                ++bucket;
+            }
+            ++metrics->histogram[bucket];
+        }
+    }
+
+    /* regression of read time (y) on kernel time (x), both in ms relative to the first report */
+    if (read_time) {
+        const double n = (double) (metrics->number_of_reports + 1);
+        const double x = (double) timing->kernel_time;
+        const double y = js_timespec_diff_ms(read_time, &timing->first_read_time);
+        const double dx = x - timing->mean_x;
+        timing->mean_x += dx / n;
+        timing->mean_y += (y - timing->mean_y) / n;
+        timing->m2_x += dx * (x - timing->mean_x);
+        timing->c_xy += dx * (y - timing->mean_y);
+        timing->report_read_time = *read_time;
+    }
+
+    timing->has_report = true;
+    ++metrics->number_of_reports;
+}
+
+JsResult js_timing_update(JsTiming * timing, const JsEvent * event, const struct timespec * read_time)
+{
+    if (event->type & JS_EVENT_INIT) {
+        return JsResult_success;
+    }
+
+    if (mtx_lock(&timing->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    ++timing->metrics.number_of_events;
+    /* events of the same report share the kernel time stamp and are read back to back */
+    if (!timing->has_report || event->time != timing->last_kernel_time
+        || (read_time && js_timespec_diff_ms(read_time, &timing->last_read_time) * 1e3 > js_timing_report_gap)) {
+        js_timing_add_report(timing, event->time, read_time);
+    }
+    timing->last_kernel_time = event->time;
+    if (read_time) {
+        timing->last_read_time = *read_time;
+        timing->metrics.has_read_times = true;
+    }
+
+    return mtx_unlock(&timing->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+JsResult js_timing_event_action(const JsEvent * event, void * arg)
+{
+    JsTiming * const timing = (JsTiming*) arg;
+
+    const JsEventStamp stamp = js_get_event_stamp();
+    struct timespec read_time = {
+        .tv_sec = (time_t) (stamp.time / 1'000'000'000), .tv_nsec = (long) (stamp.time % 1'000'000'000)
+    };
+    /* not called by an event handler */
+    if (stamp.sequence == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &read_time);
+    }
+    if (js_timing_update(timing, event, &read_time) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    return timing->event_action ? timing->event_action(event, timing->event_action_arg) : JsResult_success;
+}
+
+JsResult js_get_timing_metrics(JsTiming * timing, JsTimingMetrics * metrics)
+{
+    if (mtx_lock(&timing->lock) != thrd_success) {
+        return JsResult_failure;
+    }
+
+    *metrics = timing->metrics;
+    metrics->jitter = sqrt(timing->interval_variance);
+    metrics->report_rate = metrics->report_interval > 0.0 ? 1000.0 / metrics->report_interval : 0.0;
+    metrics->events_per_report = (
+        metrics->number_of_reports
+        ? ((double) metrics->number_of_events) / ((double) metrics->number_of_reports)
+        : 0.0
+    );
+    metrics->skew = timing->m2_x > 0.0 ? (timing->c_xy / timing->m2_x - 1.0) * 1e6 : 0.0;
+
+    return mtx_unlock(&timing->lock) == thrd_success ? JsResult_success : JsResult_failure;
+}
+
+void js_display_timing_metrics(const JsTimingMetrics * metrics)
+{
+    printf("events: %"PRIu64", reports: %"PRIu64" (%.2f events/report)\n",
+        metrics->number_of_events, metrics->number_of_reports, metrics->events_per_report
+    );
+    printf("report rate: %.1f Hz, interval: %.3f ms, jitter: %.3f ms\n",
+        metrics->report_rate, metrics->report_interval, metrics->jitter
+    );
+    if (!metrics->has_read_times) {
+        return;
+    }
+    printf("clock skew: %.1f ppm\n", metrics->skew);
+    printf("observed report intervals:\n");
+    for (unsigned int i=0; i<js_timing_histogram_size; ++i) {
+        if (metrics->histogram[i]) {
+            printf("    [%8u us, %8u us): %"PRIu64"\n", i ? 1u << i : 0u, 2u << i, metrics->histogram[i]);
+        }
+    }
+}
+
+size_t js_timing_suggest_capacity(const JsTimingMetrics * metrics, double duration)
+{
+    const double events = metrics->report_rate * metrics->events_per_report * duration;
+
+    size_t capacity = 16;
+    while (capacity < events && capacity < (((size_t) 1) << 31)) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+uint32_t js_timing_suggest_period(const JsTimingMetrics * metrics)
+{
+    return (uint32_t) (metrics->report_interval * 1000.0);
+}
@@ -0,0 +1,113 @@
+#ifndef JS_TIMING_H
+#define JS_TIMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <time.h>
+
+#include "js.h"
+
+#pragma GCC visibility push(default)
+
+/****************************************************************************************************
+ *
+ * Timing Analysis
+ *
+ ***************************************************************************************************/
+
+/*
+ * The kernel splits each report of the device into several events that are delivered at once. joydev
+ * stamps them with jiffies_to_msecs(jiffies), i.e. with the resolution of the kernel tick (10 ms on
+ * HZ=100 and 4 ms on HZ=250 kernels), so equal kernel time stamps would merge several reports of a
+ * fast device. An event therefore starts a new report if its kernel time stamp differs from that of
+ * the previous event or if it was read more than js_timing_report_gap after it (the events of a
+ * report are read back to back, e.g. with the JsEventStamp of the event handler). Reports read at
+ * once from a backlog are only separated by their kernel time stamps. For each report, the analyzer
+ * tracks
+ *
+ * + the report interval between the read times of consecutive reports (mean and standard deviation
+ *   as exponentially weighted averages), yielding the report rate of the device,
+ * + the distribution of these intervals as a histogram with power-of-2 buckets,
+ * + the skew of the kernel event clock relative to CLOCK_MONOTONIC by an online linear regression
+ *   of read times on kernel times.
+ *
+ * Without read times (e.g. for recordings), reports are delimited by the kernel time stamps alone
+ * and the report interval is measured on them; there is neither histogram nor skew then.
+ *
+ * Synthetic (JS_EVENT_INIT) events are ignored. The suggestions derived from the metrics are
+ * advisory: nothing is resized automatically, they are meant to be passed on when creating buffers
+ * (e.g. as capacity to js_init_rt_queue) or timers.
+ */
+
+/* largest gap in us between the read times of two events of the same report */
+#define js_timing_report_gap 250
+
+/* bucket k counts intervals in [2^k, 2^(k+1)) us (bucket 0 also counts intervals < 1 us) */
+#define js_timing_histogram_size 24
+
+typedef struct JsTimingMetrics {
+    uint64_t number_of_events;
+    uint64_t number_of_reports;
+    /* reports per second */
+    double report_rate;
+    /* mean and standard deviation of the report interval in ms (read times if available, otherwise
+     * kernel times) */
+    double report_interval;
+    double jitter;
+    /* mean number of events per report */
+    double events_per_report;
+    /* the events came with read times (otherwise skew and histogram are not available) */
+    bool has_read_times;
+    /* skew of the kernel clock relative to CLOCK_MONOTONIC in ppm (positive if the kernel clock is slow) */
+    double skew;
+    /* report intervals observed on CLOCK_MONOTONIC */
+    uint64_t histogram[js_timing_histogram_size];
+} JsTimingMetrics;
+
+typedef struct JsTiming {
+    /* optional callback executed for each event (after it has been analyzed) */
+    JsResult (*event_action)(const JsEvent * event, void * arg);
+    void * event_action_arg;
+
+    /* internal state (must not be modified) */
+    mtx_t lock;
+    JsTimingMetrics metrics;
+    bool has_report;
+    uint32_t last_kernel_time;
+    uint64_t kernel_time;
+    struct timespec first_read_time;
+    /* read time of the first and the latest event of the current report */
+    struct timespec report_read_time;
+    struct timespec last_read_time;
+    double interval_variance;
+    /* regression state (Welford) */
+    double mean_x;
+    double mean_y;
+    double m2_x;
+    double c_xy;
+} JsTiming;
+
+/* to be called after filling in event_action/event_action_arg */
+JsResult js_init_timing(JsTiming * timing);
+void js_destroy_timing(JsTiming * timing);
+
+/* analyze an event read at read_time (CLOCK_MONOTONIC, nullptr if unknown, which has to be the case
+ * for all events then) */
+JsResult js_timing_update(JsTiming * timing, const JsEvent * event, const struct timespec * read_time);
+/* event action to be used by an event handler (with event_action_arg pointing to the JsTiming, the
+ * read time is taken from the JsEventStamp) */
+JsResult js_timing_event_action(const JsEvent * event, void * arg);
+
+JsResult js_get_timing_metrics(JsTiming * timing, JsTimingMetrics * metrics);
+void js_display_timing_metrics(const JsTimingMetrics * metrics);
+
+/* capacity (power of 2) of a buffer holding the events of the given duration (in s) */
+size_t js_timing_suggest_capacity(const JsTimingMetrics * metrics, double duration);
+/* sampling/resampling period in us matching the report rate of the device (0 if unknown) */
+uint32_t js_timing_suggest_period(const JsTimingMetrics * metrics);
+
+#pragma GCC visibility pop
+
+#endif
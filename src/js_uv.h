@@ -0,0 +1,78 @@
+#ifndef JS_UV_H
+#define JS_UV_H
+
+#include <uv.h>
+
+#include "js.h"
+
+/****************************************************************************************************
+ *
+ * libuv Adapter (Header Only)
+ *
+ ***************************************************************************************************/
+
+/*
+ * Handles the events of a JsEventHandler on a libuv loop (without any additional thread):
+ *
+ *     JsUvEventHandler uv_event_handler;
+ *     JsEventHandler event_handler = {.js = js, .event_action = ..., .event_action_arg = ...};
+ *     js_uv_start(loop, &uv_event_handler, &event_handler);
+ *     ...
+ *     js_uv_stop(&uv_event_handler);
+ *
+ * Whenever the device becomes readable, up to js_uv_max_batches batches are processed (so a flood
+ * of events cannot starve the other handles of the loop; the poll handle stays readable if events
+ * remain). If a callback returns JsResult_stop or an error occurs, the poll handle is stopped and the
+ * optional stop_action is executed with the result. Only libuv (not this library) has to be linked
+ * with -luv, since this header is not part of the compiled library.
+ */
+
+#define js_uv_max_batches 16
+
+typedef struct JsUvEventHandler {
+    uv_poll_t poll;
+    JsEventHandler * event_handler;
+    /* optional callback executed when event handling stops (JsResult_stop or JsResult_failure) */
+    void (*stop_action)(JsResult result, void * arg);
+    void * stop_action_arg;
+} JsUvEventHandler;
+
+static inline void js_uv_poll_action(uv_poll_t * poll, int status, [[maybe_unused]] int events)
+{
+    JsUvEventHandler * const uv_event_handler = (JsUvEventHandler*) poll->data;
+    JsEventHandler * const event_handler = uv_event_handler->event_handler;
+
+    JsResult r = status < 0 ? JsResult_failure : JsResult_success;
+    for (unsigned int i=0; r == JsResult_success && i<js_uv_max_batches; ++i) {
+        r = js_process_ready(event_handler);
+    }
+    if (r == JsResult_stop || r == JsResult_failure) {
+        uv_poll_stop(poll);
+        event_handler->is_running = false;
+        if (uv_event_handler->stop_action) {
+            uv_event_handler->stop_action(r, uv_event_handler->stop_action_arg);
+        }
+    }
+}
+
+/* the stop action (if any) has to be set before */
+static inline JsResult js_uv_start(uv_loop_t * loop, JsUvEventHandler * uv_event_handler, JsEventHandler * event_handler)
+{
+    js_init_event_handler(event_handler);
+    uv_event_handler->event_handler = event_handler;
+    if (uv_poll_init(loop, &uv_event_handler->poll, event_handler->js) != 0) {
+        return JsResult_failure;
+    }
+    uv_event_handler->poll.data = uv_event_handler;
+    return uv_poll_start(&uv_event_handler->poll, UV_READABLE, js_uv_poll_action) == 0 ? JsResult_success : JsResult_failure;
+}
+
+/* the JsUvEventHandler must stay valid until the loop has closed the poll handle */
+static inline void js_uv_stop(JsUvEventHandler * uv_event_handler)
+{
+    uv_event_handler->event_handler->is_running = false;
+    uv_poll_stop(&uv_event_handler->poll);
+    uv_close((uv_handle_t*) &uv_event_handler->poll, nullptr);
+}
+
+#endif
@@ -1,47 +1,134 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <stdatomic.h>
+#include <getopt.h>
+#include <glob.h>
+#include <time.h>
+
+#include <unistd.h>
 
 #include <posigs.h>
 
 #include "js.h"
+#include "js_record.h"
+#include "js_hid.h"
+#include "js_timing.h"
+
+/*
+ * Command line interface:
+ *
+ *     js list                                   list joysticks (joydev and hidraw)
+ *     js monitor [pathname]                     display the state (the default command)
+ *     js record [--sync ms] recording [pathname]
+ *     js replay [--speed factor] recording      print the events of a recording in real time
+ *     js bench [--duration s] [pathname]        measure the event rate, timing and latency
+ *     js stats recording                        summarize a recording
+ */
 
 static const char js_std_pathname[] = "/dev/input/js0";
 
 static atomic_bool is_running = true;
 
-static void sigint_action(int signum, void * arg) {if (signum == SIGINT) is_running = false;}
+static void sigint_action(int signum, void * arg) {is_running = false;}
 
-int main(int argc, char * argv[])
+static uint64_t js_cli_now(void)
 {
-    /*
-     * Read Command Line Argument (if there is one)
-     */
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1'000'000'000 + (uint64_t) t.tv_nsec;
+}
 
-    if (argc > 2) {
-        fprintf(stderr, "Usage: joystick {pathname}\n");
-        return EXIT_FAILURE;
+static int js_cli_compare(const void * a, const void * b)
+{
+    const uint32_t x = *(const uint32_t*) a;
+    const uint32_t y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+/* sort values and print their distribution (scaled by unit) */
+static void js_cli_print_distribution(const char * name, uint32_t * values, size_t n, double unit, const char * unit_name)
+{
+    if (n == 0) {
+        return;
     }
+    qsort(values, n, sizeof(uint32_t), js_cli_compare);
+    printf("%-12s min %.3f  p50 %.3f  p99 %.3f  p99.9 %.3f  max %.3f %s\n", name,
+        values[0] * unit, values[n / 2] * unit, values[(size_t) ((double) n * 0.99)] * unit,
+        values[(size_t) ((double) n * 0.999)] * unit, values[n - 1] * unit, unit_name);
+}
 
-    const char * const pathname = (argc == 1 ? js_std_pathname : argv[1]);
+/****************************************************************************************************
+ *
+ * js list
+ *
+ ***************************************************************************************************/
 
-    /*
-     * Install Signal Handler
-     */
+static int js_command_list(int argc, char * argv[])
+{
+    glob_t paths;
 
-    sigset_t sig_set;
-    sigemptyset(&sig_set);
-    PosigsHandler signal_handler = {
-        .sig_set = &sig_set,
-        .sig_action = sigint_action,
-        .timeout = (struct timespec){.tv_nsec = 10'000'000}
-    };
-    if (!((sigaddset(&sig_set, SIGINT) == 0) && posigs_create_handler(&signal_handler))) {
-        fprintf(stderr, "Error: Unable to install signal handler!\n");
-        goto create_signal_handler_error;
+    /* joydev devices */
+    if (glob("/dev/input/js*", 0, nullptr, &paths) == 0) {
+        for (size_t i=0; i<paths.gl_pathc; ++i) {
+            const int js = js_connect(paths.gl_pathv[i]);
+            JsProperties properties;
+            if (js < 0 || js_get_properties(js, &properties) != JsResult_success) {
+                printf("%-18s (%s)\n", paths.gl_pathv[i], strerror(errno));
+            }
+            else {
+                printf("%-18s %-40s %2d axes %3d buttons\n", paths.gl_pathv[i], properties.name,
+                    (int) properties.number_of_axes, (int) properties.number_of_buttons);
+            }
+            if (js >= 0) {
+                js_disconnect(js);
+            }
+        }
+        globfree(&paths);
+    }
+
+    /* hidraw devices with joystick, gamepad or multi-axis collections (see js_hid.h) */
+    if (glob("/dev/hidraw*", 0, nullptr, &paths) == 0) {
+        JsHidDevice * const device = (JsHidDevice*) malloc(sizeof(JsHidDevice));
+        for (size_t i=0; device && i<paths.gl_pathc; ++i) {
+            *device = (JsHidDevice){};
+            const int fd = js_hid_connect(paths.gl_pathv[i]);
+            JsProperties properties;
+            if (fd < 0) {
+                printf("%-18s (%s)\n", paths.gl_pathv[i], strerror(errno));
+                continue;
+            }
+            if (js_open_hid_device(device, fd, nullptr, 0) == JsResult_success
+                && js_get_hid_properties(device, &properties) == JsResult_success) {
+                printf("%-18s %-40s %2d axes %3d buttons\n", paths.gl_pathv[i], properties.name,
+                    (int) properties.number_of_axes, (int) properties.number_of_buttons);
+            }
+            close(fd);
+        }
+        free(device);
+        globfree(&paths);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/****************************************************************************************************
+ *
+ * js monitor
+ *
+ ***************************************************************************************************/
+
+static int js_command_monitor(int argc, char * argv[])
+{
+    if (argc > 2) {
+        fprintf(stderr, "Usage: js monitor {pathname}\n");
+        return EXIT_FAILURE;
     }
 
+    const char * const pathname = (argc == 1 ? js_std_pathname : argv[1]);
+
     /*
      * Connect to Joystick
      */
@@ -81,7 +168,7 @@ int main(int argc, char * argv[])
     printf("\n\033[s");
 
     while (is_running) {
-        /* return cursor to initial position and clear screen */ 
+        /* return cursor to initial position and clear screen */
         printf("\033[u\033[0J");
 
         /* obtain current joystick state */
@@ -117,14 +204,11 @@ int main(int argc, char * argv[])
 
     js_destroy_async_state(&async_state);
     js_disconnect(js);
-    posigs_destroy_handler(&signal_handler);
 
     return EXIT_SUCCESS;
 
     /*
      * Error Handling
-     *
-     * (This is not really necessary, since the program terminates anyway.)
      */
 
     query_async_state_error:
@@ -137,9 +221,503 @@ int main(int argc, char * argv[])
         js_disconnect(js);
     }
     connect_error:
+    return EXIT_FAILURE;
+}
+
+/****************************************************************************************************
+ *
+ * js record
+ *
+ ***************************************************************************************************/
+
+typedef struct JsCliRecorder {
+    JsRecorder * recorder;
+    atomic_uint_fast64_t number_of_events;
+} JsCliRecorder;
+
+static JsResult js_cli_record_action(const JsEvent * event, void * arg)
+{
+    JsCliRecorder * const cli_recorder = (JsCliRecorder*) arg;
+    atomic_fetch_add_explicit(&cli_recorder->number_of_events, 1, memory_order_relaxed);
+    return js_record_event(cli_recorder->recorder, event);
+}
+
+static int js_command_record(int argc, char * argv[])
+{
+    static const struct option options[] = {
+        {"sync", required_argument, nullptr, 's'},
+        {}
+    };
+
+    uint32_t sync_interval = 0;
+    int option;
+    while ((option = getopt_long(argc, argv, "s:", options, nullptr)) != -1) {
+        if (option != 's') {
+            goto usage_error;
+        }
+        sync_interval = (uint32_t) strtoul(optarg, nullptr, 10);
+    }
+    if (argc - optind < 1 || argc - optind > 2) {
+        goto usage_error;
+    }
+
+    const char * const path = argv[optind];
+    const char * const pathname = (argc - optind == 2 ? argv[optind + 1] : js_std_pathname);
+
+    const int js = js_connect(pathname);
+    if (js < 0) {
+        fprintf(stderr, "Error: Unable to connect to joystick at '%s'\n", pathname);
+        goto connect_error;
+    }
+
+    /* (the recorder is too large for the stack) */
+    JsCliRecorder cli_recorder = {.recorder = (JsRecorder*) malloc(sizeof(JsRecorder))};
+    atomic_init(&cli_recorder.number_of_events, 0);
+    if (!cli_recorder.recorder || js_create_recorder(cli_recorder.recorder, path, sync_interval) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to create recording '%s'\n", path);
+        goto create_recorder_error;
+    }
+
+    JsEventHandler event_handler = {
+        .js = js,
+        .event_action = js_cli_record_action,
+        .event_action_arg = &cli_recorder
+    };
+    if (js_create_event_handler(&event_handler) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to create event handler!\n");
+        goto create_event_handler_error;
+    }
+
+    while (is_running && js_event_handler_is_running(&event_handler)) {
+        fprintf(stderr, "\rrecording to %s: %" PRIuFAST64 " events", path,
+            atomic_load_explicit(&cli_recorder.number_of_events, memory_order_relaxed));
+        thrd_sleep(&(struct timespec){.tv_nsec = 100'000'000}, nullptr);
+    }
+    fprintf(stderr, "\n");
+
+    const bool has_lost_connection = !js_event_handler_is_running(&event_handler);
+    js_destroy_event_handler(&event_handler);
+    const JsResult r = js_destroy_recorder(cli_recorder.recorder);
+    free(cli_recorder.recorder);
+    js_disconnect(js);
+
+    if (has_lost_connection) {
+        fprintf(stderr, "Error: Lost connection to joystick (the recording has been finished)\n");
+    }
+    if (r != JsResult_success) {
+        fprintf(stderr, "Error: Unable to finish recording '%s'\n", path);
+    }
+    return r == JsResult_success && !has_lost_connection ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    create_event_handler_error:
+    {
+        js_destroy_recorder(cli_recorder.recorder);
+    }
+    create_recorder_error:
+    {
+        free(cli_recorder.recorder);
+        js_disconnect(js);
+    }
+    connect_error:
+    return EXIT_FAILURE;
+
+    usage_error:
+    fprintf(stderr, "Usage: js record [--sync ms] recording {pathname}\n");
+    return EXIT_FAILURE;
+}
+
+/****************************************************************************************************
+ *
+ * js replay and js stats
+ *
+ ***************************************************************************************************/
+
+/* load and decode a recording (in parallel) */
+static JsEvent * js_cli_load(const char * path, size_t * number_of_events, size_t * size, double * decode_time)
+{
+    JsRecording recording;
+    if (js_open_recording(&recording, path) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to open recording '%s'\n", path);
+        return nullptr;
+    }
+
+    JsEvent * events = (JsEvent*) malloc((recording.number_of_events ? recording.number_of_events : 1) * sizeof(JsEvent));
+    const long number_of_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    const uint64_t start = js_cli_now();
+    if (events && js_decode_recording(&recording, events, number_of_processors > 0 ? (unsigned int) number_of_processors : 1) != JsResult_success) {
+        fprintf(stderr, "Error: Recording '%s' is corrupt\n", path);
+        free(events);
+        events = nullptr;
+    }
+    if (decode_time) {
+        *decode_time = (double) (js_cli_now() - start) * 1e-9;
+    }
+    if (size) {
+        *size = recording.size;
+    }
+    *number_of_events = recording.number_of_events;
+    js_close_recording(&recording);
+    return events;
+}
+
+static JsResult js_cli_replay_action(const JsEvent * event, void * arg)
+{
+    if (!is_running) {
+        return JsResult_stop;
+    }
+    js_display_event(event);
+    return JsResult_success;
+}
+
+static int js_command_replay(int argc, char * argv[])
+{
+    static const struct option options[] = {
+        {"speed", required_argument, nullptr, 's'},
+        {}
+    };
+
+    double speed = 1.0;
+    int option;
+    while ((option = getopt_long(argc, argv, "s:", options, nullptr)) != -1) {
+        if (option != 's') {
+            goto usage_error;
+        }
+        speed = strtod(optarg, nullptr);
+    }
+    if (argc - optind != 1) {
+        goto usage_error;
+    }
+
+    size_t number_of_events;
+    JsEvent * const events = js_cli_load(argv[optind], &number_of_events, nullptr, nullptr);
+    if (!events) {
+        return EXIT_FAILURE;
+    }
+    const JsResult r = js_replay_events(events, number_of_events, speed, js_cli_replay_action, nullptr, &is_running);
+    free(events);
+    return r == JsResult_success ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    usage_error:
+    fprintf(stderr, "Usage: js replay [--speed factor (0: as fast as possible)] recording\n");
+    return EXIT_FAILURE;
+}
+
+/* stall of the consumer (in s) a queue sized by js_timing_suggest_capacity has to bridge */
+#define js_cli_queue_duration 0.1
+
+/* queue capacity and sampling period matching the report rate of the device */
+static void js_cli_print_suggestions(const JsTimingMetrics * metrics)
+{
+    if (metrics->report_rate <= 0.0) {
+        return;
+    }
+    printf("suggested    queue capacity %zu events (%.0f ms), sampling period %" PRIu32 " us\n",
+        js_timing_suggest_capacity(metrics, js_cli_queue_duration), js_cli_queue_duration * 1e3,
+        js_timing_suggest_period(metrics));
+}
+
+/* report rate of the device and the suggestions derived from it */
+static void js_cli_print_timing(const JsTimingMetrics * metrics)
+{
+    if (metrics->report_rate <= 0.0) {
+        return;
+    }
+    printf("report rate  %.1f Hz, interval %.3f ms, jitter %.3f ms, %.2f events/report\n",
+        metrics->report_rate, metrics->report_interval, metrics->jitter, metrics->events_per_report);
+    js_cli_print_suggestions(metrics);
+}
+
+static int js_command_stats(int argc, char * argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: js stats recording\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t number_of_events;
+    size_t size;
+    double decode_time;
+    JsEvent * const events = js_cli_load(argv[1], &number_of_events, &size, &decode_time);
+    if (!events) {
+        return EXIT_FAILURE;
+    }
+    uint32_t * const intervals = (uint32_t*) malloc((number_of_events ? number_of_events : 1) * sizeof(uint32_t));
+    JsTiming timing = {};
+    if (!intervals || js_init_timing(&timing) != JsResult_success) {
+        free(intervals);
+        free(events);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t duration = 0;
+    size_t number_of_intervals = 0;
+    size_t number_of_synthetic_events = 0;
+    size_t axis_events[js_max_number_of_axes] = {};
+    int16_t axis_minimum[js_max_number_of_axes];
+    int16_t axis_maximum[js_max_number_of_axes];
+    size_t button_presses[js_max_number_of_buttons] = {};
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        axis_minimum[i] = INT16_MAX;
+        axis_maximum[i] = INT16_MIN;
+    }
+
+    for (size_t i=0; i<number_of_events; ++i) {
+        const JsEvent * const event = &events[i];
+        if (i > 0) {
+            /* (kernel times wrap around after 49 days, recordings of several sessions may go back) */
+            const int32_t interval = (int32_t) (event->time - events[i - 1].time);
+            duration += interval > 0 ? (uint32_t) interval : 0;
+            intervals[number_of_intervals++] = interval > 0 ? (uint32_t) interval : 0;
+        }
+        /* a recording has no read times (only the kernel-based metrics are available) */
+        js_timing_update(&timing, event, nullptr);
+        if (event->type & JS_EVENT_INIT) {
+            ++number_of_synthetic_events;
+        }
+        if ((event->type & JS_EVENT_AXIS) && event->number < js_max_number_of_axes) {
+            ++axis_events[event->number];
+            axis_minimum[event->number] = event->value < axis_minimum[event->number] ? event->value : axis_minimum[event->number];
+            axis_maximum[event->number] = event->value > axis_maximum[event->number] ? event->value : axis_maximum[event->number];
+        }
+        else if ((event->type & JS_EVENT_BUTTON) && event->number < js_max_number_of_buttons && event->value) {
+            ++button_presses[event->number];
+        }
+    }
+
+    printf("%zu events (%zu synthetic) in %.3f s, %.1f events/s\n", number_of_events, number_of_synthetic_events,
+        (double) duration * 1e-3, duration ? (double) number_of_events * 1e3 / (double) duration : 0.0);
+    printf("%zu bytes (%.2f bytes/event), decoded in %.3f ms (%.1f M events/s)\n", size,
+        number_of_events ? (double) size / (double) number_of_events : 0.0, decode_time * 1e3,
+        decode_time > 0.0 ? (double) number_of_events * 1e-6 / decode_time : 0.0);
+    js_cli_print_distribution("interval", intervals, number_of_intervals, 1.0, "ms");
+    JsTimingMetrics metrics;
+    if (js_get_timing_metrics(&timing, &metrics) == JsResult_success) {
+        js_cli_print_timing(&metrics);
+    }
+    for (size_t i=0; i<js_max_number_of_axes; ++i) {
+        if (axis_events[i]) {
+            printf("axis %-2zu      %zu events, range [%d, %d]\n", i, axis_events[i], axis_minimum[i], axis_maximum[i]);
+        }
+    }
+    for (size_t i=0; i<js_max_number_of_buttons; ++i) {
+        if (button_presses[i]) {
+            printf("button %-2zu    %zu presses\n", i, button_presses[i]);
+        }
+    }
+
+    js_destroy_timing(&timing);
+    free(intervals);
+    free(events);
+    return EXIT_SUCCESS;
+}
+
+/****************************************************************************************************
+ *
+ * js bench
+ *
+ ***************************************************************************************************/
+
+/* the timing analysis takes the time at which the event handler read an event as its read time,
+ * since the events read at once are handled one after the other */
+typedef struct JsCliBench {
+    JsTiming timing;
+    atomic_uint_fast64_t number_of_events;
+    /* kernel times relative to read times (latency jitter) */
+    uint64_t first_time;
+    uint32_t first_event_time;
+    int64_t min_offset;
+    int64_t max_offset;
+} JsCliBench;
+
+static JsResult js_cli_bench_action(const JsEvent * event, void * arg)
+{
+    JsCliBench * const bench = (JsCliBench*) arg;
+    const JsEventStamp stamp = js_get_event_stamp();
+
+    const struct timespec read_time = {
+        .tv_sec = (time_t) (stamp.time / 1'000'000'000), .tv_nsec = (long) (stamp.time % 1'000'000'000)
+    };
+    if (js_timing_update(&bench->timing, event, &read_time) != JsResult_success) {
+        return JsResult_failure;
+    }
+
+    if (atomic_fetch_add_explicit(&bench->number_of_events, 1, memory_order_relaxed) == 0) {
+        bench->first_time = stamp.time;
+        bench->first_event_time = event->time;
+    }
+    /* synthetic events are read at once during startup */
+    else if (!(event->type & JS_EVENT_INIT)) {
+        const int64_t offset = (int64_t) (stamp.time - bench->first_time)
+            - (int64_t) (uint32_t) (event->time - bench->first_event_time) * 1'000'000;
+        bench->min_offset = offset < bench->min_offset ? offset : bench->min_offset;
+        bench->max_offset = offset > bench->max_offset ? offset : bench->max_offset;
+    }
+
+    return JsResult_success;
+}
+
+static int js_command_bench(int argc, char * argv[])
+{
+    static const struct option options[] = {
+        {"duration", required_argument, nullptr, 'd'},
+        {}
+    };
+
+    double duration = 10.0;
+    int option;
+    while ((option = getopt_long(argc, argv, "d:", options, nullptr)) != -1) {
+        if (option != 'd') {
+            goto usage_error;
+        }
+        duration = strtod(optarg, nullptr);
+    }
+    if (argc - optind > 1 || duration <= 0.0) {
+        goto usage_error;
+    }
+
+    const char * const pathname = (optind < argc ? argv[optind] : js_std_pathname);
+
+    const int js = js_connect(pathname);
+    if (js < 0) {
+        fprintf(stderr, "Error: Unable to connect to joystick at '%s'\n", pathname);
+        goto connect_error;
+    }
+
+    JsCliBench bench = {
+        .min_offset = INT64_MAX,
+        .max_offset = INT64_MIN
+    };
+    atomic_init(&bench.number_of_events, 0);
+    if (js_init_timing(&bench.timing) != JsResult_success) {
+        goto init_timing_error;
+    }
+
+    /* queue monitoring only (nothing is shed without a budget policy) */
+    JsEventHandler event_handler = {
+        .js = js,
+        .event_action = js_cli_bench_action,
+        .event_action_arg = &bench,
+        .backlog_threshold = 8
+    };
+    if (js_create_event_handler(&event_handler) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to create event handler!\n");
+        goto create_event_handler_error;
+    }
+
+    fprintf(stderr, "measuring %s for %.1f s (move the sticks)\n", pathname, duration);
+    const uint64_t start = js_cli_now();
+    uint64_t now = start;
+    while (is_running && js_event_handler_is_running(&event_handler) && (double) (now - start) * 1e-9 < duration) {
+        fprintf(stderr, "\r%" PRIuFAST64 " events", atomic_load_explicit(&bench.number_of_events, memory_order_relaxed));
+        thrd_sleep(&(struct timespec){.tv_nsec = 100'000'000}, nullptr);
+        now = js_cli_now();
+    }
+    fprintf(stderr, "\n");
+    js_destroy_event_handler(&event_handler);
+
+    const uint_fast64_t number_of_events = atomic_load_explicit(&bench.number_of_events, memory_order_relaxed);
+    printf("%" PRIuFAST64 " events (%" PRIuFAST64 " synthetic) in %.3f s, %.1f events/s\n",
+        number_of_events, atomic_load(&event_handler.number_of_synthetic_events), (double) (now - start) * 1e-9,
+        (double) number_of_events * 1e9 / (double) (now - start));
+    JsTimingMetrics metrics;
+    if (js_get_timing_metrics(&bench.timing, &metrics) == JsResult_success && metrics.number_of_reports > 1) {
+        js_display_timing_metrics(&metrics);
+        js_cli_print_suggestions(&metrics);
+        printf("latency jitter %.3f ms (spread of read times relative to kernel times)\n",
+            (double) (bench.max_offset - bench.min_offset) * 1e-6);
+    }
+    printf("queue depth max %" PRIuFAST32 " events, %" PRIuFAST64 " backlogs (depth >= %" PRIu32 ")\n",
+        atomic_load(&event_handler.max_queue_depth), atomic_load(&event_handler.number_of_backlogs),
+        event_handler.backlog_threshold);
+
+    js_destroy_timing(&bench.timing);
+    js_disconnect(js);
+    return EXIT_SUCCESS;
+
+    create_event_handler_error:
     {
-        posigs_destroy_handler(&signal_handler);
+        js_destroy_timing(&bench.timing);
     }
-    create_signal_handler_error:
+    init_timing_error:
+    {
+        js_disconnect(js);
+    }
+    connect_error:
+    return EXIT_FAILURE;
+
+    usage_error:
+    fprintf(stderr, "Usage: js bench [--duration s] {pathname}\n");
     return EXIT_FAILURE;
 }
+
+/****************************************************************************************************
+ *
+ * Main
+ *
+ ***************************************************************************************************/
+
+typedef struct JsCommand {
+    const char * name;
+    int (*run)(int argc, char * argv[]);
+    bool needs_signal_handler;
+} JsCommand;
+
+static const JsCommand js_commands[] = {
+    {"list", js_command_list, false},
+    {"monitor", js_command_monitor, true},
+    {"record", js_command_record, true},
+    {"replay", js_command_replay, true},
+    {"bench", js_command_bench, true},
+    {"stats", js_command_stats, false}
+};
+
+int main(int argc, char * argv[])
+{
+    /*
+     * Select Command (without a command, the argument is the pathname of the joystick to monitor)
+     */
+
+    const JsCommand * command = &js_commands[1];
+    if (argc > 1) {
+        const JsCommand * named = nullptr;
+        for (size_t i=0; i<sizeof(js_commands) / sizeof(js_commands[0]); ++i) {
+            if (strcmp(argv[1], js_commands[i].name) == 0) {
+                named = &js_commands[i];
+            }
+        }
+        if (named) {
+            command = named;
+            --argc;
+            ++argv;
+        }
+        /* any other argument containing a slash or naming an existing file is a pathname */
+        else if (!strchr(argv[1], '/') && access(argv[1], F_OK) != 0) {
+            fprintf(stderr, "Usage: js {list | monitor | record | replay | bench | stats} ... (or js {pathname})\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!command->needs_signal_handler) {
+        return command->run(argc, argv);
+    }
+
+    /*
+     * Install Signal Handler
+     */
+
+    sigset_t sig_set;
+    sigemptyset(&sig_set);
+    PosigsHandler signal_handler = {
+        .sig_set = &sig_set,
+        .sig_action = sigint_action,
+        .timeout = (struct timespec){.tv_nsec = 10'000'000}
+    };
+    if (!((sigaddset(&sig_set, SIGINT) == 0) && posigs_create_handler(&signal_handler))) {
+        fprintf(stderr, "Error: Unable to install signal handler!\n");
+        return EXIT_FAILURE;
+    }
+
+    const int r = command->run(argc, argv);
+    posigs_destroy_handler(&signal_handler);
+    return r;
+}
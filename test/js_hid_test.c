@@ -0,0 +1,185 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "js_hid.h"
+
+/****************************************************************************************************
+ *
+ * hidraw Backend Test
+ *
+ ***************************************************************************************************/
+
+/*
+ * A stream of reports is written into a pipe standing in for a hidraw device and decoded with the
+ * report descriptor of a Logitech gamepad (F310/F710) in DirectInput mode: 4 axes of 8 bits (X, Y,
+ * Z, Rz), a hat switch with a null state, 12 buttons and 16 vendor bits (8-byte reports without
+ * report id). The state after each report, the events emitted for it and the splitting of reports
+ * that arrive in parts are checked, as well as the rejection of malformed descriptors.
+ */
+
+static const uint8_t js_test_descriptor[] = {
+    0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0xA1, 0x02, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x35, 0x00, 0x46,
+    0xFF, 0x00, 0x75, 0x08, 0x95, 0x04, 0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x81, 0x02,
+    0x25, 0x07, 0x46, 0x3B, 0x01, 0x75, 0x04, 0x95, 0x01, 0x65, 0x14, 0x09, 0x39, 0x81, 0x42, 0x65,
+    0x00, 0x25, 0x01, 0x45, 0x01, 0x75, 0x01, 0x95, 0x0C, 0x05, 0x09, 0x19, 0x01, 0x29, 0x0C, 0x81,
+    0x02, 0x06, 0x00, 0xFF, 0x75, 0x01, 0x95, 0x10, 0x25, 0x01, 0x45, 0x01, 0x09, 0x01, 0x81, 0x02,
+    0xC0, 0xA1, 0x02, 0x26, 0xFF, 0x00, 0x46, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x07, 0x09, 0x02, 0x91,
+    0x02, 0xC0, 0xC0
+};
+
+static int js_test_failures = 0;
+
+static void js_check(bool condition, const char * name)
+{
+    printf("%-60s %s\n", name, condition ? "ok" : "FAILED");
+    js_test_failures += !condition;
+}
+
+typedef struct JsTestEvents {
+    JsEvent events[64];
+    size_t number_of_events;
+    size_t number_of_states;
+} JsTestEvents;
+
+static JsResult js_test_event_action(const JsEvent * event, void * arg)
+{
+    JsTestEvents * const t = (JsTestEvents*) arg;
+    if (t->number_of_events < sizeof(t->events) / sizeof(t->events[0])) {
+        t->events[t->number_of_events++] = *event;
+    }
+    return JsResult_success;
+}
+
+static JsResult js_test_state_action(const JsState * state, void * arg)
+{
+    ++((JsTestEvents*) arg)->number_of_states;
+    return JsResult_success;
+}
+
+/* report of the gamepad (hat 8 is the null state, buttons 0 to 11 as bit mask) */
+static void js_test_report(uint8_t * report, uint8_t x, uint8_t y, uint8_t z, uint8_t rz, uint8_t hat, uint16_t buttons)
+{
+    report[0] = x;
+    report[1] = y;
+    report[2] = z;
+    report[3] = rz;
+    report[4] = (uint8_t) (hat | ((buttons & 0x0F) << 4));
+    report[5] = (uint8_t) (buttons >> 4);
+    /* vendor bits (ignored) */
+    report[6] = 0xA5;
+    report[7] = 0x5A;
+}
+
+static bool js_test_axes(const JsState * state, const int16_t * expected)
+{
+    return memcmp(state->axes, expected, 6 * sizeof(int16_t)) == 0;
+}
+
+/* all events of the last report are of the given kind (synthetic or not) */
+static bool js_test_is_synthetic(const JsTestEvents * t, bool is_synthetic)
+{
+    for (size_t i=0; i<t->number_of_events; ++i) {
+        if (((t->events[i].type & JS_EVENT_INIT) != 0) != is_synthetic) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    int fds[2];
+    if (pipe(fds) != 0 || fcntl(fds[0], F_SETFL, O_NONBLOCK) != 0) {
+        fprintf(stderr, "cannot create pipe\n");
+        return EXIT_FAILURE;
+    }
+
+    JsTestEvents t = {};
+    JsHidDevice device = {
+        .event_action = js_test_event_action,
+        .event_action_arg = &t,
+        .state_action = js_test_state_action,
+        .state_action_arg = &t
+    };
+    js_check(js_open_hid_device(&device, fds[0], js_test_descriptor, sizeof(js_test_descriptor)) == JsResult_success,
+        "descriptor parsed");
+    JsProperties properties;
+    js_check(js_get_hid_properties(&device, &properties) == JsResult_success
+        && properties.number_of_axes == 6 && properties.number_of_buttons == 12, "6 axes (4 + hat), 12 buttons");
+    js_check(!device.plan.has_report_ids && device.plan.report_sizes[0] == 8, "8-byte reports without report id");
+    js_check(js_hid_process_ready(&device) == JsResult_nothing, "nothing pending");
+
+    /* first report: extremes, hat centered (the initial state is reported as synthetic events) */
+    uint8_t report[3][8];
+    js_test_report(report[0], 0, 255, 0, 255, 8, 0);
+    write(fds[1], report[0], 8);
+    js_check(js_hid_process_ready(&device) == JsResult_success
+        && js_test_axes(&device.state, (const int16_t[]){-32767, 32767, -32767, 32767, 0, 0})
+        && device.state.buttons == 0, "first report");
+    js_check(t.number_of_events == 18 && js_test_is_synthetic(&t, true), "first report: 18 synthetic events");
+
+    /* two reports at once: X to the maximum, hat east, buttons 1 and 12; then hat south, button 5 */
+    t.number_of_events = 0;
+    js_test_report(report[1], 255, 255, 0, 255, 2, 0x0801);
+    js_test_report(report[2], 255, 255, 0, 255, 4, 0x0010);
+    write(fds[1], report[1], 8);
+    write(fds[1], report[2], 5);
+    js_check(js_hid_process_ready(&device) == JsResult_success
+        && js_test_axes(&device.state, (const int16_t[]){32767, 32767, -32767, 32767, 32767, 0})
+        && device.state.buttons == 0x0801 && t.number_of_states == 2, "second report (third incomplete)");
+    js_check(t.number_of_events == 4 && js_test_is_synthetic(&t, false), "second report: 4 events");
+
+    /* rest of the third report */
+    t.number_of_events = 0;
+    write(fds[1], &report[2][5], 3);
+    js_check(js_hid_process_ready(&device) == JsResult_success
+        && js_test_axes(&device.state, (const int16_t[]){32767, 32767, -32767, 32767, 0, 32767})
+        && device.state.buttons == 0x0010 && t.number_of_states == 3, "third report (completed)");
+    js_check(t.number_of_events == 5, "third report: 5 events (2 hat axes, 3 buttons)");
+
+    /* end of the stream */
+    close(fds[1]);
+    js_check(js_hid_process_ready(&device) == JsResult_stop, "end of stream stops");
+
+    close(fds[0]);
+
+    /* malformed descriptor: 64 constant Input items of 8192 x 8192 bits (wrapping 32-bit bit offsets
+     * around) before an axis, the parser must reject it as soon as the report exceeds its maximum */
+    uint8_t malformed[256];
+    size_t n = 0;
+    const uint8_t head[] = {0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0x76, 0x00, 0x20, 0x96, 0x00, 0x20};
+    memcpy(&malformed[n], head, sizeof(head));
+    n += sizeof(head);
+    for (int i=0; i<64; ++i) {
+        malformed[n++] = 0x81;
+        malformed[n++] = 0x01;
+    }
+    const uint8_t tail[] = {0x75, 0x08, 0x95, 0x01, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x09, 0x30, 0x81, 0x02, 0xC0};
+    memcpy(&malformed[n], tail, sizeof(tail));
+    n += sizeof(tail);
+    JsHidPlan plan;
+    js_check(js_parse_hid_descriptor(&plan, malformed, n) == JsResult_failure, "malformed descriptor: wrapping bit offsets rejected");
+
+    /* a report larger than the maximum size is rejected as well */
+    const uint8_t oversized[] = {
+        0x05, 0x01, 0x09, 0x04, 0xA1, 0x01, 0x75, 0x08, 0x96, 0x00, 0x04, 0x81, 0x01,
+        0x75, 0x08, 0x95, 0x01, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x09, 0x30, 0x81, 0x02, 0xC0
+    };
+    js_check(js_parse_hid_descriptor(&plan, oversized, sizeof(oversized)) == JsResult_failure,
+        "malformed descriptor: oversized report rejected");
+
+    /* fields beyond a short report are skipped (the bounds check must not wrap around either) */
+    js_check(js_parse_hid_descriptor(&plan, js_test_descriptor, sizeof(js_test_descriptor)) == JsResult_success,
+        "descriptor parsed again");
+    plan.fields[0].bit_offset = UINT32_MAX - 7;
+    JsState state = {};
+    const uint8_t byte = 0x80;
+    js_decode_hid_report(&plan, &byte, 1, &state);
+    js_check(state.axes[0] == 0, "field at an offset near 2^32 skipped");
+
+    return js_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
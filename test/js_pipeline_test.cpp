@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+
+#include "js_pipeline.hpp"
+
+/****************************************************************************************************
+ *
+ * Pipeline Test
+ *
+ ***************************************************************************************************/
+
+/*
+ * Batches are processed with js::pipeline() and the events reaching a sink are compared with the
+ * expected ones: coalescing before and after a remap that swaps axes (coalescing has to see the axis
+ * numbers of the preceding stages), deadzones, filters and dropping through remap_drop.
+ */
+
+static int js_test_failures = 0;
+
+static void js_check(bool condition, const char * name)
+{
+    std::printf("%-60s %s\n", name, condition ? "ok" : "FAILED");
+    js_test_failures += !condition;
+}
+
+static js::Event js_test_axis(std::uint8_t number, std::int16_t value)
+{
+    return {0, value, JS_EVENT_AXIS, number};
+}
+
+static bool js_test_equal(const std::vector<js::Event> & a, const std::vector<js::Event> & b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i=0; i<a.size(); ++i) {
+        if (a[i].type != b[i].type || a[i].number != b[i].number || a[i].value != b[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::vector<js::Event> out;
+    const auto collect = [&](const js::Event & event) {out.push_back(event);};
+
+    js::Remap swap = js::remap();
+    swap.axes[0] = 1;
+    swap.axes[1] = 0;
+
+    /* coalescing after a remap uses the remapped numbers */
+    {
+        auto pipeline = js::pipeline() | swap | js::coalesce() | js::sink(collect);
+        js::Event batch[] = {js_test_axis(0, 1), js_test_axis(1, 2), js_test_axis(0, 3), js_test_axis(1, 4)};
+        out.clear();
+        pipeline.process(batch, 4);
+        js_check(js_test_equal(out, {js_test_axis(1, 3), js_test_axis(0, 4)}), "remap | coalesce");
+    }
+
+    /* coalescing before a remap */
+    {
+        auto pipeline = js::pipeline() | js::coalesce() | swap | js::sink(collect);
+        js::Event batch[] = {js_test_axis(0, 1), js_test_axis(1, 2), js_test_axis(0, 3), js_test_axis(1, 4)};
+        out.clear();
+        pipeline.process(batch, 4);
+        js_check(js_test_equal(out, {js_test_axis(1, 3), js_test_axis(0, 4)}), "coalesce | remap");
+    }
+
+    /* a remap merging two axes into one: only the last event of the merged axis remains */
+    {
+        js::Remap merge = js::remap();
+        merge.axes[1] = 0;
+        auto pipeline = js::pipeline() | merge | js::coalesce() | js::sink(collect);
+        js::Event batch[] = {js_test_axis(0, 1), js_test_axis(1, 2), js_test_axis(2, 3)};
+        out.clear();
+        pipeline.process(batch, 3);
+        js_check(js_test_equal(out, {js_test_axis(0, 2), js_test_axis(2, 3)}), "merging remap | coalesce");
+    }
+
+    /* events dropped before coalescing do not supersede earlier ones */
+    {
+        js::Remap drop = js::remap();
+        drop.axes[3] = js::Remap::remap_drop;
+        auto pipeline = js::pipeline()
+            | js::filter([](const js::Event & event) {return event.value != 9;})
+            | drop | js::coalesce() | js::sink(collect);
+        js::Event batch[] = {js_test_axis(0, 1), js_test_axis(0, 9), js_test_axis(3, 5)};
+        out.clear();
+        pipeline.process(batch, 3);
+        js_check(js_test_equal(out, {js_test_axis(0, 1)}), "filter | remap (drop) | coalesce");
+        js_check(batch[1].type == 0 && batch[2].type == 0, "dropped events have type 0");
+    }
+
+    /* buttons are never coalesced, deadzones only apply to axes */
+    {
+        auto pipeline = js::pipeline() | js::coalesce() | js::deadzone(1000, false) | js::sink(collect);
+        js::Event batch[] = {{0, 1, JS_EVENT_BUTTON, 0}, {0, 0, JS_EVENT_BUTTON, 0}, js_test_axis(0, 500), js_test_axis(1, -2000)};
+        out.clear();
+        pipeline.process(batch, 4);
+        js_check(js_test_equal(out, {{0, 1, JS_EVENT_BUTTON, 0}, {0, 0, JS_EVENT_BUTTON, 0}, js_test_axis(0, 0), js_test_axis(1, -2000)}),
+            "coalesce | deadzone");
+    }
+
+    bool is_rejected = false;
+    try {
+        js::deadzone(-1);
+    }
+    catch (const std::out_of_range &) {
+        is_rejected = true;
+    }
+    js_check(is_rejected, "negative deadzone rejected");
+
+    return js_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
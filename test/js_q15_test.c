@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "js_q15.h"
+
+/****************************************************************************************************
+ *
+ * Q15 Conditioner Test
+ *
+ ***************************************************************************************************/
+
+/*
+ * js_q15_condition (the SIMD kernel of the target, if any) has to match the scalar reference
+ * js_q15_condition_reference bit-exactly:
+ *
+ * + on random configurations (every stage enabled with probability 1/2, random parameters within
+ *   the limits accepted by the setters) and random inputs biased towards -32768, 0 and 32767,
+ * + on configurations and inputs made of extreme values only (largest gains and mixing weights,
+ *   filters from no smoothing to the strongest one).
+ *
+ * Both conditioners of a pair advance their filter state, so every configuration is run on a
+ * sequence of inputs. A few known results of single stages are checked as well.
+ */
+
+#define js_test_number_of_configs 20000
+#define js_test_inputs_per_config 50
+
+static int js_test_failures = 0;
+
+static void js_check(bool condition, const char * name)
+{
+    printf("%-60s %s\n", name, condition ? "ok" : "FAILED");
+    js_test_failures += !condition;
+}
+
+/* deterministic pseudo-random numbers (independent of the C library) */
+static uint32_t js_test_random_state = 1;
+
+static uint32_t js_test_random(void)
+{
+    js_test_random_state = js_test_random_state * 1664525u + 1013904223u;
+    return js_test_random_state >> 8;
+}
+
+static int16_t js_test_random_value(void)
+{
+    switch (js_test_random() % 8) {
+        case 0: return INT16_MIN;
+        case 1: return INT16_MAX;
+        case 2: return 0;
+        default: return (int16_t) (js_test_random() & 0xFFFF);
+    }
+}
+
+static void js_test_random_config(JsQ15Conditioner * conditioner)
+{
+    js_init_q15_conditioner(conditioner);
+    for (uint8_t i=0; i<js_max_number_of_axes; ++i) {
+        if (js_test_random() & 1) {
+            js_q15_set_deadzone(conditioner, i, (int16_t) (js_test_random() % (js_q15_max_deadzone + 1)));
+        }
+        if (js_test_random() & 1) {
+            js_q15_set_gain(conditioner, i, js_test_random_value());
+        }
+        if (js_test_random() & 1) {
+            if (js_test_random() & 1) {
+                js_q15_set_expo(conditioner, i, (int16_t) (js_test_random() % 32768));
+            }
+            else {
+                int16_t points[js_q15_curve_points];
+                for (size_t k=0; k<js_q15_curve_points; ++k) {
+                    points[k] = js_test_random_value();
+                }
+                js_q15_set_curve(conditioner, i, points);
+            }
+        }
+        if (js_test_random() & 1) {
+            js_q15_set_filter(conditioner, i, 1 + (int32_t) (js_test_random() % 32768));
+        }
+    }
+    if (js_test_random() & 1) {
+        /* rows whose absolute weights sum to at most 4.0 (Q14) */
+        int16_t mix[js_max_number_of_axes][js_max_number_of_axes];
+        for (size_t i=0; i<js_max_number_of_axes; ++i) {
+            int32_t budget = 65535;
+            for (size_t j=0; j<js_max_number_of_axes; ++j) {
+                int32_t v = js_test_random_value();
+                if (abs(v) > budget || js_test_random() % 3 == 0) {
+                    v = 0;
+                }
+                mix[i][j] = (int16_t) v;
+                budget -= abs(v);
+            }
+        }
+        js_q15_set_mix(conditioner, mix);
+    }
+}
+
+/* run both implementations on the same inputs (returns the number of mismatching outputs) */
+static size_t js_test_compare(JsQ15Conditioner * conditioner, const int16_t (*inputs)[js_max_number_of_axes], size_t n)
+{
+    JsQ15Conditioner reference = *conditioner;
+    size_t number_of_mismatches = 0;
+    for (size_t t=0; t<n; ++t) {
+        int16_t output[js_max_number_of_axes];
+        int16_t expected[js_max_number_of_axes];
+        js_q15_condition(conditioner, inputs[t], output);
+        js_q15_condition_reference(&reference, inputs[t], expected);
+        number_of_mismatches += memcmp(output, expected, sizeof(output)) != 0;
+    }
+    return number_of_mismatches;
+}
+
+int main(void)
+{
+    static const int16_t extremes[] = {INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX};
+    const size_t number_of_extremes = sizeof(extremes) / sizeof(extremes[0]);
+
+    /* random configurations and inputs */
+    size_t number_of_mismatches = 0;
+    for (size_t c=0; c<js_test_number_of_configs; ++c) {
+        JsQ15Conditioner conditioner;
+        js_test_random_config(&conditioner);
+        int16_t inputs[js_test_inputs_per_config][js_max_number_of_axes];
+        for (size_t t=0; t<js_test_inputs_per_config; ++t) {
+            for (size_t i=0; i<js_max_number_of_axes; ++i) {
+                inputs[t][i] = js_test_random_value();
+            }
+        }
+        number_of_mismatches += js_test_compare(&conditioner, inputs, js_test_inputs_per_config);
+    }
+    js_check(number_of_mismatches == 0, "kernel matches reference (random)");
+
+    /* extreme configurations and inputs */
+    number_of_mismatches = 0;
+    for (size_t a=0; a<number_of_extremes; ++a) {
+        for (size_t b=0; b<2; ++b) {
+            /* each row mixes two axes with the largest weights allowed */
+            const int32_t w = abs(extremes[a]);
+            const int16_t v = (int16_t) (65535 - w > INT16_MAX ? INT16_MAX : 65535 - w);
+            int16_t mix[js_max_number_of_axes][js_max_number_of_axes] = {};
+            for (size_t i=0; i<js_max_number_of_axes; ++i) {
+                mix[i][i] = extremes[a];
+                mix[i][(i + 1) % js_max_number_of_axes] = b ? (int16_t) -v : v;
+            }
+
+            JsQ15Conditioner conditioner;
+            js_init_q15_conditioner(&conditioner);
+            if (js_q15_set_mix(&conditioner, mix) != JsResult_success) {
+                continue;
+            }
+            for (uint8_t i=0; i<js_max_number_of_axes; ++i) {
+                js_q15_set_gain(&conditioner, i, extremes[(a + i) % number_of_extremes]);
+                js_q15_set_deadzone(&conditioner, i, (int16_t) (i * 2000));
+                js_q15_set_filter(&conditioner, i, i == 0 ? 32768 : i == 1 ? 1 : i * 4000);
+                js_q15_set_expo(&conditioner, i, (int16_t) (i * 4681));
+            }
+
+            int16_t inputs[343][js_max_number_of_axes];
+            for (size_t t=0; t<343; ++t) {
+                for (size_t i=0; i<js_max_number_of_axes; ++i) {
+                    inputs[t][i] = extremes[(t / (i % 3 + 1) + i) % number_of_extremes];
+                }
+            }
+            number_of_mismatches += js_test_compare(&conditioner, inputs, 343);
+        }
+    }
+    js_check(number_of_mismatches == 0, "kernel matches reference (extremes)");
+
+    /* known results */
+    JsQ15Conditioner conditioner;
+    js_init_q15_conditioner(&conditioner);
+    const int16_t input[js_max_number_of_axes] = {INT16_MIN, INT16_MAX, 100, -100, 0, 16384, -16384, 1};
+    int16_t output[js_max_number_of_axes];
+    js_q15_condition(&conditioner, input, output);
+    js_check(memcmp(input, output, sizeof(output)) == 0, "no stage enabled: identity");
+
+    for (uint8_t i=0; i<js_max_number_of_axes; ++i) {
+        js_q15_set_deadzone(&conditioner, i, 1000);
+    }
+    js_q15_condition(&conditioner, input, output);
+    js_check(output[0] == -32767 && output[1] == INT16_MAX && output[2] == 0 && output[3] == 0 && output[4] == 0,
+        "deadzone: center removed, symmetric full range kept");
+
+    /* x^3 at +-0.5 */
+    js_init_q15_conditioner(&conditioner);
+    js_q15_set_expo(&conditioner, 5, 32767);
+    js_q15_set_expo(&conditioner, 6, 32767);
+    js_q15_condition(&conditioner, input, output);
+    js_check(abs(output[5] - 4096) <= 2 && abs(output[6] + 4096) <= 2, "expo: cubic curve");
+
+    const int16_t invalid_mix[js_max_number_of_axes][js_max_number_of_axes] = {{INT16_MAX, INT16_MAX, 2}};
+    js_check(js_q15_set_mix(&conditioner, invalid_mix) == JsResult_failure, "mixing row above 4.0 rejected");
+
+    return js_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <threads.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "js_ros.h"
+
+/****************************************************************************************************
+ *
+ * TCPROS Publisher Test
+ *
+ ***************************************************************************************************/
+
+/*
+ * Stand-in subscribers connect to a JsRosPublisher over the loopback interface: the handshake must
+ * not block while a connection header is missing or incomplete, the response header must describe
+ * sensor_msgs/Joy, published messages must decode to the published state, and subscribers with a
+ * wrong md5sum or that disconnect must be dropped.
+ */
+
+static int js_test_failures = 0;
+
+static void js_check(bool condition, const char * name)
+{
+    printf("%-60s %s\n", name, condition ? "ok" : "FAILED");
+    js_test_failures += !condition;
+}
+
+static uint64_t js_test_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1'000'000'000 + t.tv_nsec;
+}
+
+static int js_test_connect(uint16_t port)
+{
+    const struct sockaddr_in a = {
+        .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (const struct sockaddr*) &a, sizeof(a)) != 0) {
+        return -1;
+    }
+    /* never wait forever for the publisher */
+    const struct timeval timeout = {.tv_sec = 1};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool js_test_read(int fd, void * data, size_t size)
+{
+    uint8_t * p = (uint8_t*) data;
+    while (size > 0) {
+        const ssize_t s = recv(fd, p, size, 0);
+        if (s <= 0) {
+            return false;
+        }
+        p += s;
+        size -= s;
+    }
+    return true;
+}
+
+/* connection header of a subscriber (returns its size) */
+static size_t js_test_header(uint8_t * data, const char * md5sum)
+{
+    const char * const fields[] = {"callerid=/stand_in", "topic=/joy", "type=sensor_msgs/Joy", md5sum, "tcp_nodelay=1"};
+    size_t n = 4;
+    for (size_t i=0; i<sizeof(fields) / sizeof(fields[0]); ++i) {
+        const uint32_t length = (uint32_t) strlen(fields[i]);
+        memcpy(&data[n], &length, 4);
+        memcpy(&data[n + 4], fields[i], length);
+        n += 4 + length;
+    }
+    const uint32_t length = (uint32_t) (n - 4);
+    memcpy(data, &length, 4);
+    return n;
+}
+
+/* read a response header */
+static bool js_test_read_response(int fd, uint8_t * response, size_t capacity, size_t * size)
+{
+    uint32_t length;
+    if (!js_test_read(fd, &length, 4) || length > capacity || !js_test_read(fd, response, length)) {
+        return false;
+    }
+    *size = length;
+    return true;
+}
+
+static bool js_test_contains(const uint8_t * data, size_t size, const char * field)
+{
+    const size_t length = strlen(field);
+    for (size_t i=0; i+length<=size; ++i) {
+        if (memcmp(&data[i], field, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* call js_ros_publisher_accept until it adds a subscriber (or 100 ms have passed) */
+static JsResult js_test_accept(JsRosPublisher * publisher, uint64_t * max_duration)
+{
+    const uint64_t end = js_test_now() + 100'000'000;
+    JsResult r;
+    do {
+        const uint64_t t = js_test_now();
+        r = js_ros_publisher_accept(publisher);
+        const uint64_t d = js_test_now() - t;
+        *max_duration = d > *max_duration ? d : *max_duration;
+    } while (r == JsResult_nothing && js_test_now() < end);
+    return r;
+}
+
+int main(void)
+{
+    static uint8_t buffer[4096];
+    static uint8_t header[1024];
+    JsRosPublisher publisher;
+
+    if (js_create_ros_publisher(&publisher, "127.0.0.1", 0, "/js", "/joy", buffer, sizeof(buffer), "js0", 3, 4) != JsResult_success) {
+        fprintf(stderr, "cannot create publisher\n");
+        return EXIT_FAILURE;
+    }
+    struct sockaddr_in a;
+    socklen_t a_size = sizeof(a);
+    getsockname(publisher.fd, (struct sockaddr*) &a, &a_size);
+    const uint16_t port = ntohs(a.sin_port);
+
+    /* the header arrives in two parts, accept must never wait for it */
+    uint64_t max_duration = 0;
+    const int subscriber = js_test_connect(port);
+    const size_t n = js_test_header(header, "md5sum=" js_joy_md5sum);
+    js_check(js_test_accept(&publisher, &max_duration) == JsResult_nothing && publisher.number_of_pending == 1,
+        "connection without header is pending");
+    send(subscriber, header, n / 2, 0);
+    js_check(js_test_accept(&publisher, &max_duration) == JsResult_nothing && publisher.number_of_pending == 1,
+        "connection with partial header is pending");
+    send(subscriber, &header[n / 2], n - n / 2, 0);
+    js_check(js_test_accept(&publisher, &max_duration) == JsResult_success && publisher.number_of_subscribers == 1,
+        "subscriber added once the header is complete");
+    js_check(max_duration < 10'000'000, "js_ros_publisher_accept does not block");
+    static uint8_t response[8192];
+    size_t response_size = 0;
+    js_check(js_test_read_response(subscriber, response, sizeof(response), &response_size)
+        && js_test_contains(response, response_size, "md5sum=" js_joy_md5sum)
+        && js_test_contains(response, response_size, "type=" js_joy_type)
+        && js_test_contains(response, response_size, "topic=/joy"),
+        "response header");
+
+    /* a published state arrives as sensor_msgs/Joy */
+    const JsState state = {.time = 1, .buttons = 0b1010, .axes = {32767, -32767, 0}};
+    const struct timespec stamp = {.tv_sec = 12, .tv_nsec = 34};
+    js_ros_publish(&publisher, &state, &stamp);
+    uint8_t message[4096];
+    const size_t size = js_joy_message_size("js0", 3, 4);
+    bool is_message_valid = js_test_read(subscriber, message, size);
+    uint32_t u[4];
+    memcpy(u, message, sizeof(u));
+    float axes[3];
+    int32_t buttons[4];
+    memcpy(axes, &message[4 + 16 + 3 + 4], sizeof(axes));
+    memcpy(buttons, &message[4 + 16 + 3 + 4 + sizeof(axes) + 4], sizeof(buttons));
+    is_message_valid = (
+        is_message_valid && u[0] == size - 4 && u[1] == 0 && u[2] == 12 && u[3] == 34
+        && axes[0] == -1.0f && axes[1] == 1.0f && axes[2] == 0.0f
+        && buttons[0] == 0 && buttons[1] == 1 && buttons[2] == 0 && buttons[3] == 1
+    );
+    js_check(is_message_valid, "published message");
+
+    /* wrong md5sum */
+    const int other = js_test_connect(port);
+    send(other, header, js_test_header(header, "md5sum=0123456789abcdef0123456789abcdef"), 0);
+    js_test_accept(&publisher, &max_duration);
+    js_check(publisher.number_of_subscribers == 1 && publisher.number_of_pending == 0
+        && js_test_read_response(other, response, sizeof(response), &response_size)
+        && js_test_contains(response, response_size, "error="), "subscriber with wrong md5sum rejected");
+    close(other);
+
+    /* disconnected subscribers are dropped */
+    close(subscriber);
+    for (int i=0; i<10 && publisher.number_of_subscribers > 0; ++i) {
+        js_ros_publish(&publisher, &state, nullptr);
+        thrd_sleep(&(struct timespec){.tv_nsec = 1'000'000}, nullptr);
+    }
+    js_check(publisher.number_of_subscribers == 0, "disconnected subscriber dropped");
+
+    js_check(js_destroy_ros_publisher(&publisher) == JsResult_success, "js_destroy_ros_publisher");
+    return js_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
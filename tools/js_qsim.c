@@ -0,0 +1,491 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <unistd.h>
+
+#include "js.h"
+#include "js_record.h"
+#include "js_history.h"
+
+/****************************************************************************************************
+ *
+ * Queue Sizing Simulator
+ *
+ ***************************************************************************************************/
+
+/*
+ * Replays a recording through a model of the input path and reports, for every combination of the
+ * given parameters, how many events are lost, how deep the queues get and how long events take from
+ * their arrival to the end of their processing by the consumer:
+ *
+ *     js_qsim [-k kernel capacities] [-q queue capacities] [-s service times in us]
+ *             [-p consumer periods in us] [-c handler cost in us] [-H history blocks] recording
+ *
+ * Parameters are comma-separated lists. Service times with the suffix 'e' are exponentially
+ * distributed with the given mean, a queue capacity of 0 stands for an unbounded queue. The model:
+ *
+ * + events arrive in the kernel queue at their recorded times; like joydev, a full kernel queue
+ *   discards all pending events and then delivers the current state as one synthetic event per
+ *   channel (axis or button),
+ * + the event handler reads one event at a time, spends the handler cost on it (e.g. the callback
+ *   pushing it into a JsRtQueue) and sleeps for the poll interval of the event handler whenever the
+ *   kernel queue is empty,
+ * + the queue between the event handler and the consumer drops new events while it is full (like
+ *   JsRtQueue),
+ * + the consumer processes one event per service time, either as soon as events are queued (period
+ *   0) or by draining the queue every period (e.g. a control loop).
+ *
+ * Reported per configuration: the fraction of events lost in the kernel and in the queue, the
+ * fraction of 1 s windows of the recording in which events were lost, the maximum depths of both
+ * queues, the queue capacity that would have avoided all losses of the queue (the maximum depth of
+ * an unbounded queue) and percentiles of the latency (synthetic events are excluded).
+ *
+ * For every history capacity (in blocks of js_history_block_size bytes), the states of the recording
+ * are appended to a JsHistory, reporting the shortest and the 1st percentile of the time span the
+ * history covered once it had filled up.
+ */
+
+/* poll interval of the event handler in us (js_timeout in js.c) */
+#define js_qsim_poll_interval 100.0
+
+#define js_qsim_max_values 16
+
+typedef struct JsQsimList {
+    double values[js_qsim_max_values];
+    bool is_exponential[js_qsim_max_values];
+    size_t size;
+} JsQsimList;
+
+typedef struct JsQsimConfig {
+    uint32_t kernel_capacity;
+    /* 0 for an unbounded queue */
+    uint32_t queue_capacity;
+    /* times in us */
+    double service_time;
+    bool is_exponential;
+    double period;
+    double handler_cost;
+} JsQsimConfig;
+
+typedef struct JsQsimResult {
+    size_t number_of_kernel_losses;
+    size_t number_of_queue_losses;
+    size_t number_of_windows_with_losses;
+    size_t max_kernel_depth;
+    size_t max_queue_depth;
+    /* latencies in us */
+    double * latencies;
+    size_t number_of_latencies;
+} JsQsimResult;
+
+/* FIFO of arrival times in us (negative for synthetic events), growing if it is unbounded */
+typedef struct JsQsimQueue {
+    double * times;
+    size_t capacity;
+    size_t head;
+    size_t size;
+    bool is_bounded;
+} JsQsimQueue;
+
+static JsResult js_qsim_create_queue(JsQsimQueue * queue, size_t capacity)
+{
+    *queue = (JsQsimQueue){.capacity = capacity ? capacity : 1024, .is_bounded = capacity != 0};
+    queue->times = (double*) malloc(queue->capacity * sizeof(double));
+    return queue->times ? JsResult_success : JsResult_failure;
+}
+
+static JsResult js_qsim_push(JsQsimQueue * queue, double time)
+{
+    if (queue->size == queue->capacity) {
+        if (queue->is_bounded) {
+            return JsResult_nothing;
+        }
+        double * const times = (double*) malloc(2 * queue->capacity * sizeof(double));
+        if (!times) {
+            return JsResult_failure;
+        }
+        for (size_t i=0; i<queue->size; ++i) {
+            times[i] = queue->times[(queue->head + i) % queue->capacity];
+        }
+        free(queue->times);
+        queue->times = times;
+        queue->head = 0;
+        queue->capacity *= 2;
+    }
+    queue->times[(queue->head + queue->size++) % queue->capacity] = time;
+    return JsResult_success;
+}
+
+static double js_qsim_pop(JsQsimQueue * queue)
+{
+    const double time = queue->times[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    --queue->size;
+    return time;
+}
+
+/* deterministic pseudo-random number in (0, 1] */
+static double js_qsim_random(uint32_t * random)
+{
+    *random = *random * 1664525u + 1013904223u;
+    return ((double) (*random >> 8) + 1.0) * (1.0 / 16777216.0);
+}
+
+/* windows are 1 s long, losses after the end of the recording count for the last window */
+static void js_qsim_mark_window(uint8_t * windows, size_t number_of_windows, double time, size_t * number_of_windows_with_losses)
+{
+    const size_t w = (size_t) fmin(time * 1e-6, (double) (number_of_windows - 1));
+    *number_of_windows_with_losses += !windows[w];
+    windows[w] = 1;
+}
+
+/* arrivals (in us from 0, non-decreasing) of number_of_events events of a device with number_of_channels
+ * channels */
+static JsResult js_qsim_run(const JsQsimConfig * config, const double * arrivals, size_t number_of_events,
+    unsigned int number_of_channels, JsQsimResult * result)
+{
+    *result = (JsQsimResult){};
+
+    const size_t number_of_windows = (size_t) (arrivals[number_of_events - 1] * 1e-6) + 1;
+    uint8_t * const windows = (uint8_t*) calloc(number_of_windows, 1);
+    result->latencies = (double*) malloc(number_of_events * sizeof(double));
+    JsQsimQueue kernel = {};
+    JsQsimQueue queue = {};
+    if (!windows || !result->latencies
+        || js_qsim_create_queue(&kernel, config->kernel_capacity) != JsResult_success
+        || js_qsim_create_queue(&queue, config->queue_capacity) != JsResult_success) {
+        goto error;
+    }
+
+    uint32_t random = 12345;
+    size_t i = 0;
+    /* synthetic events the kernel delivers before the events in its queue */
+    size_t number_of_synthetic_events = 0;
+    /* event being handled by the event handler (pushed to the queue when it is done) */
+    bool is_handling = false;
+    double handled_time = 0.0;
+    /* times of the next actions of the event handler and the consumer (INFINITY while idle) */
+    double h = arrivals[0];
+    double c = INFINITY;
+
+    while (i < number_of_events || kernel.size || number_of_synthetic_events || is_handling || queue.size) {
+        const double a = i < number_of_events ? arrivals[i] : INFINITY;
+
+        /* arrival */
+        if (a <= h && a <= c) {
+            if (kernel.size == kernel.capacity) {
+                /* the queue overflows: pending events are replaced by the state */
+                result->number_of_kernel_losses += kernel.size + 1;
+                kernel.size = 0;
+                number_of_synthetic_events = number_of_channels;
+                js_qsim_mark_window(windows, number_of_windows, a, &result->number_of_windows_with_losses);
+            }
+            else {
+                js_qsim_push(&kernel, a);
+            }
+            const size_t depth = kernel.size + number_of_synthetic_events;
+            result->max_kernel_depth = depth > result->max_kernel_depth ? depth : result->max_kernel_depth;
+            ++i;
+        }
+
+        /* event handler */
+        else if (h <= c) {
+            if (is_handling) {
+                is_handling = false;
+                switch (js_qsim_push(&queue, handled_time)) {
+                    case JsResult_success:
+                        result->max_queue_depth = queue.size > result->max_queue_depth ? queue.size : result->max_queue_depth;
+                        if (c == INFINITY) {
+                            c = config->period > 0.0 ? ceil(h / config->period) * config->period : h;
+                        }
+                        break;
+                    case JsResult_nothing:
+                        ++result->number_of_queue_losses;
+                        js_qsim_mark_window(windows, number_of_windows, h, &result->number_of_windows_with_losses);
+                        break;
+                    default:
+                        goto error;
+                }
+            }
+
+            if (number_of_synthetic_events || kernel.size) {
+                if (number_of_synthetic_events) {
+                    --number_of_synthetic_events;
+                    handled_time = -1.0;
+                }
+                else {
+                    handled_time = js_qsim_pop(&kernel);
+                }
+                is_handling = true;
+                h += config->handler_cost;
+            }
+            /* sleep until the next event has arrived */
+            else if (i < number_of_events) {
+                h += js_qsim_poll_interval * fmax(1.0, ceil((a - h) / js_qsim_poll_interval));
+            }
+            else {
+                h = INFINITY;
+            }
+        }
+
+        /* consumer */
+        else if (queue.size) {
+            const double time = js_qsim_pop(&queue);
+            c += config->is_exponential ? -config->service_time * log(js_qsim_random(&random)) : config->service_time;
+            if (time >= 0.0) {
+                result->latencies[result->number_of_latencies++] = c - time;
+            }
+        }
+        else {
+            c = INFINITY;
+        }
+    }
+
+    free(queue.times);
+    free(kernel.times);
+    free(windows);
+    return JsResult_success;
+
+    error:
+    free(queue.times);
+    free(kernel.times);
+    free(windows);
+    free(result->latencies);
+    return JsResult_failure;
+}
+
+static int js_qsim_compare(const void * a, const void * b)
+{
+    const double x = *((const double*) a);
+    const double y = *((const double*) b);
+    return (x > y) - (x < y);
+}
+
+static double js_qsim_percentile(const double * values, size_t number_of_values, double p)
+{
+    return number_of_values ? values[(size_t) (p * (double) (number_of_values - 1))] : 0.0;
+}
+
+/* parse a comma-separated list of numbers (with an optional suffix 'e') */
+static bool js_qsim_parse_list(const char * text, JsQsimList * list)
+{
+    list->size = 0;
+    while (*text) {
+        char * end;
+        const double value = strtod(text, &end);
+        if (end == text || value < 0.0 || list->size == js_qsim_max_values) {
+            return false;
+        }
+        list->is_exponential[list->size] = *end == 'e';
+        list->values[list->size++] = value;
+        end += *end == 'e';
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+        text = end + (*end == ',');
+    }
+    return list->size > 0;
+}
+
+static void js_qsim_report_history(const JsEvent * events, size_t number_of_events, size_t number_of_blocks)
+{
+    JsHistory history;
+    double * const spans = (double*) malloc(number_of_events * sizeof(double));
+    if (!spans || js_create_history(&history, number_of_blocks, 0) != JsResult_success) {
+        free(spans);
+        fprintf(stderr, "Error: Unable to create history!\n");
+        return;
+    }
+
+    JsState state = {};
+    size_t n = 0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        js_update_state(&state, &events[i]);
+        js_history_append(&history, &state);
+        /* time span covered once the oldest block has been dropped */
+        if (history.count == history.capacity && history.blocks[history.first].key.time != events[0].time) {
+            spans[n++] = (double) (uint32_t) (state.time - history.blocks[history.first].key.time);
+        }
+    }
+
+    if (n) {
+        qsort(spans, n, sizeof(double), js_qsim_compare);
+        printf("%6zu blocks (%7zu bytes)  covers min %9.1f s  p1 %9.1f s\n",
+            number_of_blocks, number_of_blocks * sizeof(JsHistoryBlock), spans[0] * 1e-3, js_qsim_percentile(spans, n, 0.01) * 1e-3);
+    }
+    else {
+        printf("%6zu blocks (%7zu bytes)  holds the whole recording (%zu bytes used)\n",
+            number_of_blocks, number_of_blocks * sizeof(JsHistoryBlock), js_history_memory_usage(&history));
+    }
+
+    js_destroy_history(&history);
+    free(spans);
+}
+
+int main(int argc, char * argv[])
+{
+    /*
+     * Read Command Line Arguments
+     */
+
+    JsQsimList kernel_capacities = {.values = {64}, .size = 1};
+    JsQsimList queue_capacities = {.values = {16, 64, 256}, .size = 3};
+    JsQsimList service_times = {.values = {10, 100, 1000}, .size = 3};
+    JsQsimList periods = {.values = {0}, .size = 1};
+    JsQsimList history_capacities = {.values = {16, 64, 256}, .size = 3};
+    double handler_cost = 2.0;
+    int option;
+    while ((option = getopt(argc, argv, "k:q:s:p:c:H:")) != -1) {
+        bool is_valid = true;
+        switch (option) {
+            case 'k': is_valid = js_qsim_parse_list(optarg, &kernel_capacities); break;
+            case 'q': is_valid = js_qsim_parse_list(optarg, &queue_capacities); break;
+            case 's': is_valid = js_qsim_parse_list(optarg, &service_times); break;
+            case 'p': is_valid = js_qsim_parse_list(optarg, &periods); break;
+            case 'c': handler_cost = strtod(optarg, nullptr); break;
+            case 'H': is_valid = js_qsim_parse_list(optarg, &history_capacities); break;
+            default: is_valid = false; break;
+        }
+        if (!is_valid) {
+            goto usage_error;
+        }
+    }
+    if (argc - optind != 1) {
+        goto usage_error;
+    }
+    for (size_t k=0; k<kernel_capacities.size; ++k) {
+        if (kernel_capacities.values[k] < 1.0) {
+            goto usage_error;
+        }
+    }
+
+    /*
+     * Load Recording
+     */
+
+    JsRecording recording;
+    if (js_open_recording(&recording, argv[optind]) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to open recording '%s'\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    const size_t number_of_events = recording.number_of_events;
+    JsEvent * const events = (JsEvent*) malloc((number_of_events ? number_of_events : 1) * sizeof(JsEvent));
+    double * const arrivals = (double*) malloc((number_of_events ? number_of_events : 1) * sizeof(double));
+    if (!events || !arrivals || js_decode_recording(&recording, events, 1) != JsResult_success || number_of_events == 0) {
+        fprintf(stderr, "Error: Unable to decode recording '%s'\n", argv[optind]);
+        goto decode_error;
+    }
+    js_close_recording(&recording);
+
+    /* arrival times in us (the kernel times are 32-bit ms and may wrap around) and channels */
+    unsigned int number_of_axes = 0;
+    unsigned int number_of_buttons = 0;
+    double time = 0.0;
+    for (size_t i=0; i<number_of_events; ++i) {
+        if (i) {
+            const int32_t delta = (int32_t) (events[i].time - events[i - 1].time);
+            time += delta > 0 ? (double) delta * 1000.0 : 0.0;
+        }
+        arrivals[i] = time;
+        if (events[i].type & JS_EVENT_BUTTON && events[i].number >= number_of_buttons) {
+            number_of_buttons = events[i].number + 1u;
+        }
+        else if (events[i].type & JS_EVENT_AXIS && events[i].number >= number_of_axes) {
+            number_of_axes = events[i].number + 1u;
+        }
+    }
+    printf("%zu events in %.3f s (%.1f events/s), %u axes, %u buttons, handler cost %.1f us\n\n",
+        number_of_events, time * 1e-6, time > 0.0 ? (double) number_of_events / (time * 1e-6) : 0.0,
+        number_of_axes, number_of_buttons, handler_cost);
+
+    /*
+     * Simulate Configurations
+     */
+
+    printf("kernel queue  service  period | kernel loss  queue loss  P(loss)/s | kernel max  queue max  needed"
+        " | p50 ms  p99 ms  p99.9 ms  max ms\n");
+    for (size_t k=0; k<kernel_capacities.size; ++k) {
+        for (size_t s=0; s<service_times.size; ++s) {
+            for (size_t p=0; p<periods.size; ++p) {
+                JsQsimConfig config = {
+                    .kernel_capacity = (uint32_t) kernel_capacities.values[k],
+                    .service_time = service_times.values[s],
+                    .is_exponential = service_times.is_exponential[s],
+                    .period = periods.values[p],
+                    .handler_cost = handler_cost
+                };
+
+                /* an unbounded queue yields the capacity needed to avoid losses */
+                JsQsimResult result;
+                if (js_qsim_run(&config, arrivals, number_of_events, number_of_axes + number_of_buttons, &result) != JsResult_success) {
+                    goto simulation_error;
+                }
+                const size_t needed_capacity = result.max_queue_depth;
+                free(result.latencies);
+
+                const size_t number_of_windows = (size_t) (time * 1e-6) + 1;
+                for (size_t q=0; q<queue_capacities.size; ++q) {
+                    config.queue_capacity = (uint32_t) queue_capacities.values[q];
+                    if (js_qsim_run(&config, arrivals, number_of_events, number_of_axes + number_of_buttons, &result) != JsResult_success) {
+                        goto simulation_error;
+                    }
+                    qsort(result.latencies, result.number_of_latencies, sizeof(double), js_qsim_compare);
+
+                    char service[16];
+                    snprintf(service, sizeof(service), "%g%s", config.service_time, config.is_exponential ? "e" : "");
+                    printf("%6u %5u %8s %7g | %10.3f%% %10.3f%% %9.3f | %10zu %10zu %7zu | %6.2f %7.2f %9.2f %7.2f\n",
+                        config.kernel_capacity, config.queue_capacity, service, config.period,
+                        100.0 * (double) result.number_of_kernel_losses / (double) number_of_events,
+                        100.0 * (double) result.number_of_queue_losses / (double) number_of_events,
+                        (double) result.number_of_windows_with_losses / (double) number_of_windows,
+                        result.max_kernel_depth, result.max_queue_depth, needed_capacity,
+                        js_qsim_percentile(result.latencies, result.number_of_latencies, 0.5) * 1e-3,
+                        js_qsim_percentile(result.latencies, result.number_of_latencies, 0.99) * 1e-3,
+                        js_qsim_percentile(result.latencies, result.number_of_latencies, 0.999) * 1e-3,
+                        js_qsim_percentile(result.latencies, result.number_of_latencies, 1.0) * 1e-3
+                    );
+                    free(result.latencies);
+                }
+            }
+        }
+    }
+
+    /*
+     * History Capacities
+     */
+
+    printf("\nhistory\n");
+    for (size_t h=0; h<history_capacities.size; ++h) {
+        js_qsim_report_history(events, number_of_events, (size_t) history_capacities.values[h]);
+    }
+
+    free(arrivals);
+    free(events);
+    return EXIT_SUCCESS;
+
+    /*
+     * Error Handling
+     */
+
+    simulation_error:
+    {
+        fprintf(stderr, "Error: Unable to allocate memory for the simulation!\n");
+        free(arrivals);
+        free(events);
+        return EXIT_FAILURE;
+    }
+    decode_error:
+    {
+        free(arrivals);
+        free(events);
+        js_close_recording(&recording);
+        return EXIT_FAILURE;
+    }
+
+    usage_error:
+    fprintf(stderr, "Usage: js_qsim [-k kernel capacities] [-q queue capacities] [-s service times in us]"
+        " [-p consumer periods in us] [-c handler cost in us] [-H history blocks] recording\n");
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include <posigs.h>
+
+#include "js.h"
+#include "js_scope.h"
+
+/****************************************************************************************************
+ *
+ * Terminal Oscilloscope
+ *
+ ***************************************************************************************************/
+
+/*
+ * Shows scrolling traces of the axes and the event intervals of a joystick (see js_scope.h):
+ *
+ *     js_scope [-b] [-w window in ms] [-r frames per second] [-a axes mask] [pathname]
+ *
+ * -b renders with half blocks instead of braille characters. The event handler thread appends
+ * every event to a sample ring, from which the main thread redraws the changed cells of the screen
+ * at the frame rate.
+ */
+
+static const char js_std_pathname[] = "/dev/input/js0";
+
+/* ~1 min of events at 1 kHz */
+#define js_scope_ring_capacity 65536
+
+static atomic_bool is_running = true;
+
+static void sig_action(int signum, void * arg) {is_running = false;}
+
+static uint64_t js_scope_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1'000'000'000 + (uint64_t) t.tv_nsec;
+}
+
+static void js_scope_print(const char * text)
+{
+    fputs(text, stdout);
+    fflush(stdout);
+}
+
+int main(int argc, char * argv[])
+{
+    /*
+     * Read Command Line Arguments
+     */
+
+    JsScope scope = {.style = JsScopeStyle_braille, .window = 5'000'000'000};
+    unsigned int frame_rate = 30;
+    unsigned long axes = 0;
+    int option;
+    while ((option = getopt(argc, argv, "bw:r:a:")) != -1) {
+        switch (option) {
+            case 'b': scope.style = JsScopeStyle_blocks; break;
+            case 'w': scope.window = strtoull(optarg, nullptr, 10) * 1'000'000; break;
+            case 'r': frame_rate = (unsigned int) strtoul(optarg, nullptr, 10); break;
+            case 'a': axes = strtoul(optarg, nullptr, 0); break;
+            default: goto usage_error;
+        }
+    }
+    if (argc - optind > 1 || scope.window == 0 || frame_rate == 0 || frame_rate > 1000) {
+        goto usage_error;
+    }
+
+    const char * const pathname = (optind < argc ? argv[optind] : js_std_pathname);
+
+    /*
+     * Install Signal Handler
+     */
+
+    sigset_t sig_set;
+    sigemptyset(&sig_set);
+    PosigsHandler signal_handler = {
+        .sig_set = &sig_set,
+        .sig_action = sig_action,
+        .timeout = (struct timespec){.tv_nsec = 10'000'000}
+    };
+    if (!((sigaddset(&sig_set, SIGINT) == 0) && (sigaddset(&sig_set, SIGTERM) == 0)
+        && (sigaddset(&sig_set, SIGHUP) == 0) && posigs_create_handler(&signal_handler))) {
+        fprintf(stderr, "Error: Unable to install signal handler!\n");
+        goto create_signal_handler_error;
+    }
+
+    /*
+     * Connect to Joystick and Start Recording Samples
+     */
+
+    const int js = js_connect(pathname);
+    if (js < 0) {
+        fprintf(stderr, "Error: Unable to connect to joystick at '%s'\n", pathname);
+        goto connect_error;
+    }
+
+    JsProperties properties;
+    if (js_get_properties(js, &properties) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to obtain joystick properties!\n");
+        goto get_properties_error;
+    }
+    const unsigned int number_of_axes = (unsigned int) properties.number_of_axes < js_max_number_of_axes
+        ? (unsigned int) properties.number_of_axes : js_max_number_of_axes;
+    scope.axes = (uint32_t) (axes ? axes : (1ul << number_of_axes) - 1) & ((1u << js_max_number_of_axes) - 1);
+
+    JsScopeSample * const samples = (JsScopeSample*) malloc(js_scope_ring_capacity * sizeof(JsScopeSample));
+    if (!samples) {
+        fprintf(stderr, "Error: Unable to allocate samples!\n");
+        goto allocate_samples_error;
+    }
+
+    JsScopeRing ring = {};
+    if (js_create_scope_ring(&ring, js_scope_ring_capacity) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to create sample ring!\n");
+        goto create_ring_error;
+    }
+
+    JsEventHandler event_handler = {
+        .js = js,
+        .event_action = js_scope_ring_event_action,
+        .event_action_arg = &ring
+    };
+    if (js_create_event_handler(&event_handler) != JsResult_success) {
+        fprintf(stderr, "Error: Unable to create event handler!\n");
+        goto create_event_handler_error;
+    }
+
+    /*
+     * Main Loop
+     */
+
+    /* switch to the alternate screen and hide the cursor */
+    js_scope_print("\033[?1049h\033[?25l\033[2J");
+
+    bool has_scope = false;
+    struct winsize size = {};
+    const char * error = nullptr;
+    while (is_running) {
+        if (!js_event_handler_is_running(&event_handler)) {
+            error = "Error: Lost connection to joystick!\n";
+            break;
+        }
+
+        /* (re)create the scope whenever the size of the terminal changes */
+        struct winsize new_size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &new_size) != 0) {
+            new_size = (struct winsize){.ws_row = 24, .ws_col = 80};
+        }
+        if (new_size.ws_row != size.ws_row || new_size.ws_col != size.ws_col) {
+            size = new_size;
+            if (has_scope) {
+                js_destroy_scope(&scope);
+            }
+            scope.width = size.ws_col;
+            scope.height = size.ws_row;
+            has_scope = js_create_scope(&scope) == JsResult_success;
+            js_scope_print(has_scope ? "\033[2J" : "\033[2J\033[HTerminal too small");
+        }
+
+        if (has_scope) {
+            /* only the samples of the window are copied (not the whole ring) */
+            const uint64_t now = js_scope_now();
+            const size_t number_of_samples = js_scope_ring_read(&ring, samples, js_scope_ring_capacity,
+                now > scope.window ? now - scope.window : 0);
+            if (js_scope_draw(&scope, samples, number_of_samples, now, STDOUT_FILENO) != JsResult_success) {
+                /* the terminal is gone (e.g. the SSH connection was closed) */
+                break;
+            }
+        }
+
+        thrd_sleep(&(struct timespec){.tv_nsec = 1'000'000'000 / frame_rate}, nullptr);
+    }
+
+    js_scope_print("\033[?25h\033[?1049l");
+    if (error) {
+        fputs(error, stderr);
+    }
+
+    /*
+     * Cleanup
+     */
+
+    if (has_scope) {
+        js_destroy_scope(&scope);
+    }
+    js_destroy_event_handler(&event_handler);
+    js_destroy_scope_ring(&ring);
+    free(samples);
+    js_disconnect(js);
+    posigs_destroy_handler(&signal_handler);
+
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    /*
+     * Error Handling
+     */
+
+    create_event_handler_error:
+    {
+        js_destroy_scope_ring(&ring);
+    }
+    create_ring_error:
+    {
+        free(samples);
+    }
+    allocate_samples_error:
+    get_properties_error:
+    {
+        js_disconnect(js);
+    }
+    connect_error:
+    {
+        posigs_destroy_handler(&signal_handler);
+    }
+    create_signal_handler_error:
+    return EXIT_FAILURE;
+
+    usage_error:
+    fprintf(stderr, "Usage: js_scope [-b] [-w window in ms] [-r frames per second] [-a axes mask] {pathname}\n");
+    return EXIT_FAILURE;
+}